@@ -0,0 +1,817 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "disk_cache.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/disk.h>
+#include <zephyr/storage/disk_access.h>
+#include <zephyr/sys/printk.h>
+
+struct cache_entry {
+    uint32_t sector;
+    uint32_t lru;       /* 最近一次使用的时间戳, 越小越久未使用 */
+    bool valid;
+    bool dirty;
+};
+
+static struct cache_entry entries[DISK_CACHE_SECTORS_MAX];
+static uint8_t cache_data[DISK_CACHE_SECTORS_MAX][DISK_CACHE_SECTOR_SIZE] __aligned(DISK_CACHE_BUF_ALIGN);
+
+static uint32_t cache_sectors;  /* 当前使用的扇区数, 0: 只转发 */
+static uint32_t lru_clock;
+static const char *lower_name;
+static struct disk_cache_stats cache_stats;
+static K_MUTEX_DEFINE(cache_lock);
+
+/* 不对齐 buffer 的中转 buffer, 只在持有 cache_lock 时使用 */
+static uint8_t bounce_buf[DISK_CACHE_BOUNCE_SECTORS][DISK_CACHE_SECTOR_SIZE] __aligned(DISK_CACHE_BUF_ALIGN);
+
+/* 等待合并的连续扇区写: [pend_start, pend_start + pend_count) */
+static uint8_t coalesce_buf[DISK_CACHE_COALESCE_SECTORS_MAX][DISK_CACHE_SECTOR_SIZE] __aligned(DISK_CACHE_BUF_ALIGN);
+static uint32_t coalesce_max = DISK_CACHE_COALESCE_SECTORS_MAX;    /* 0: 不合并 */
+static uint32_t pend_start;
+static uint32_t pend_count;
+static int pend_error;          /* deadline 写回失败时记录，下一次 flush 返回 */
+static struct k_work_delayable coalesce_work;
+static struct k_work_q flush_wq;
+static K_THREAD_STACK_DEFINE(flush_stack, DISK_CACHE_FLUSH_STACK_SIZE);
+
+/* 顺序预读 */
+struct ra_stream {
+    uint32_t next;      /* 下一个首尾相接的读请求的起始扇区 */
+    uint32_t seq;       /* 连续首尾相接的读请求数, 0 表示空闲 */
+    uint32_t window;    /* 预读窗口 (扇区), 0 表示还没有开始预读 */
+    uint32_t start;     /* 预读 buffer 中数据的起始扇区 */
+    uint32_t count;     /* 预读 buffer 中的扇区数 */
+    uint32_t lru;
+};
+
+static struct ra_stream ra_streams[DISK_CACHE_RA_STREAMS];
+static uint8_t ra_data[DISK_CACHE_RA_STREAMS][DISK_CACHE_RA_SECTORS_MAX][DISK_CACHE_SECTOR_SIZE]
+    __aligned(DISK_CACHE_BUF_ALIGN);
+static uint32_t ra_max = DISK_CACHE_RA_SECTORS_MAX;     /* 0: 不预读 */
+static uint32_t ra_clock;
+static uint32_t lower_sector_count;     /* 0: 未知, 预读不超过请求的范围 */
+
+static int cmd_read(uint8_t *buf, uint32_t start, uint32_t num)
+{
+    cache_stats.read_cmds++;
+    cache_stats.read_cmd_sectors += num;
+    return disk_access_read(lower_name, buf, start, num);
+}
+
+static int cmd_write(const uint8_t *buf, uint32_t start, uint32_t num)
+{
+    cache_stats.write_cmds++;
+    cache_stats.write_cmd_sectors += num;
+    return disk_access_write(lower_name, buf, start, num);
+}
+
+/******************************************************************/
+/* 访问 lower disk
+ * SD 卡驱动 (sd_ops.c) 遇到不对齐的 buffer 时，每个扇区单独发一次命令并经过 card 内部 buffer
+ * 中转，速度大幅下降。这里保证交给 lower 的 buffer 都是对齐的:
+ * - 读: 前 N-1 个扇区用一次命令 DMA 到 buffer 内第一个对齐的地址，再整体前移到原位置;
+ *       最后一个扇区经 bounce_buf 读出后复制到末尾。
+ * - 写: 调用方的数据不能修改，按 DISK_CACHE_BOUNCE_SECTORS 个扇区一组复制到 bounce_buf 后写入。
+ */
+static bool buf_aligned(const uint8_t *buf)
+{
+    return ((uintptr_t)buf & (DISK_CACHE_BUF_ALIGN - 1)) == 0;
+}
+
+static int lower_read_direct(uint8_t *buf, uint32_t start, uint32_t num)
+{
+    uint32_t shift;
+    uint32_t body;
+    int rc;
+
+    if (buf_aligned(buf)) {
+        return cmd_read(buf, start, num);
+    }
+
+    cache_stats.unaligned_reads++;
+    shift = DISK_CACHE_BUF_ALIGN - ((uintptr_t)buf & (DISK_CACHE_BUF_ALIGN - 1));
+    body = num - 1;
+
+    if (body > 0) {
+        rc = cmd_read(buf + shift, start, body);
+        if (rc < 0) {
+            return rc;
+        }
+        memmove(buf, buf + shift, body * DISK_CACHE_SECTOR_SIZE);
+        cache_stats.shifted_bytes += body * DISK_CACHE_SECTOR_SIZE;
+    }
+
+    rc = cmd_read(bounce_buf[0], start + body, 1);
+    if (rc < 0) {
+        return rc;
+    }
+    memcpy(buf + body * DISK_CACHE_SECTOR_SIZE, bounce_buf[0], DISK_CACHE_SECTOR_SIZE);
+    cache_stats.bounced_bytes += DISK_CACHE_SECTOR_SIZE;
+
+    return 0;
+}
+
+static int lower_write_direct(const uint8_t *buf, uint32_t start, uint32_t num)
+{
+    int rc;
+
+    if (buf_aligned(buf)) {
+        return cmd_write(buf, start, num);
+    }
+
+    cache_stats.unaligned_writes++;
+    while (num > 0) {
+        uint32_t n = MIN(num, DISK_CACHE_BOUNCE_SECTORS);
+
+        memcpy(bounce_buf[0], buf, n * DISK_CACHE_SECTOR_SIZE);
+        rc = cmd_write(bounce_buf[0], start, n);
+        if (rc < 0) {
+            return rc;
+        }
+        cache_stats.bounced_bytes += n * DISK_CACHE_SECTOR_SIZE;
+
+        buf += n * DISK_CACHE_SECTOR_SIZE;
+        start += n;
+        num -= n;
+    }
+
+    return 0;
+}
+
+/******************************************************************/
+/* 连续扇区写合并
+ * FatFs 更新 FAT 链、小块追加写时，会连续调用单扇区的 disk_write，每次都是一条独立的
+ * 写命令和一次 busy 等待。这里把首尾相接的写请求暂存在 coalesce_buf 中，遇到不连续的写、
+ * 与暂存范围重叠的读、sync、暂存满或超过 DISK_CACHE_COALESCE_DEADLINE_MS 时，
+ * 用一条多扇区写命令 (SD 卡驱动会先用 CMD23 声明块数) 写入。
+ */
+static int pending_flush(void)
+{
+    int rc;
+
+    if (pend_count == 0) {
+        return 0;
+    }
+
+    (void)k_work_cancel_delayable(&coalesce_work);
+    rc = lower_write_direct(coalesce_buf[0], pend_start, pend_count);
+    pend_count = 0;
+    return rc;
+}
+
+static void coalesce_deadline(struct k_work *work)
+{
+    uint32_t count;
+    int rc;
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    if (pend_count > 0) {
+        cache_stats.deadline_flushes++;
+        count = pend_count;
+        rc = pending_flush();
+        if (rc < 0) {
+            printk("disk_cache: deadline write back %u sectors failed: %d\n", count, rc);
+            pend_error = rc;
+        }
+    }
+    k_mutex_unlock(&cache_lock);
+}
+
+static bool pending_overlaps(uint32_t start, uint32_t num)
+{
+    return pend_count > 0 && start < pend_start + pend_count && pend_start < start + num;
+}
+
+static int lower_read(uint8_t *buf, uint32_t start, uint32_t num)
+{
+    int rc;
+
+    if (pending_overlaps(start, num)) {
+        rc = pending_flush();
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    return lower_read_direct(buf, start, num);
+}
+
+static int lower_write(const uint8_t *buf, uint32_t start, uint32_t num)
+{
+    int rc;
+
+    if (pend_count > 0 &&
+        (start != pend_start + pend_count || pend_count + num > coalesce_max)) {
+        rc = pending_flush();
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    if (num >= coalesce_max) {
+        return lower_write_direct(buf, start, num);
+    }
+
+    if (pend_count == 0) {
+        pend_start = start;
+        (void)k_work_schedule_for_queue(&flush_wq, &coalesce_work, K_MSEC(DISK_CACHE_COALESCE_DEADLINE_MS));
+    } else {
+        cache_stats.coalesced_writes++;
+    }
+    memcpy(coalesce_buf[pend_count], buf, num * DISK_CACHE_SECTOR_SIZE);
+    pend_count += num;
+
+    if (pend_count == coalesce_max) {
+        return pending_flush();
+    }
+    return 0;
+}
+/******************************************************************/
+
+static int find_entry(uint32_t sector)
+{
+    for (uint32_t i = 0; i < cache_sectors; i++) {
+        if (entries[i].valid && entries[i].sector == sector) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void touch_entry(int idx)
+{
+    entries[idx].lru = ++lru_clock;
+}
+
+static int writeback_entry(int idx)
+{
+    int rc = lower_write(cache_data[idx], entries[idx].sector, 1);
+    if (rc == 0) {
+        entries[idx].dirty = false;
+        cache_stats.writebacks++;
+    }
+    return rc;
+}
+
+/* 取一个空闲扇区，没有时淘汰最久未使用的扇区 (dirty 先写回) */
+static int alloc_entry(void)
+{
+    int victim = -1;
+    int rc;
+
+    for (uint32_t i = 0; i < cache_sectors; i++) {
+        if (!entries[i].valid) {
+            return i;
+        }
+        if (victim < 0 || entries[i].lru < entries[victim].lru) {
+            victim = i;
+        }
+    }
+
+    if (entries[victim].dirty) {
+        rc = writeback_entry(victim);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+    entries[victim].valid = false;
+    cache_stats.evictions++;
+    return victim;
+}
+
+/* 按扇区号从小到大写回，减少 SD 卡的随机写 */
+static int flush_locked(void)
+{
+    int rc;
+
+    cache_stats.flushes++;
+    for (;;) {
+        int next = -1;
+        for (uint32_t i = 0; i < cache_sectors; i++) {
+            if (entries[i].valid && entries[i].dirty &&
+                (next < 0 || entries[i].sector < entries[next].sector)) {
+                next = i;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+        rc = writeback_entry(next);
+        if (rc < 0) {
+            printk("disk_cache: write back sector %u failed: %d\n", entries[next].sector, rc);
+            return rc;
+        }
+    }
+
+    rc = pending_flush();
+    if (rc == 0 && pend_error != 0) {
+        rc = pend_error;
+    }
+    pend_error = 0;
+    return rc;
+}
+
+/* 把 [start, start+num) 中已缓存的扇区复制到 buf (dirty 的数据比 lower 新) */
+static void overlay_dirty(uint8_t *buf, uint32_t start, uint32_t num)
+{
+    for (uint32_t i = 0; i < cache_sectors; i++) {
+        if (entries[i].valid && entries[i].dirty &&
+            entries[i].sector >= start && entries[i].sector - start < num) {
+            memcpy(buf + (entries[i].sector - start) * DISK_CACHE_SECTOR_SIZE,
+                   cache_data[i], DISK_CACHE_SECTOR_SIZE);
+        }
+    }
+}
+
+/******************************************************************/
+/* 顺序预读
+ * FatFs 小块顺序读时每次只读 1 个扇区 (经 FIL.buf) 或几个扇区，每次都是一条读命令。
+ * 识别出首尾相接的读请求后，一次读入后面 window 个扇区，之后的请求直接从预读 buffer 复制。
+ */
+static bool ra_contains(const struct ra_stream *s, uint32_t sector)
+{
+    return s->count > 0 && sector >= s->start && sector - s->start < s->count;
+}
+
+/* 丢弃流中还没用到的预读数据，从 next 开始重新识别 */
+static void ra_reset(struct ra_stream *s, uint32_t next)
+{
+    if (ra_contains(s, s->next)) {
+        cache_stats.ra_wasted_sectors += s->start + s->count - s->next;
+    }
+    if (s->window > 0) {
+        cache_stats.ra_cancels++;
+    }
+
+    memset(s, 0, sizeof(*s));
+    s->next = next;
+    s->seq = 1;
+    s->lru = ++ra_clock;
+}
+
+static struct ra_stream *ra_find(uint32_t start)
+{
+    for (uint32_t i = 0; i < DISK_CACHE_RA_STREAMS; i++) {
+        struct ra_stream *s = &ra_streams[i];
+
+        if ((s->seq > 0 && s->next == start) || ra_contains(s, start)) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+static struct ra_stream *ra_victim(void)
+{
+    struct ra_stream *victim = &ra_streams[0];
+
+    for (uint32_t i = 1; i < DISK_CACHE_RA_STREAMS; i++) {
+        if (ra_streams[i].lru < victim->lru) {
+            victim = &ra_streams[i];
+        }
+    }
+    return victim;
+}
+
+/* 返回 1: 已经读出; 0: 不是顺序读，按原来的路径读; 负数为错误 */
+static int ra_read(uint8_t *buf, uint32_t start, uint32_t num)
+{
+    struct ra_stream *s = ra_find(start);
+    uint8_t *data;
+    uint32_t done = 0;
+    uint32_t rest;
+    uint32_t n;
+    int rc;
+
+    if (s == NULL) {
+        /* 新的流 (或 seek 之后)，替换最久没有使用的流 */
+        ra_reset(ra_victim(), start + num);
+        return 0;
+    }
+
+    s->lru = ++ra_clock;
+    if (s->window == 0 && ++s->seq < DISK_CACHE_RA_TRIGGER) {
+        s->next = start + num;
+        return 0;
+    }
+
+    data = ra_data[s - ra_streams][0];
+    if (ra_contains(s, start)) {
+        done = MIN(num, s->start + s->count - start);
+        memcpy(buf, data + (start - s->start) * DISK_CACHE_SECTOR_SIZE, done * DISK_CACHE_SECTOR_SIZE);
+        cache_stats.ra_hit_sectors += done;
+        s->window = MIN(s->window * 2, ra_max);
+    }
+
+    rest = num - done;
+    if (rest > 0) {
+        if (s->window == 0) {
+            s->window = MIN(DISK_CACHE_RA_SECTORS_MIN, ra_max);
+        }
+
+        n = MAX(rest, s->window);
+        if (lower_sector_count > start + done && start + done + n > lower_sector_count) {
+            n = MAX(rest, lower_sector_count - (start + done));
+        }
+
+        if (n > ra_max) {
+            /* 请求本身比预读 buffer 大, 直接读 */
+            s->count = 0;
+            rc = lower_read(buf + done * DISK_CACHE_SECTOR_SIZE, start + done, rest);
+            if (rc == 0) {
+                overlay_dirty(buf + done * DISK_CACHE_SECTOR_SIZE, start + done, rest);
+            }
+        } else {
+            cache_stats.ra_fills++;
+            cache_stats.ra_fill_sectors += n;
+            rc = lower_read(data, start + done, n);
+            if (rc == 0) {
+                /* 缓存中 dirty 的扇区比 lower 新; 之后再写入时由 ra_update 更新 */
+                overlay_dirty(data, start + done, n);
+                s->start = start + done;
+                s->count = n;
+                memcpy(buf + done * DISK_CACHE_SECTOR_SIZE, data, rest * DISK_CACHE_SECTOR_SIZE);
+            } else {
+                s->count = 0;
+            }
+        }
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    s->next = start + num;
+    return 1;
+}
+
+/* 写入的扇区在预读 buffer 中时同步更新 */
+static void ra_update(const uint8_t *buf, uint32_t start, uint32_t num)
+{
+    for (uint32_t i = 0; i < DISK_CACHE_RA_STREAMS; i++) {
+        struct ra_stream *s = &ra_streams[i];
+
+        for (uint32_t j = 0; j < num; j++) {
+            if (ra_contains(s, start + j)) {
+                memcpy(ra_data[i][start + j - s->start], buf + j * DISK_CACHE_SECTOR_SIZE,
+                       DISK_CACHE_SECTOR_SIZE);
+            }
+        }
+    }
+}
+
+/* 取消所有的流, 丢弃预读的数据 (卸载后介质可能被更换) */
+static void ra_invalidate(void)
+{
+    memset(ra_streams, 0, sizeof(ra_streams));
+}
+/******************************************************************/
+
+/* 直接写入 lower 后，同步已缓存扇区的内容 */
+static void update_clean(const uint8_t *buf, uint32_t start, uint32_t num)
+{
+    for (uint32_t i = 0; i < cache_sectors; i++) {
+        if (entries[i].valid &&
+            entries[i].sector >= start && entries[i].sector - start < num) {
+            memcpy(cache_data[i], buf + (entries[i].sector - start) * DISK_CACHE_SECTOR_SIZE,
+                   DISK_CACHE_SECTOR_SIZE);
+            entries[i].dirty = false;
+        }
+    }
+}
+
+static int cache_read_sectors(uint8_t *buf, uint32_t start, uint32_t num)
+{
+    uint32_t i = 0;
+    int rc;
+
+    while (i < num) {
+        int idx = find_entry(start + i);
+        if (idx >= 0) {
+            memcpy(buf + i * DISK_CACHE_SECTOR_SIZE, cache_data[idx], DISK_CACHE_SECTOR_SIZE);
+            touch_entry(idx);
+            cache_stats.read_hits++;
+            i++;
+            continue;
+        }
+
+        /* 连续未命中的扇区用一次命令读出，再放入缓存 */
+        uint32_t run = 1;
+        while (i + run < num && find_entry(start + i + run) < 0) {
+            run++;
+        }
+        rc = lower_read(buf + i * DISK_CACHE_SECTOR_SIZE, start + i, run);
+        if (rc < 0) {
+            return rc;
+        }
+        cache_stats.read_misses += run;
+
+        for (uint32_t j = 0; j < run; j++) {
+            idx = alloc_entry();
+            if (idx < 0) {
+                return idx;
+            }
+            memcpy(cache_data[idx], buf + (i + j) * DISK_CACHE_SECTOR_SIZE, DISK_CACHE_SECTOR_SIZE);
+            entries[idx].sector = start + i + j;
+            entries[idx].valid = true;
+            entries[idx].dirty = false;
+            touch_entry(idx);
+        }
+        i += run;
+    }
+
+    return 0;
+}
+
+static int cache_write_sectors(const uint8_t *buf, uint32_t start, uint32_t num)
+{
+    for (uint32_t i = 0; i < num; i++) {
+        int idx = find_entry(start + i);
+        if (idx >= 0) {
+            cache_stats.write_hits++;
+        } else {
+            idx = alloc_entry();
+            if (idx < 0) {
+                return idx;
+            }
+            cache_stats.write_misses++;
+            entries[idx].sector = start + i;
+            entries[idx].valid = true;
+        }
+        memcpy(cache_data[idx], buf + i * DISK_CACHE_SECTOR_SIZE, DISK_CACHE_SECTOR_SIZE);
+        entries[idx].dirty = true;
+        touch_entry(idx);
+    }
+
+    return 0;
+}
+
+static int disk_cache_access_init(struct disk_info *disk)
+{
+    uint32_t sector_size = 0;
+    int rc;
+
+    rc = disk_access_init(lower_name);
+    if (rc < 0) {
+        return rc;
+    }
+
+    rc = disk_access_ioctl(lower_name, DISK_IOCTL_GET_SECTOR_SIZE, &sector_size);
+    if (rc == 0 && sector_size != DISK_CACHE_SECTOR_SIZE && cache_sectors > 0) {
+        printk("disk_cache: %s sector size %u != %d, cache disabled\n",
+            lower_name, sector_size, DISK_CACHE_SECTOR_SIZE);
+        (void)disk_cache_resize(0);
+    }
+
+    if (disk_access_ioctl(lower_name, DISK_IOCTL_GET_SECTOR_COUNT, &lower_sector_count) < 0) {
+        lower_sector_count = 0;
+    }
+
+    return 0;
+}
+
+static int disk_cache_access_status(struct disk_info *disk)
+{
+    return disk_access_status(lower_name);
+}
+
+static int disk_cache_access_read(struct disk_info *disk, uint8_t *data_buf,
+                                  uint32_t start_sector, uint32_t num_sector)
+{
+    int rc;
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    cache_stats.read_reqs++;
+    if (ra_max > 0) {
+        rc = ra_read(data_buf, start_sector, num_sector);
+        if (rc != 0) {
+            k_mutex_unlock(&cache_lock);
+            return (rc < 0) ? rc : 0;
+        }
+    }
+
+    if (cache_sectors == 0 || num_sector >= DISK_CACHE_BYPASS_SECTORS) {
+        cache_stats.bypass_reads++;
+        rc = lower_read(data_buf, start_sector, num_sector);
+        if (rc == 0) {
+            overlay_dirty(data_buf, start_sector, num_sector);
+        }
+    } else {
+        rc = cache_read_sectors(data_buf, start_sector, num_sector);
+    }
+    k_mutex_unlock(&cache_lock);
+
+    return rc;
+}
+
+static int disk_cache_access_write(struct disk_info *disk, const uint8_t *data_buf,
+                                   uint32_t start_sector, uint32_t num_sector)
+{
+    int rc;
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    cache_stats.write_reqs++;
+    if (cache_sectors == 0 || num_sector >= DISK_CACHE_BYPASS_SECTORS) {
+        cache_stats.bypass_writes++;
+        rc = lower_write(data_buf, start_sector, num_sector);
+        if (rc == 0) {
+            update_clean(data_buf, start_sector, num_sector);
+        }
+    } else {
+        rc = cache_write_sectors(data_buf, start_sector, num_sector);
+    }
+    if (rc == 0) {
+        ra_update(data_buf, start_sector, num_sector);
+    }
+    k_mutex_unlock(&cache_lock);
+
+    return rc;
+}
+
+static int disk_cache_access_ioctl(struct disk_info *disk, uint8_t cmd, void *buff)
+{
+    int rc;
+
+    switch (cmd) {
+    case DISK_IOCTL_CTRL_SYNC:
+        rc = disk_cache_flush();
+        if (rc < 0) {
+            return rc;
+        }
+        break;
+    case DISK_IOCTL_CTRL_DEINIT:
+        /* 写回后丢弃缓存和预读的数据, 之后的挂载与上电后相同, 都从 lower 读 */
+        k_mutex_lock(&cache_lock, K_FOREVER);
+        rc = flush_locked();
+        if (rc == 0) {
+            memset(entries, 0, sizeof(entries));
+            ra_invalidate();
+        }
+        k_mutex_unlock(&cache_lock);
+        if (rc < 0) {
+            return rc;
+        }
+        break;
+    default:
+        break;
+    }
+
+    return disk_access_ioctl(lower_name, cmd, buff);
+}
+
+static const struct disk_operations disk_cache_ops = {
+    .init = disk_cache_access_init,
+    .status = disk_cache_access_status,
+    .read = disk_cache_access_read,
+    .write = disk_cache_access_write,
+    .ioctl = disk_cache_access_ioctl,
+};
+
+static struct disk_info disk_cache_disk = {
+    .ops = &disk_cache_ops,
+};
+
+int disk_cache_register(const char *upper, const char *lower, uint32_t sectors)
+{
+    struct k_work_queue_config wq_cfg = {
+        .name = "disk_cache",
+    };
+    int rc;
+
+    if (lower_name != NULL) {
+        return -EALREADY;
+    }
+    if (sectors > DISK_CACHE_SECTORS_MAX) {
+        printk("disk_cache: sectors %u exceeds %d\n", sectors, DISK_CACHE_SECTORS_MAX);
+        return -EINVAL;
+    }
+
+    lower_name = lower;
+    cache_sectors = sectors;
+    disk_cache_disk.name = (char *)upper;
+    k_work_init_delayable(&coalesce_work, coalesce_deadline);
+
+    rc = disk_access_register(&disk_cache_disk);
+    if (rc < 0) {
+        printk("disk_cache: register %s failed: %d\n", upper, rc);
+        lower_name = NULL;
+        return rc;
+    }
+    k_work_queue_init(&flush_wq);
+    k_work_queue_start(&flush_wq, flush_stack, K_THREAD_STACK_SIZEOF(flush_stack),
+        DISK_CACHE_FLUSH_PRIORITY, &wq_cfg);
+
+    printk("disk_cache: %s -> %s, %u sectors\n", upper, lower, sectors);
+    return 0;
+}
+
+int disk_cache_resize(uint32_t sectors)
+{
+    int rc;
+
+    if (sectors > DISK_CACHE_SECTORS_MAX) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    rc = flush_locked();
+    if (rc == 0) {
+        memset(entries, 0, sizeof(entries));
+        ra_invalidate();
+        cache_sectors = sectors;
+    }
+    k_mutex_unlock(&cache_lock);
+
+    return rc;
+}
+
+int disk_cache_set_coalesce(uint32_t sectors)
+{
+    int rc;
+
+    if (sectors > DISK_CACHE_COALESCE_SECTORS_MAX) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    rc = pending_flush();
+    if (rc == 0) {
+        coalesce_max = sectors;
+    }
+    k_mutex_unlock(&cache_lock);
+
+    return rc;
+}
+
+int disk_cache_set_readahead(uint32_t sectors)
+{
+    if (sectors > DISK_CACHE_RA_SECTORS_MAX) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    ra_invalidate();
+    ra_max = sectors;
+    k_mutex_unlock(&cache_lock);
+
+    return 0;
+}
+
+int disk_cache_flush(void)
+{
+    int rc;
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    rc = flush_locked();
+    k_mutex_unlock(&cache_lock);
+
+    return rc;
+}
+
+void disk_cache_stats_get(struct disk_cache_stats *stats)
+{
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    *stats = cache_stats;
+    k_mutex_unlock(&cache_lock);
+}
+
+void disk_cache_stats_reset(void)
+{
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    memset(&cache_stats, 0, sizeof(cache_stats));
+    k_mutex_unlock(&cache_lock);
+}
+
+void disk_cache_stats_print(void)
+{
+    struct disk_cache_stats s;
+    uint32_t lookups;
+
+    disk_cache_stats_get(&s);
+    lookups = s.read_hits + s.read_misses;
+
+    printk("disk_cache (%u sectors): read hit %u, miss %u (hit rate %u%%); write hit %u, miss %u; "
+            "writeback %u, eviction %u, flush %u; bypass read %u, write %u\n",
+        cache_sectors, s.read_hits, s.read_misses, lookups ? s.read_hits * 100 / lookups : 0,
+        s.write_hits, s.write_misses, s.writebacks, s.evictions, s.flushes,
+        s.bypass_reads, s.bypass_writes);
+    printk("disk_cache unaligned: read %u, write %u; bounced %u bytes, shifted %u bytes\n",
+        s.unaligned_reads, s.unaligned_writes, s.bounced_bytes, s.shifted_bytes);
+    /* 合并比: 上层请求数 / 下发给 lower 的命令数 (x100) */
+    printk("disk_cache commands (coalesce %u sectors): read req %u -> cmd %u (%u sectors), "
+            "write req %u -> cmd %u (%u sectors), merge ratio %u.%02u; coalesced %u, deadline flush %u\n",
+        coalesce_max, s.read_reqs, s.read_cmds, s.read_cmd_sectors,
+        s.write_reqs, s.write_cmds, s.write_cmd_sectors,
+        s.write_cmds ? s.write_reqs * 100 / s.write_cmds / 100 : 0,
+        s.write_cmds ? s.write_reqs * 100 / s.write_cmds % 100 : 0,
+        s.coalesced_writes, s.deadline_flushes);
+    printk("disk_cache read-ahead (max %u sectors): hit %u sectors, fill %u cmds (%u sectors), "
+            "wasted %u sectors, cancel %u\n",
+        ra_max, s.ra_hit_sectors, s.ra_fills, s.ra_fill_sectors, s.ra_wasted_sectors, s.ra_cancels);
+}
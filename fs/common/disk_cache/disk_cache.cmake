@@ -0,0 +1,11 @@
+# Copyright (c) 2024 Realtek Semiconductor Corp.
+# SPDX-License-Identifier: Apache-2.0
+#
+# FatFs diskio 与 disk 驱动之间的扇区缓存, 在 app 的 CMakeLists.txt 中 find_package(Zephyr) 之后 include
+
+set(DISK_CACHE_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+target_include_directories(app PRIVATE ${DISK_CACHE_DIR})
+target_sources(app PRIVATE
+    ${DISK_CACHE_DIR}/disk_cache.c
+)
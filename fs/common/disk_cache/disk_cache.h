@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * FatFs diskio 与 SD 卡 disk 驱动之间的 write-back 扇区缓存
+ *
+ * FatFs 通过 disk_access_xxx(name) 访问磁盘，这里注册一个新的 disk (upper)，
+ * 把请求转发给真正的 disk 驱动 (lower)。因此 devicetree 中 SD 卡的 disk-name
+ * 需要改成 lower 的名字，upper 使用 FatFs 挂载时的名字 ("SD")。
+ *
+ *   fs_write -> FatFs -> disk_access_write("SD") -> disk_cache -> disk_access_write("SDMMC")
+ *
+ * 小于 DISK_CACHE_BYPASS_SECTORS 的请求经过缓存 (LRU, 按扇区管理)，写入只标记 dirty，
+ * 在 fs_sync (DISK_IOCTL_CTRL_SYNC)、fs_unmount (DISK_IOCTL_CTRL_DEINIT)、
+ * 淘汰或 disk_cache_flush() 时写回。fs_unmount 写回后丢弃所有缓存和预读的数据。大请求直接访问 lower，避免污染缓存。
+ *
+ * 交给 lower 的 buffer 总是 DISK_CACHE_BUF_ALIGN 对齐的: 不对齐的读请求用一次多扇区命令读到
+ * 调用方 buffer 内的对齐位置后前移，只有最后一个扇区经过中转 buffer; 不对齐的写请求按
+ * DISK_CACHE_BOUNCE_SECTORS 分组中转。缓存关闭 (0 扇区) 时同样生效。
+ *
+ * 首尾相接的小写请求 (包括缓存按扇区顺序写回时) 先暂存，合并成一条多扇区写命令，
+ * 暂存时间不超过 DISK_CACHE_COALESCE_DEADLINE_MS。超时的写入在 disk_cache 自己的 work queue
+ * 中执行 (不占用 system work queue), 优先级默认最低, 不会抢占正在写的线程。
+ *
+ * 顺序预读: 按扇区号识别最多 DISK_CACHE_RA_STREAMS 个顺序读的流 (通常每个顺序读的文件一个，
+ * 中间夹杂的 FAT 表读取落在另一个流上)，连续 DISK_CACHE_RA_TRIGGER 个首尾相接的读请求后，
+ * 每次多读后面的扇区到这个流的预读 buffer。命中后窗口加倍，直到 disk_cache_set_readahead()
+ * 设置的上限; 读其它位置 (seek) 时该流被取消。写入会同步更新预读 buffer 中的扇区。
+ *
+ * 注意: 没有 sync 的数据在掉电时会丢失，与 FatFs 自身的 FIL.buf 语义一致。
+ */
+#ifndef DISK_CACHE_H_
+#define DISK_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef DISK_CACHE_SECTOR_SIZE
+#define DISK_CACHE_SECTOR_SIZE      (512)
+#endif
+
+/* 缓存的最大扇区数，决定静态 RAM 占用: DISK_CACHE_SECTORS_MAX * 512 字节 */
+#ifndef DISK_CACHE_SECTORS_MAX
+#define DISK_CACHE_SECTORS_MAX      (64)
+#endif
+
+/* 扇区数 >= 此值的请求不经过缓存 */
+#ifndef DISK_CACHE_BYPASS_SECTORS
+#define DISK_CACHE_BYPASS_SECTORS   (8)
+#endif
+
+/* 交给 lower 的 buffer 按此对齐，满足 SD 卡 DMA 要求 */
+#ifndef DISK_CACHE_BUF_ALIGN
+#define DISK_CACHE_BUF_ALIGN        (32)
+#endif
+
+/* 不对齐写请求的中转 buffer 大小 (扇区) */
+#ifndef DISK_CACHE_BOUNCE_SECTORS
+#define DISK_CACHE_BOUNCE_SECTORS   (8)
+#endif
+
+/* 最多合并的扇区数, 决定 coalesce buffer 的大小 */
+#ifndef DISK_CACHE_COALESCE_SECTORS_MAX
+#define DISK_CACHE_COALESCE_SECTORS_MAX     (16)
+#endif
+
+/* 同时跟踪的顺序读流数，每个流一个预读 buffer */
+#ifndef DISK_CACHE_RA_STREAMS
+#define DISK_CACHE_RA_STREAMS       (2)
+#endif
+
+/* 预读窗口上限 (扇区)，决定预读 buffer 的大小: DISK_CACHE_RA_STREAMS * DISK_CACHE_RA_SECTORS_MAX * 512 字节 */
+#ifndef DISK_CACHE_RA_SECTORS_MAX
+#define DISK_CACHE_RA_SECTORS_MAX   (32)
+#endif
+
+/* 初始窗口 */
+#ifndef DISK_CACHE_RA_SECTORS_MIN
+#define DISK_CACHE_RA_SECTORS_MIN   (4)
+#endif
+
+/* 连续多少个首尾相接的读请求后开始预读 */
+#ifndef DISK_CACHE_RA_TRIGGER
+#define DISK_CACHE_RA_TRIGGER       (2)
+#endif
+
+/* 暂存的写请求最长等待时间 */
+#ifndef DISK_CACHE_COALESCE_DEADLINE_MS
+#define DISK_CACHE_COALESCE_DEADLINE_MS     (5)
+#endif
+
+/* 执行超时写入的 work queue, 栈要能容纳 SD 卡驱动的调用链 */
+#ifndef DISK_CACHE_FLUSH_STACK_SIZE
+#define DISK_CACHE_FLUSH_STACK_SIZE     (2048)
+#endif
+
+#ifndef DISK_CACHE_FLUSH_PRIORITY
+#define DISK_CACHE_FLUSH_PRIORITY       (K_LOWEST_APPLICATION_THREAD_PRIO)
+#endif
+
+struct disk_cache_stats {
+    uint32_t read_hits;         /* 读命中的扇区数 */
+    uint32_t read_misses;       /* 读未命中的扇区数 */
+    uint32_t write_hits;        /* 写入已缓存扇区的次数 */
+    uint32_t write_misses;      /* 写入时新分配缓存扇区的次数 */
+    uint32_t writebacks;        /* 写回 lower 的扇区数 */
+    uint32_t evictions;         /* 淘汰的扇区数 (含 clean) */
+    uint32_t bypass_reads;      /* 直接访问 lower 的读请求数 */
+    uint32_t bypass_writes;     /* 直接访问 lower 的写请求数 */
+    uint32_t flushes;           /* flush 次数 */
+    uint32_t unaligned_reads;   /* buffer 不对齐的读请求数 */
+    uint32_t unaligned_writes;  /* buffer 不对齐的写请求数 */
+    uint32_t bounced_bytes;     /* 经过中转 buffer 的字节数 */
+    uint32_t shifted_bytes;     /* 读入后在调用方 buffer 内前移的字节数 */
+    uint32_t read_reqs;         /* 上层 (FatFs) 的读请求数 */
+    uint32_t write_reqs;        /* 上层 (FatFs) 的写请求数 */
+    uint32_t read_cmds;         /* 下发给 lower 的读命令数 */
+    uint32_t write_cmds;        /* 下发给 lower 的写命令数 */
+    uint32_t read_cmd_sectors;
+    uint32_t write_cmd_sectors;
+    uint32_t coalesced_writes;  /* 追加到暂存写中的请求数 */
+    uint32_t deadline_flushes;  /* 因超时写入的次数 */
+    uint32_t ra_hit_sectors;    /* 从预读 buffer 读出的扇区数 */
+    uint32_t ra_fills;          /* 预读命令数 */
+    uint32_t ra_fill_sectors;
+    uint32_t ra_wasted_sectors; /* 预读后没有用到就被丢弃的扇区数 */
+    uint32_t ra_cancels;        /* 预读中的流被取消的次数 */
+};
+
+/**
+ * @brief 注册缓存 disk
+ *
+ * 必须在 fs_mount() 之前调用，只能调用一次。
+ *
+ * @param upper FatFs 使用的 disk 名字, 例如 "SD"
+ * @param lower 真正的 disk 驱动的名字, 例如 "SDMMC"
+ * @param sectors 缓存扇区数, 1 ~ DISK_CACHE_SECTORS_MAX; 0 表示不缓存，只转发
+ *
+ * @return 0 成功，负数为 errno
+ */
+int disk_cache_register(const char *upper, const char *lower, uint32_t sectors);
+
+/**
+ * @brief 修改缓存扇区数，会先写回所有 dirty 扇区并清空缓存和预读的数据
+ *
+ * @param sectors 0 表示关闭缓存
+ */
+int disk_cache_resize(uint32_t sectors);
+
+/**
+ * @brief 设置最多合并的扇区数，会先写入暂存的数据
+ *
+ * @param sectors 0 ~ DISK_CACHE_COALESCE_SECTORS_MAX, 0 或 1 表示不合并
+ */
+int disk_cache_set_coalesce(uint32_t sectors);
+
+/**
+ * @brief 设置预读窗口上限，并取消所有的流
+ *
+ * @param sectors 0 ~ DISK_CACHE_RA_SECTORS_MAX, 0 表示不预读; 默认 DISK_CACHE_RA_SECTORS_MAX
+ */
+int disk_cache_set_readahead(uint32_t sectors);
+
+/* 写回所有 dirty 扇区和暂存的合并写 */
+int disk_cache_flush(void);
+
+void disk_cache_stats_get(struct disk_cache_stats *stats);
+void disk_cache_stats_reset(void);
+void disk_cache_stats_print(void);
+
+#endif /* DISK_CACHE_H_ */
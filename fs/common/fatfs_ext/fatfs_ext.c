@@ -0,0 +1,484 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "fatfs_ext.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/printk.h>
+
+#include <ff.h>
+#include <diskio.h>
+
+#if FF_USE_FASTSEEK || FF_USE_EXPAND
+/* 与 Zephyr fat_fs.c 中 translate_error() 一致 */
+static int translate_error(FRESULT res)
+{
+    switch (res) {
+    case FR_OK:
+        return 0;
+    case FR_NO_FILE:
+    case FR_NO_PATH:
+    case FR_INVALID_NAME:
+        return -ENOENT;
+    case FR_DENIED:
+        return -EACCES;
+    case FR_EXIST:
+        return -EEXIST;
+    case FR_INVALID_OBJECT:
+        return -EBADF;
+    case FR_WRITE_PROTECTED:
+        return -EROFS;
+    case FR_INVALID_DRIVE:
+    case FR_NOT_ENABLED:
+    case FR_NO_FILESYSTEM:
+        return -ENODEV;
+    case FR_NOT_ENOUGH_CORE:
+        return -ENOMEM;
+    case FR_TOO_MANY_OPEN_FILES:
+        return -EMFILE;
+    case FR_INVALID_PARAMETER:
+        return -EINVAL;
+    case FR_LOCKED:
+    case FR_TIMEOUT:
+    case FR_MKFS_ABORTED:
+    case FR_DISK_ERR:
+    case FR_INT_ERR:
+    case FR_NOT_READY:
+        return -EIO;
+    }
+
+    return -EIO;
+}
+#endif
+
+static FIL *file_to_fil(struct fs_file_t *zfp)
+{
+    if (zfp == NULL || zfp->filep == NULL || zfp->mp == NULL || zfp->mp->type != FS_FATFS) {
+        return NULL;
+    }
+    return zfp->filep;
+}
+
+#if FF_USE_FASTSEEK
+struct clmt_slot {
+    FIL *owner;     /* NULL: 空闲 */
+    DWORD tbl[FATFS_EXT_CLMT_WORDS];
+};
+
+static struct clmt_slot clmt_pool[FATFS_EXT_CLMT_POOL_SLOTS];
+static K_MUTEX_DEFINE(clmt_lock);
+
+static DWORD *clmt_alloc(FIL *fp)
+{
+    DWORD *tbl = NULL;
+
+    k_mutex_lock(&clmt_lock, K_FOREVER);
+    for (int i = 0; i < FATFS_EXT_CLMT_POOL_SLOTS; i++) {
+        if (clmt_pool[i].owner == NULL) {
+            clmt_pool[i].owner = fp;
+            tbl = clmt_pool[i].tbl;
+            break;
+        }
+    }
+    k_mutex_unlock(&clmt_lock);
+
+    return tbl;
+}
+
+/* fp 使用的是调用方提供的 CLMT 时什么也不做 */
+static void clmt_free(FIL *fp)
+{
+    k_mutex_lock(&clmt_lock, K_FOREVER);
+    for (int i = 0; i < FATFS_EXT_CLMT_POOL_SLOTS; i++) {
+        if (clmt_pool[i].owner == fp) {
+            clmt_pool[i].owner = NULL;
+            break;
+        }
+    }
+    k_mutex_unlock(&clmt_lock);
+}
+#endif
+
+int fatfs_ext_fastseek_enable(struct fs_file_t *zfp, uint32_t *clmt, size_t clmt_words)
+{
+#if FF_USE_FASTSEEK
+    FIL *fp = file_to_fil(zfp);
+    DWORD *tbl = (DWORD *)clmt;
+    FRESULT res;
+
+    if (fp == NULL) {
+        return -ENOTSUP;
+    }
+    if (fp->cltbl != NULL) {
+        return -EBUSY;
+    }
+
+    if (tbl == NULL) {
+        tbl = clmt_alloc(fp);
+        if (tbl == NULL) {
+            printk("fatfs_ext: CLMT pool (%d slots) exhausted\n", FATFS_EXT_CLMT_POOL_SLOTS);
+            return -ENOMEM;
+        }
+        clmt_words = FATFS_EXT_CLMT_WORDS;
+    }
+    if (clmt_words < 4) {
+        clmt_free(fp);
+        return -ENOMEM;
+    }
+
+    /* tbl[0] 输入 CLMT 大小，成功后是实际使用的大小; FR_NOT_ENOUGH_CORE 时是需要的大小 */
+    tbl[0] = clmt_words;
+    fp->cltbl = tbl;
+    res = f_lseek(fp, CREATE_LINKMAP);
+    if (res != FR_OK) {
+        if (res == FR_NOT_ENOUGH_CORE) {
+            printk("fatfs_ext: CLMT needs %u words, only %u\n", tbl[0], (uint32_t)clmt_words);
+        }
+        fp->cltbl = NULL;
+        clmt_free(fp);
+        return translate_error(res);
+    }
+
+    return 0;
+#else
+    ARG_UNUSED(zfp);
+    ARG_UNUSED(clmt);
+    ARG_UNUSED(clmt_words);
+    return -ENOTSUP;
+#endif
+}
+
+int fatfs_ext_fastseek_disable(struct fs_file_t *zfp)
+{
+#if FF_USE_FASTSEEK
+    FIL *fp = file_to_fil(zfp);
+
+    if (fp == NULL) {
+        return -ENOTSUP;
+    }
+    if (fp->cltbl != NULL) {
+        fp->cltbl = NULL;
+        clmt_free(fp);
+    }
+    return 0;
+#else
+    ARG_UNUSED(zfp);
+    return -ENOTSUP;
+#endif
+}
+
+int fatfs_ext_fastseek_fragments(struct fs_file_t *zfp)
+{
+#if FF_USE_FASTSEEK
+    FIL *fp = file_to_fil(zfp);
+
+    if (fp == NULL || fp->cltbl == NULL) {
+        return 0;
+    }
+    return (fp->cltbl[0] - 1) / 2;
+#else
+    ARG_UNUSED(zfp);
+    return 0;
+#endif
+}
+
+int fatfs_ext_preallocate(struct fs_file_t *zfp, uint32_t size)
+{
+#if FF_USE_EXPAND
+    FIL *fp = file_to_fil(zfp);
+    FRESULT res;
+
+    if (fp == NULL) {
+        return -ENOTSUP;
+    }
+    if (f_size(fp) != 0) {
+        return -EINVAL;
+    }
+    if (size == 0) {
+        return 0;
+    }
+
+    /* opt = 1: 立即分配并写入 FAT 链 */
+    res = f_expand(fp, size, 1);
+    if (res == FR_DENIED) {
+        /* 文件为空时 FR_DENIED 表示没有足够大的连续空闲空间 */
+        return -ENOSPC;
+    }
+    return translate_error(res);
+#else
+    ARG_UNUSED(zfp);
+    ARG_UNUSED(size);
+    return -ENOTSUP;
+#endif
+}
+
+int fatfs_ext_close(struct fs_file_t *zfp)
+{
+    if (file_to_fil(zfp) != NULL) {
+        (void)fatfs_ext_fastseek_disable(zfp);
+    }
+    return fs_close(zfp);
+}
+
+#if FF_MAX_SS == FF_MIN_SS
+#define FS_SECTOR_SIZE(fs)  ((uint32_t)FF_MAX_SS)
+#else
+#define FS_SECTOR_SIZE(fs)  ((uint32_t)(fs)->ssize)
+#endif
+
+/* FatFs 中表示空闲 cluster 数无效的值 */
+#define FREE_CLST_UNKNOWN   (0xFFFFFFFF)
+
+struct fsinfo_verify {
+    FATFS *fs;
+    WORD id;                /* 挂载的 id, 重新挂载后变化 */
+    DWORD start_free;       /* apply 时的 free_clst / last_clst, 用于判断扫描期间卷是否被修改 */
+    DWORD start_last;
+    LBA_t base;             /* 扫描的范围: FAT 表 (exFAT 为分配位图) 的第一个扇区和扇区数 */
+    uint32_t sectors;
+    atomic_t fat_writes;    /* 扫描期间写入扫描范围的次数 */
+    volatile bool cancel;
+    bool running;           /* 线程已创建, 还没有 join */
+    struct fatfs_ext_fsinfo_status status;
+};
+
+static struct fsinfo_verify verify;
+static K_MUTEX_DEFINE(verify_lock);
+static struct k_thread verify_thread;
+static K_THREAD_STACK_DEFINE(verify_stack, FATFS_EXT_FSINFO_STACK_SIZE);
+static uint8_t scan_buf[FATFS_EXT_FSINFO_SCAN_SECTORS * FF_MAX_SS] __aligned(4);
+
+/* buf 中空闲的表项数; off 为 buf 在 FAT 表 (exFAT 为分配位图) 中的字节偏移 */
+static uint32_t count_free(const FATFS *fs, const uint8_t *buf, uint64_t off, uint32_t len)
+{
+    uint32_t n = 0;
+
+#if FF_FS_EXFAT
+    if (fs->fs_type == FS_EXFAT) {
+        /* 位图从 cluster 2 开始, 每个 cluster 一位, 0 为空闲 */
+        uint64_t bits = fs->n_fatent - 2;
+
+        for (uint32_t i = 0; i < len && (off + i) * 8 < bits; i++) {
+            uint64_t left = bits - (off + i) * 8;
+            uint8_t v = buf[i];
+
+            if (left < 8) {
+                v |= (uint8_t)(0xFF << left);
+            }
+            n += 8 - POPCOUNT(v);
+        }
+        return n;
+    }
+#endif
+
+    uint32_t esz = (fs->fs_type == FS_FAT32) ? 4 : 2;
+
+    for (uint32_t i = 0; i < len; i += esz) {
+        uint64_t e = (off + i) / esz;
+
+        /* 表项 0 和 1 是保留的 */
+        if (e < 2) {
+            continue;
+        }
+        if (e >= fs->n_fatent) {
+            break;
+        }
+        if (esz == 4) {
+            n += (sys_get_le32(buf + i) & 0x0FFFFFFF) == 0;
+        } else {
+            n += sys_get_le16(buf + i) == 0;
+        }
+    }
+    return n;
+}
+
+/*
+ * FatFs 修改 FAT 表 (exFAT 为分配位图) 时先改 FAT 窗口 (fs->win, wflag 置位)，写回时经过
+ * disk_write。扫描时没有持有卷锁, FSINFO 无效时 FatFs 也不维护 free_clst (释放 cluster 后
+ * free_clst、last_clst 都不变), 所以这里直接统计扫描期间写入扫描范围的次数。
+ */
+DRESULT __real_disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count);
+DRESULT __wrap_disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count);
+
+DRESULT __wrap_disk_write(BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count)
+{
+    FATFS *fs = verify.fs;
+
+    if (verify.status.result == FATFS_EXT_VERIFY_RUNNING && fs != NULL && pdrv == fs->pdrv &&
+        sector < verify.base + verify.sectors && verify.base < sector + count) {
+        atomic_inc(&verify.fat_writes);
+    }
+    return __real_disk_write(pdrv, buff, sector, count);
+}
+
+/*
+ * 卷没有被修改时才采用扫描结果: 扫描期间没有写入过 FAT 表, FAT 窗口中也没有没写回的修改。
+ * free_clst / last_clst 变化 (FSINFO 有效时分配和释放都会修改) 时同样作废。
+ */
+static void verify_commit(uint32_t free_count)
+{
+    FATFS *fs = verify.fs;
+    struct fatfs_ext_fsinfo_status *st = &verify.status;
+
+    st->scan_free = free_count;
+#if FF_FS_REENTRANT
+    if (!ff_mutex_take(fs->ldrv)) {
+        st->result = FATFS_EXT_VERIFY_BUSY;
+        return;
+    }
+#else
+    k_sched_lock();
+#endif
+    if (fs->fs_type == 0 || fs->id != verify.id || atomic_get(&verify.fat_writes) != 0 ||
+        fs->free_clst != verify.start_free || fs->last_clst != verify.start_last || fs->wflag != 0) {
+        st->result = FATFS_EXT_VERIFY_BUSY;
+    } else if (fs->free_clst == free_count) {
+        st->result = FATFS_EXT_VERIFY_MATCH;
+    } else {
+        /* 与 f_getfree 扫描之后相同: FAT32 卷下一次 sync 时写回 FSINFO */
+        fs->free_clst = free_count;
+        fs->fsi_flag |= 1;
+        st->result = FATFS_EXT_VERIFY_CORRECTED;
+    }
+#if FF_FS_REENTRANT
+    ff_mutex_give(fs->ldrv);
+#else
+    k_sched_unlock();
+#endif
+}
+
+static void verify_entry(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    FATFS *fs = verify.fs;
+    struct fatfs_ext_fsinfo_status *st = &verify.status;
+    uint32_t ss = FS_SECTOR_SIZE(fs);
+    int64_t start_ms = k_uptime_get();
+    uint32_t free_count = 0;
+    LBA_t base = verify.base;
+    uint32_t sectors = verify.sectors;
+
+    for (uint32_t sect = 0; sect < sectors; ) {
+        uint32_t n = MIN(FATFS_EXT_FSINFO_SCAN_SECTORS, sectors - sect);
+
+        if (verify.cancel) {
+            st->result = FATFS_EXT_VERIFY_CANCELED;
+            goto out;
+        }
+        if (disk_read(fs->pdrv, scan_buf, base + sect, n) != RES_OK) {
+            st->result = FATFS_EXT_VERIFY_ERROR;
+            goto out;
+        }
+        free_count += count_free(fs, scan_buf, (uint64_t)sect * ss, n * ss);
+        st->scan_sectors += n;
+        sect += n;
+    }
+    verify_commit(free_count);
+
+out:
+    st->scan_ms = (uint32_t)(k_uptime_get() - start_ms);
+#if defined(CONFIG_INIT_STACKS) && defined(CONFIG_THREAD_STACK_INFO)
+    size_t unused;
+
+    if (k_thread_stack_space_get(k_current_get(), &unused) == 0) {
+        st->stack_unused = unused;
+    }
+#endif
+}
+
+void fatfs_ext_fsinfo_cancel(void)
+{
+    k_mutex_lock(&verify_lock, K_FOREVER);
+    if (verify.running) {
+        verify.cancel = true;
+        (void)k_thread_join(&verify_thread, K_FOREVER);
+        verify.running = false;
+    }
+    k_mutex_unlock(&verify_lock);
+}
+
+int fatfs_ext_fsinfo_apply(struct fs_mount_t *mp, enum fatfs_ext_fsinfo_policy policy)
+{
+    struct fatfs_ext_fsinfo_status *st = &verify.status;
+    uint64_t bytes;
+    FATFS *fs;
+
+    if (mp == NULL || mp->type != FS_FATFS || mp->fs_data == NULL) {
+        return -ENOTSUP;
+    }
+    if (policy > FATFS_EXT_FSINFO_VERIFY) {
+        return -EINVAL;
+    }
+
+    fatfs_ext_fsinfo_cancel();
+
+    k_mutex_lock(&verify_lock, K_FOREVER);
+    fs = mp->fs_data;
+    memset(st, 0, sizeof(*st));
+    st->policy = policy;
+    st->clusters = fs->n_fatent - 2;
+    /* 挂载时 FatFs 只从 FAT32 的 FSINFO 读取空闲 cluster 数, 其它情况为无效值 */
+    st->fsinfo_valid = fs->free_clst <= fs->n_fatent - 2;
+    st->fsinfo_free = st->fsinfo_valid ? fs->free_clst : 0;
+
+    if (policy == FATFS_EXT_FSINFO_SCAN) {
+        fs->free_clst = FREE_CLST_UNKNOWN;
+    }
+    /* FAT12 的卷很小, 扫描本来就很快 */
+    if (policy != FATFS_EXT_FSINFO_VERIFY || fs->fs_type == FS_FAT12) {
+        k_mutex_unlock(&verify_lock);
+        return 0;
+    }
+
+#if FF_FS_EXFAT
+    if (fs->fs_type == FS_EXFAT) {
+        verify.base = fs->bitbase;
+        bytes = ((uint64_t)fs->n_fatent - 2 + 7) / 8;
+    } else
+#endif
+    {
+        verify.base = fs->fatbase;
+        bytes = (uint64_t)fs->n_fatent * ((fs->fs_type == FS_FAT32) ? 4 : 2);
+    }
+    verify.sectors = (uint32_t)((bytes + FS_SECTOR_SIZE(fs) - 1) / FS_SECTOR_SIZE(fs));
+    verify.fs = fs;
+    verify.id = fs->id;
+    verify.start_free = fs->free_clst;
+    verify.start_last = fs->last_clst;
+    atomic_clear(&verify.fat_writes);
+    verify.cancel = false;
+    st->result = FATFS_EXT_VERIFY_RUNNING;
+    k_thread_create(&verify_thread, verify_stack, K_THREAD_STACK_SIZEOF(verify_stack),
+        verify_entry, NULL, NULL, NULL, FATFS_EXT_FSINFO_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&verify_thread, "fatfs_fsinfo");
+    verify.running = true;
+    k_mutex_unlock(&verify_lock);
+    return 0;
+}
+
+int fatfs_ext_fsinfo_wait(k_timeout_t timeout, struct fatfs_ext_fsinfo_status *status)
+{
+    int rc = 0;
+
+    k_mutex_lock(&verify_lock, K_FOREVER);
+    if (verify.running) {
+        if (k_thread_join(&verify_thread, timeout) == 0) {
+            verify.running = false;
+        } else {
+            rc = -EAGAIN;
+        }
+    }
+    if (status != NULL) {
+        *status = verify.status;
+    }
+    k_mutex_unlock(&verify_lock);
+    return rc;
+}
@@ -0,0 +1,16 @@
+# Copyright (c) 2024 Realtek Semiconductor Corp.
+# SPDX-License-Identifier: Apache-2.0
+#
+# 通过 Zephyr fs API 打开的 FatFs 文件的扩展功能, 在 app 的 CMakeLists.txt 中 find_package(Zephyr) 之后 include
+
+set(FATFS_EXT_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+target_include_directories(app PRIVATE ${FATFS_EXT_DIR})
+target_sources(app PRIVATE
+    ${FATFS_EXT_DIR}/fatfs_ext.c
+)
+
+# 后台校验 FSINFO 时统计 FatFs 写入 FAT 表的次数, 扫描期间 FAT 表被修改时丢弃扫描结果
+zephyr_ld_options(
+    -Wl,--wrap=disk_write
+)
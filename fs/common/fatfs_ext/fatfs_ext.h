@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Zephyr fs API 没有提供的 FatFs 功能
+ *
+ * 参数是 fs_open() 打开的 struct fs_file_t，文件必须在 FS_FATFS 类型的挂载点上，
+ * 否则返回 -ENOTSUP。Zephyr 的 fat_fs.c 中 fs_file_t.filep 就是 FatFs 的 FIL。
+ *
+ * fast seek: FatFs 默认在 f_lseek 向后移动时从文件的第一个 cluster 开始沿 FAT 链查找，
+ * 耗时与偏移成正比。打开 fast seek 后，f_lseek 使用 cluster link map table (CLMT)
+ * 直接定位，耗时与偏移无关。需要 FatFs 配置 FF_USE_FASTSEEK = 1，否则返回 -ENOTSUP。
+ * 限制: fast seek 期间文件不能变大 (FatFs 的限制)，适合只读或原位改写的文件。
+ *
+ * 预分配: 用 f_expand 给空文件一次分配一段连续的 cluster 并写好 FAT 链，之后的写入
+ * 不再分配 cluster、不再修改 FAT 表。需要 FatFs 配置 FF_USE_EXPAND = 1。
+ * 预分配的文件只有一个片段，再打开 fast seek (4 个 word 的 CLMT) 后写入时也不再读 FAT 表。
+ *
+ * 空闲 cluster 数: fs_statvfs 调用 f_getfree, 挂载后没有有效的空闲 cluster 数时扫描整个 FAT
+ * (exFAT 为分配位图)，大容量卡需要几秒。FAT32 的 FSINFO 扇区中保存了上次的空闲 cluster 数，
+ * FatFs 挂载时读取，之后在分配/释放 cluster 时增量维护，sync 时写回 FSINFO。
+ * fatfs_ext_fsinfo_apply() 在挂载后选择是否信任 FSINFO, 以及是否在低优先级线程中
+ * 不持有 FatFs 的卷锁扫描 FAT 校验 (或在 FSINFO 无效时提前算好)，前台的 fs_statvfs 不需要等待。
+ */
+#ifndef FATFS_EXT_H_
+#define FATFS_EXT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/kernel.h>
+
+/* CLMT 池: 最多同时有多少个文件从池中分配 CLMT */
+#ifndef FATFS_EXT_CLMT_POOL_SLOTS
+#define FATFS_EXT_CLMT_POOL_SLOTS   (2)
+#endif
+
+/* 池中每个 CLMT 的大小 (32bit word)，可以描述 (words - 1) / 2 个不连续的 cluster 片段 */
+#ifndef FATFS_EXT_CLMT_WORDS
+#define FATFS_EXT_CLMT_WORDS        (64)
+#endif
+
+/* 后台校验线程: 优先级、栈大小、每次读取的扇区数 (静态 buffer 占 扇区数 * FF_MAX_SS 字节) */
+#ifndef FATFS_EXT_FSINFO_PRIORITY
+#define FATFS_EXT_FSINFO_PRIORITY       (K_LOWEST_APPLICATION_THREAD_PRIO)
+#endif
+
+/* 扫描用 disk_read 经过 diskio、disk_cache 到 SD 卡驱动, 与其它访问 SD 卡的线程相同 */
+#ifndef FATFS_EXT_FSINFO_STACK_SIZE
+#define FATFS_EXT_FSINFO_STACK_SIZE     (2048)
+#endif
+
+#ifndef FATFS_EXT_FSINFO_SCAN_SECTORS
+#define FATFS_EXT_FSINFO_SCAN_SECTORS   (8)
+#endif
+
+enum fatfs_ext_fsinfo_policy {
+    /* 不信任 FSINFO, 挂载后第一次 fs_statvfs 扫描 (与 FatFs 配置 FF_FS_NOFSINFO = 1 相同) */
+    FATFS_EXT_FSINFO_SCAN,
+    /* 信任 FSINFO 的空闲 cluster 数 (FatFs 的默认行为) */
+    FATFS_EXT_FSINFO_TRUST,
+    /* 信任 FSINFO, 同时在后台扫描校验; 不一致时以扫描结果为准并写回 FSINFO */
+    FATFS_EXT_FSINFO_VERIFY,
+};
+
+enum fatfs_ext_verify_result {
+    FATFS_EXT_VERIFY_NONE,      /* 没有校验 (SCAN/TRUST, 或不支持的 FAT 类型) */
+    FATFS_EXT_VERIFY_RUNNING,
+    FATFS_EXT_VERIFY_MATCH,     /* 与 FSINFO 一致 */
+    FATFS_EXT_VERIFY_CORRECTED, /* 不一致 (或 FSINFO 无效)，已改为扫描结果 */
+    FATFS_EXT_VERIFY_BUSY,      /* 扫描期间 FAT 表被修改或 FatFs 已自己扫描，结果丢弃 */
+    FATFS_EXT_VERIFY_CANCELED,
+    FATFS_EXT_VERIFY_ERROR,     /* 读磁盘失败 */
+};
+
+struct fatfs_ext_fsinfo_status {
+    enum fatfs_ext_fsinfo_policy policy;
+    bool fsinfo_valid;          /* 挂载后有有效的空闲 cluster 数 (来自 FSINFO) */
+    uint32_t fsinfo_free;       /* 挂载后的空闲 cluster 数, fsinfo_valid 时有效 */
+    uint32_t clusters;          /* 数据区的 cluster 总数 */
+    enum fatfs_ext_verify_result result;
+    uint32_t scan_free;         /* 扫描得到的空闲 cluster 数, MATCH/CORRECTED/BUSY 时有效 */
+    uint32_t scan_sectors;      /* 扫描读取的扇区数 */
+    uint32_t scan_ms;           /* 扫描耗时 (包括被其它线程抢占的时间) */
+    uint32_t stack_unused;      /* 校验线程栈从未用到的字节数, 需要 CONFIG_INIT_STACKS (例如
+                                   CONFIG_THREAD_ANALYZER), 否则为 0 */
+};
+
+/**
+ * @brief 打开文件的 fast seek 模式
+ *
+ * @param zfp 已打开的文件
+ * @param clmt 调用方提供的 CLMT, 在 fast seek 关闭前必须一直有效; NULL 表示从池中分配
+ * @param clmt_words clmt 的大小 (32bit word), clmt 为 NULL 时忽略
+ *
+ * @return 0 成功; -ENOTSUP 不是 FatFs 文件或没有打开 FF_USE_FASTSEEK;
+ *         -ENOMEM CLMT 太小 (文件碎片太多) 或池已用完; -EBUSY 已经打开; 其它负数为 errno
+ */
+int fatfs_ext_fastseek_enable(struct fs_file_t *zfp, uint32_t *clmt, size_t clmt_words);
+
+/* 关闭 fast seek 模式，归还从池中分配的 CLMT */
+int fatfs_ext_fastseek_disable(struct fs_file_t *zfp);
+
+/* fast seek 模式下，CLMT 描述的 cluster 片段数; 未打开时返回 0 */
+int fatfs_ext_fastseek_fragments(struct fs_file_t *zfp);
+
+/**
+ * @brief 给空文件预分配连续空间
+ *
+ * 成功后文件大小就是 size，没写到的部分内容不确定。
+ *
+ * @param zfp 以 FS_O_WRITE 打开的空文件
+ * @param size 预分配的字节数
+ *
+ * @return 0 成功; -ENOTSUP 不是 FatFs 文件或没有打开 FF_USE_EXPAND;
+ *         -EINVAL 文件不是空的; -ENOSPC 没有足够大的连续空闲空间; 其它负数为 errno
+ */
+int fatfs_ext_preallocate(struct fs_file_t *zfp, uint32_t size);
+
+/**
+ * @brief 关闭文件
+ *
+ * 先关闭 fast seek 等扩展功能并归还资源，再调用 fs_close()。
+ * 用过本文件中扩展功能的文件应该用它代替 fs_close()。
+ */
+int fatfs_ext_close(struct fs_file_t *zfp);
+
+/**
+ * @brief 挂载后应用 FSINFO 空闲 cluster 数的信任策略
+ *
+ * 必须在 fs_mount() 成功之后、其它线程访问该卷之前调用。同一时间只有一个卷能后台校验，
+ * 上一次的校验没有结束时先取消。
+ *
+ * @param mp 已挂载的 FS_FATFS 挂载点
+ *
+ * @return 0 成功; -ENOTSUP 不是 FatFs 挂载点; -EINVAL policy 无效; 其它负数为 errno
+ */
+int fatfs_ext_fsinfo_apply(struct fs_mount_t *mp, enum fatfs_ext_fsinfo_policy policy);
+
+/**
+ * @brief 等待后台校验结束并获取状态
+ *
+ * @return 0 成功 (没有后台校验时立即返回); -EAGAIN 超时, status 为当前状态
+ */
+int fatfs_ext_fsinfo_wait(k_timeout_t timeout, struct fatfs_ext_fsinfo_status *status);
+
+/* 取消后台校验并等待线程退出; fs_unmount() 之前必须调用 */
+void fatfs_ext_fsinfo_cancel(void);
+
+#endif /* FATFS_EXT_H_ */
@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "flash_io_stats.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/printk.h>
+
+/* 链接器 --wrap 之后，__real_xxx 是原来的实现 */
+int __real_flash_area_read(const struct flash_area *fa, off_t off, void *dst, size_t len);
+int __real_flash_area_write(const struct flash_area *fa, off_t off, const void *src, size_t len);
+int __real_flash_area_erase(const struct flash_area *fa, off_t off, size_t len);
+int __real_flash_area_flatten(const struct flash_area *fa, off_t off, size_t len);
+
+int __wrap_flash_area_read(const struct flash_area *fa, off_t off, void *dst, size_t len);
+int __wrap_flash_area_write(const struct flash_area *fa, off_t off, const void *src, size_t len);
+int __wrap_flash_area_erase(const struct flash_area *fa, off_t off, size_t len);
+int __wrap_flash_area_flatten(const struct flash_area *fa, off_t off, size_t len);
+
+static struct flash_io_stats part_stats[FLASH_IO_STATS_PARTITIONS_MAX];
+static uint32_t part_count;
+static struct k_spinlock stats_lock;
+
+/* 按块统计擦除次数, 受 stats_lock 保护 */
+static uint8_t wear_fa_id;
+static uint32_t wear_block_size;    /* 0: 没有跟踪 */
+static uint32_t wear_blocks;
+static uint32_t wear_counts[FLASH_IO_WEAR_BLOCKS_MAX];
+static uint32_t wear_base[FLASH_IO_WEAR_BLOCKS_MAX];
+/* flash_io_wear_print() 使用的快照，避免占用调用方的栈 */
+static uint32_t wear_view[FLASH_IO_WEAR_BLOCKS_MAX];
+
+/* 擦除次数分布: [0], [1], [2, 3], [4, 7], ... */
+#define WEAR_HIST_BUCKETS   (18)
+
+static const char *const op_names[FLASH_IO_OP_COUNT] = {
+    [FLASH_IO_READ] = "read",
+    [FLASH_IO_WRITE] = "write",
+    [FLASH_IO_ERASE] = "erase",
+};
+
+static void record(const struct flash_area *fa, enum flash_io_op op, size_t len,
+                   uint64_t start_cycles, int rc)
+{
+    uint64_t cycles = k_cycle_get_64() - start_cycles;
+    struct flash_io_stats *s = NULL;
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+    for (uint32_t i = 0; i < part_count; i++) {
+        if (part_stats[i].fa_id == fa->fa_id) {
+            s = &part_stats[i];
+            break;
+        }
+    }
+    if (s == NULL && part_count < FLASH_IO_STATS_PARTITIONS_MAX) {
+        s = &part_stats[part_count++];
+        s->fa_id = fa->fa_id;
+    }
+
+    /* 分区太多时不统计 */
+    if (s != NULL) {
+        struct flash_io_counter *c = &s->op[op];
+        c->ops++;
+        c->cycles += cycles;
+        if (rc < 0) {
+            c->errors++;
+        } else {
+            c->bytes += len;
+        }
+    }
+
+    k_spin_unlock(&stats_lock, key);
+}
+
+static void wear_record(const struct flash_area *fa, off_t off, size_t len)
+{
+    k_spinlock_key_t key;
+
+    if (len == 0) {
+        return;
+    }
+
+    key = k_spin_lock(&stats_lock);
+    if (wear_block_size != 0 && fa->fa_id == wear_fa_id) {
+        uint32_t first = off / wear_block_size;
+        uint32_t last = (off + len - 1) / wear_block_size;
+        for (uint32_t b = first; b <= last && b < wear_blocks; b++) {
+            wear_counts[b]++;
+        }
+    }
+    k_spin_unlock(&stats_lock, key);
+}
+
+int __wrap_flash_area_read(const struct flash_area *fa, off_t off, void *dst, size_t len)
+{
+    uint64_t start_cycles = k_cycle_get_64();
+    int rc = __real_flash_area_read(fa, off, dst, len);
+
+    record(fa, FLASH_IO_READ, len, start_cycles, rc);
+    return rc;
+}
+
+int __wrap_flash_area_write(const struct flash_area *fa, off_t off, const void *src, size_t len)
+{
+    uint64_t start_cycles = k_cycle_get_64();
+    int rc = __real_flash_area_write(fa, off, src, len);
+
+    record(fa, FLASH_IO_WRITE, len, start_cycles, rc);
+    return rc;
+}
+
+int __wrap_flash_area_erase(const struct flash_area *fa, off_t off, size_t len)
+{
+    uint64_t start_cycles = k_cycle_get_64();
+    int rc = __real_flash_area_erase(fa, off, len);
+
+    record(fa, FLASH_IO_ERASE, len, start_cycles, rc);
+    if (rc == 0) {
+        wear_record(fa, off, len);
+    }
+    return rc;
+}
+
+int __wrap_flash_area_flatten(const struct flash_area *fa, off_t off, size_t len)
+{
+    uint64_t start_cycles = k_cycle_get_64();
+    int rc = __real_flash_area_flatten(fa, off, len);
+
+    record(fa, FLASH_IO_ERASE, len, start_cycles, rc);
+    if (rc == 0) {
+        wear_record(fa, off, len);
+    }
+    return rc;
+}
+
+int flash_io_stats_get(uint8_t fa_id, struct flash_io_stats *stats)
+{
+    int rc = -ENOENT;
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+    memset(stats, 0, sizeof(*stats));
+    stats->fa_id = fa_id;
+    for (uint32_t i = 0; i < part_count; i++) {
+        if (part_stats[i].fa_id == fa_id) {
+            *stats = part_stats[i];
+            rc = 0;
+            break;
+        }
+    }
+
+    k_spin_unlock(&stats_lock, key);
+    return rc;
+}
+
+void flash_io_stats_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+    memset(part_stats, 0, sizeof(part_stats));
+    part_count = 0;
+
+    k_spin_unlock(&stats_lock, key);
+}
+
+void flash_io_stats_print(void)
+{
+    struct flash_io_stats snapshot[FLASH_IO_STATS_PARTITIONS_MAX];
+    uint32_t count;
+    uint64_t cycles_per_sec = sys_clock_hw_cycles_per_sec();
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+    count = part_count;
+    memcpy(snapshot, part_stats, sizeof(snapshot));
+
+    k_spin_unlock(&stats_lock, key);
+
+    for (uint32_t i = 0; i < count; i++) {
+        for (int op = 0; op < FLASH_IO_OP_COUNT; op++) {
+            const struct flash_io_counter *c = &snapshot[i].op[op];
+            if (c->ops == 0) {
+                continue;
+            }
+            printk("flash_area %u %-5s: %8u ops, %10llu bytes, %8llu us, %u errors\n",
+                snapshot[i].fa_id, op_names[op], c->ops, c->bytes,
+                c->cycles * 1000000ULL / cycles_per_sec, c->errors);
+        }
+    }
+}
+
+int flash_io_wear_track(uint8_t fa_id, uint32_t block_size, uint32_t block_count)
+{
+    k_spinlock_key_t key;
+
+    if (block_size == 0 || block_count == 0 || block_count > FLASH_IO_WEAR_BLOCKS_MAX) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&stats_lock);
+    wear_fa_id = fa_id;
+    wear_block_size = block_size;
+    wear_blocks = block_count;
+    memset(wear_counts, 0, sizeof(wear_counts));
+    memset(wear_base, 0, sizeof(wear_base));
+    k_spin_unlock(&stats_lock, key);
+
+    return 0;
+}
+
+void flash_io_wear_mark(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+    memcpy(wear_base, wear_counts, sizeof(wear_base));
+
+    k_spin_unlock(&stats_lock, key);
+}
+
+/* 复制擦除次数到 out, 返回块数 */
+static uint32_t wear_copy(bool since_mark, uint32_t *out)
+{
+    uint32_t blocks;
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+    blocks = (wear_block_size != 0) ? wear_blocks : 0;
+    for (uint32_t b = 0; b < blocks; b++) {
+        out[b] = since_mark ? wear_counts[b] - wear_base[b] : wear_counts[b];
+    }
+
+    k_spin_unlock(&stats_lock, key);
+    return blocks;
+}
+
+static void wear_summarize(const uint32_t *counts, uint32_t blocks, struct flash_io_wear_summary *sum)
+{
+    memset(sum, 0, sizeof(*sum));
+    sum->blocks = blocks;
+    sum->min = UINT32_MAX;
+    for (uint32_t b = 0; b < blocks; b++) {
+        sum->total += counts[b];
+        sum->erased_blocks += (counts[b] != 0);
+        sum->min = MIN(sum->min, counts[b]);
+        sum->max = MAX(sum->max, counts[b]);
+    }
+    if (blocks == 0) {
+        sum->min = 0;
+        return;
+    }
+    sum->avg_x100 = (uint64_t)sum->total * 100 / blocks;
+}
+
+int flash_io_wear_summary_get(bool since_mark, struct flash_io_wear_summary *sum)
+{
+    uint32_t blocks = wear_copy(since_mark, wear_view);
+
+    wear_summarize(wear_view, blocks, sum);
+    return (blocks == 0) ? -ENODEV : 0;
+}
+
+void flash_io_wear_print(bool since_mark, uint32_t top_n)
+{
+    struct flash_io_wear_summary sum;
+    uint32_t hist[WEAR_HIST_BUCKETS] = {0};
+    uint32_t blocks = wear_copy(since_mark, wear_view);
+
+    if (blocks == 0) {
+        printk("wear: not tracked\n");
+        return;
+    }
+
+    wear_summarize(wear_view, blocks, &sum);
+    printk("wear%s (flash_area %u, %u blocks x %u bytes): erased %u blocks, %u erases; "
+            "min %u, avg %u.%.2u, max %u, spread %u\n",
+        since_mark ? " delta" : "", wear_fa_id, blocks, wear_block_size,
+        sum.erased_blocks, sum.total, sum.min, sum.avg_x100 / 100, sum.avg_x100 % 100,
+        sum.max, sum.max - sum.min);
+
+    for (uint32_t b = 0; b < blocks; b++) {
+        uint32_t bucket = 0;
+        /* bucket i (i > 0) 对应 [2^(i-1), 2^i - 1] */
+        for (uint32_t v = wear_view[b]; v != 0 && bucket < WEAR_HIST_BUCKETS - 1; v >>= 1) {
+            bucket++;
+        }
+        hist[bucket]++;
+    }
+    printk("wear histogram (erases: blocks):");
+    for (uint32_t i = 0; i < WEAR_HIST_BUCKETS; i++) {
+        if (hist[i] == 0) {
+            continue;
+        }
+        if (i <= 1) {
+            printk(" [%u]: %u", i, hist[i]);
+        } else if (i == WEAR_HIST_BUCKETS - 1) {
+            printk(" [%u+]: %u", 1U << (i - 1), hist[i]);
+        } else {
+            printk(" [%u-%u]: %u", 1U << (i - 1), (1U << i) - 1, hist[i]);
+        }
+    }
+    printk("\n");
+
+    /* 每次选出剩下的最大值，选过的清零; top_n 很小，不需要排序 */
+    printk("most worn blocks (block: erases):");
+    for (uint32_t n = 0; n < top_n; n++) {
+        uint32_t worst = 0;
+        for (uint32_t b = 1; b < blocks; b++) {
+            if (wear_view[b] > wear_view[worst]) {
+                worst = b;
+            }
+        }
+        if (wear_view[worst] == 0) {
+            break;
+        }
+        printk(" %u: %u", worst, wear_view[worst]);
+        wear_view[worst] = 0;
+    }
+    printk("\n");
+}
@@ -0,0 +1,19 @@
+# Copyright (c) 2024 Realtek Semiconductor Corp.
+# SPDX-License-Identifier: Apache-2.0
+#
+# flash_area_read/write/erase 的统计, 在 app 的 CMakeLists.txt 中 find_package(Zephyr) 之后 include
+# 通过链接器的 --wrap 替换调用, 不需要修改文件系统和 flash_map 的代码
+
+set(FLASH_IO_STATS_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+target_include_directories(app PRIVATE ${FLASH_IO_STATS_DIR})
+target_sources(app PRIVATE
+    ${FLASH_IO_STATS_DIR}/flash_io_stats.c
+)
+
+zephyr_ld_options(
+    -Wl,--wrap=flash_area_read
+    -Wl,--wrap=flash_area_write
+    -Wl,--wrap=flash_area_erase
+    -Wl,--wrap=flash_area_flatten
+)
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * flash 分区访问统计
+ *
+ * 文件系统 (LittleFS、flash disk 上的 FatFs) 通过 flash_area_read/write/erase 访问 flash，
+ * 这里用链接器的 --wrap 拦截这些调用 (见 flash_io_stats.cmake)，按分区 (fa_id)
+ * 统计字节数、次数和耗时，用于计算写放大 (设备写入字节 / fs_write 字节) 和擦除次数。
+ * flash_area_flatten 计入擦除。
+ *
+ * 另外可以对一个分区按块统计擦除次数 (磨损)，打印擦除次数分布、磨损最多的块和
+ * 磨损差距 (max - min)。统计从开机 (或 flash_io_wear_track) 开始，不保存到 flash。
+ */
+#ifndef FLASH_IO_STATS_H_
+#define FLASH_IO_STATS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* 最多统计的分区数 */
+#ifndef FLASH_IO_STATS_PARTITIONS_MAX
+#define FLASH_IO_STATS_PARTITIONS_MAX   (8)
+#endif
+
+/* 按块统计擦除次数时最多的块数 */
+#ifndef FLASH_IO_WEAR_BLOCKS_MAX
+#define FLASH_IO_WEAR_BLOCKS_MAX        (1024)
+#endif
+
+enum flash_io_op {
+    FLASH_IO_READ,
+    FLASH_IO_WRITE,
+    FLASH_IO_ERASE,
+    FLASH_IO_OP_COUNT,
+};
+
+struct flash_io_counter {
+    uint64_t bytes;
+    uint64_t cycles;    /* 累计耗时, k_cycle_get_64() */
+    uint32_t ops;
+    uint32_t errors;
+};
+
+struct flash_io_stats {
+    uint8_t fa_id;
+    struct flash_io_counter op[FLASH_IO_OP_COUNT];
+};
+
+/**
+ * @brief 获取一个分区的统计
+ *
+ * @return 0 成功; -ENOENT 该分区还没有被访问过 (stats 清零)
+ */
+int flash_io_stats_get(uint8_t fa_id, struct flash_io_stats *stats);
+
+/* 清零所有分区的统计 */
+void flash_io_stats_reset(void);
+
+/* 打印所有被访问过的分区的统计 */
+void flash_io_stats_print(void);
+
+struct flash_io_wear_summary {
+    uint32_t blocks;            /* 跟踪的块数 */
+    uint32_t erased_blocks;     /* 擦除过的块数 */
+    uint32_t total;             /* 擦除总次数 */
+    uint32_t min;
+    uint32_t max;
+    uint32_t avg_x100;          /* 平均每块擦除次数 * 100 */
+};
+
+/**
+ * @brief 开始按块统计一个分区的擦除次数, 计数清零
+ *
+ * 一次擦除覆盖多个块时，每个块都计一次。
+ *
+ * @param fa_id 分区
+ * @param block_size 块大小, 例如 LittleFS 的 block_size (擦除单位)
+ * @param block_count 块数, <= FLASH_IO_WEAR_BLOCKS_MAX
+ *
+ * @return 0 成功; -EINVAL 参数错误
+ */
+int flash_io_wear_track(uint8_t fa_id, uint32_t block_size, uint32_t block_count);
+
+/* 记录当前的擦除次数，之后 since_mark 为 true 时只统计之后的增量 */
+void flash_io_wear_mark(void);
+
+/**
+ * @brief 擦除次数汇总
+ *
+ * @param since_mark true: 自 flash_io_wear_mark() 以来的增量; false: 累计值
+ *
+ * @return 0 成功; -ENODEV 没有调用 flash_io_wear_track
+ */
+int flash_io_wear_summary_get(bool since_mark, struct flash_io_wear_summary *sum);
+
+/**
+ * @brief 打印磨损报告: 汇总、擦除次数分布 (按 2 的幂分组)、磨损最多的 top_n 个块
+ *
+ * 只能在一个线程中调用。
+ */
+void flash_io_wear_print(bool since_mark, uint32_t top_n);
+
+#endif /* FLASH_IO_STATS_H_ */
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "fs_async.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+/* 取出最多 FS_ASYNC_BATCH_MAX 个排队的请求, 保持提交顺序 */
+static size_t take_batch(struct fs_async_queue *q, struct fs_async_req **batch)
+{
+    k_spinlock_key_t key = k_spin_lock(&q->lock);
+    sys_snode_t *node;
+    size_t n = 0;
+
+    while (n < FS_ASYNC_BATCH_MAX && (node = sys_slist_get(&q->pending)) != NULL) {
+        batch[n++] = CONTAINER_OF(node, struct fs_async_req, node);
+    }
+    k_spin_unlock(&q->lock, key);
+    return n;
+}
+
+static void complete(struct fs_async_queue *q, struct fs_async_req *req)
+{
+    struct k_poll_signal *signal = req->signal;
+
+    q->stats.completed++;
+    if (req->cb != NULL) {
+        req->cb(req, req->user_data);
+    }
+    /* raise 之后等待方可能已经重用 req, 不能再访问 */
+    if (signal != NULL) {
+        k_poll_signal_raise(signal, (int)req->result);
+    }
+}
+
+/* 返回读写的字节数或负数 errno */
+static ssize_t do_io(struct fs_async_queue *q, enum fs_async_op op, struct fs_file_t *file,
+    off_t offset, void *buf, size_t len)
+{
+    int rc;
+
+    q->stats.fs_calls++;
+    rc = fs_seek(file, offset, FS_SEEK_SET);
+    if (rc < 0) {
+        return rc;
+    }
+    return (op == FS_ASYNC_WRITE) ? fs_write(file, buf, len) : fs_read(file, buf, len);
+}
+
+static bool req_overlap(const struct fs_async_req *a, const struct fs_async_req *b)
+{
+    return a->file == b->file &&
+        a->offset < b->offset + (off_t)b->len && b->offset < a->offset + (off_t)a->len;
+}
+
+static bool req_before(const struct fs_async_req *a, const struct fs_async_req *b)
+{
+    if (a->file != b->file) {
+        return (uintptr_t)a->file < (uintptr_t)b->file;
+    }
+    return a->offset < b->offset;
+}
+
+/* 插入排序，只交换相邻且范围不重叠的请求，重叠请求之间的先后不变 */
+static void sort_segment(struct fs_async_queue *q, struct fs_async_req **seg, size_t count)
+{
+    struct fs_async_req *cur;
+    size_t m;
+
+    for (size_t k = 1; k < count; k++) {
+        cur = seg[k];
+        for (m = k; m > 0 && req_before(cur, seg[m - 1]) && !req_overlap(cur, seg[m - 1]); m--) {
+            seg[m] = seg[m - 1];
+        }
+        seg[m] = cur;
+        if (m != k) {
+            q->stats.reordered++;
+        }
+    }
+}
+
+/* seg[0..count) 首尾相接, 用 merge_buf 一次读写 */
+static void run_merged(struct fs_async_queue *q, struct fs_async_req **seg, size_t count, size_t total)
+{
+    enum fs_async_op op = seg[0]->op;
+    size_t pos = 0;
+    ssize_t rc;
+
+    if (op == FS_ASYNC_WRITE) {
+        for (size_t k = 0; k < count; k++) {
+            memcpy(q->cfg.merge_buf + pos, seg[k]->buf, seg[k]->len);
+            pos += seg[k]->len;
+        }
+    }
+
+    rc = do_io(q, op, seg[0]->file, seg[0]->offset, q->cfg.merge_buf, total);
+
+    /* 读到文件尾或写满时, 前面的请求完整, 后面的请求部分或 0 字节 */
+    pos = 0;
+    for (size_t k = 0; k < count; k++) {
+        struct fs_async_req *req = seg[k];
+
+        if (rc < 0) {
+            req->result = rc;
+        } else {
+            req->result = ((size_t)rc > pos) ? MIN(req->len, (size_t)rc - pos) : 0;
+            if (op == FS_ASYNC_READ && req->result > 0) {
+                memcpy(req->buf, q->cfg.merge_buf + pos, req->result);
+            }
+        }
+        pos += req->len;
+        complete(q, req);
+    }
+}
+
+static void run_segment(struct fs_async_queue *q, struct fs_async_req **seg, size_t count)
+{
+    size_t k = 0;
+    size_t m;
+    size_t total;
+
+    while (k < count) {
+        total = seg[k]->len;
+        m = k + 1;
+        while (q->cfg.merge_buf != NULL && m < count && seg[m]->file == seg[k]->file &&
+               seg[m - 1]->offset + (off_t)seg[m - 1]->len == seg[m]->offset &&
+               total + seg[m]->len <= q->cfg.merge_buf_size) {
+            total += seg[m]->len;
+            m++;
+        }
+
+        if (m - k > 1) {
+            q->stats.merged += m - k - 1;
+            run_merged(q, &seg[k], m - k, total);
+        } else {
+            seg[k]->result = do_io(q, seg[k]->op, seg[k]->file, seg[k]->offset, seg[k]->buf, seg[k]->len);
+            complete(q, seg[k]);
+        }
+        k = m;
+    }
+}
+
+static void process_batch(struct fs_async_queue *q, struct fs_async_req **batch, size_t n)
+{
+    size_t i = 0;
+    size_t j;
+
+    while (i < n) {
+        if (batch[i]->op == FS_ASYNC_SYNC) {
+            q->stats.fs_calls++;
+            batch[i]->result = fs_sync(batch[i]->file);
+            complete(q, batch[i]);
+            i++;
+            continue;
+        }
+
+        /* 连续的同类 (读或写) 请求为一段 */
+        for (j = i + 1; j < n && batch[j]->op == batch[i]->op; j++) {
+        }
+        sort_segment(q, &batch[i], j - i);
+        run_segment(q, &batch[i], j - i);
+        i = j;
+    }
+}
+
+static void fs_async_work(struct k_work *work)
+{
+    struct fs_async_queue *q = CONTAINER_OF(work, struct fs_async_queue, work);
+    struct fs_async_req *batch[FS_ASYNC_BATCH_MAX];
+    size_t n;
+
+    while ((n = take_batch(q, batch)) > 0) {
+        q->stats.batches++;
+        q->stats.max_batch = MAX(q->stats.max_batch, n);
+        process_batch(q, batch, n);
+    }
+}
+
+int fs_async_queue_init(struct fs_async_queue *q, const struct fs_async_config *cfg)
+{
+    struct k_work_queue_config wq_cfg = {
+        .name = cfg->name,
+    };
+
+    if (cfg->stack == NULL || (cfg->merge_buf != NULL && cfg->merge_buf_size == 0)) {
+        return -EINVAL;
+    }
+
+    memset(q, 0, sizeof(*q));
+    q->cfg = *cfg;
+    sys_slist_init(&q->pending);
+    k_work_init(&q->work, fs_async_work);
+    k_work_queue_init(&q->wq);
+    k_work_queue_start(&q->wq, cfg->stack, cfg->stack_size, cfg->priority, &wq_cfg);
+    return 0;
+}
+
+int fs_async_submit(struct fs_async_queue *q, struct fs_async_req *req)
+{
+    k_spinlock_key_t key;
+
+    if (req->file == NULL || req->op > FS_ASYNC_SYNC ||
+        (req->op != FS_ASYNC_SYNC && (req->buf == NULL || req->offset < 0))) {
+        return -EINVAL;
+    }
+
+    req->result = 0;
+    if (req->signal != NULL) {
+        k_poll_signal_reset(req->signal);
+    }
+
+    key = k_spin_lock(&q->lock);
+    sys_slist_append(&q->pending, &req->node);
+    q->stats.submitted++;
+    k_spin_unlock(&q->lock, key);
+
+    (void)k_work_submit_to_queue(&q->wq, &q->work);
+    return 0;
+}
+
+void fs_async_drain(struct fs_async_queue *q)
+{
+    struct k_work_sync sync;
+
+    (void)k_work_flush(&q->work, &sync);
+}
+
+void fs_async_stats_get(struct fs_async_queue *q, struct fs_async_stats *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&q->lock);
+
+    *stats = q->stats;
+    k_spin_unlock(&q->lock, key);
+}
+
+void fs_async_stats_reset(struct fs_async_queue *q)
+{
+    k_spinlock_key_t key = k_spin_lock(&q->lock);
+
+    memset(&q->stats, 0, sizeof(q->stats));
+    k_spin_unlock(&q->lock, key);
+}
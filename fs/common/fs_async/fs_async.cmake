@@ -0,0 +1,11 @@
+# Copyright (c) 2024 Realtek Semiconductor Corp.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Zephyr fs API 之上的异步读写, 在 app 的 CMakeLists.txt 中 find_package(Zephyr) 之后 include
+
+set(FS_ASYNC_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+target_include_directories(app PRIVATE ${FS_ASYNC_DIR})
+target_sources(app PRIVATE
+    ${FS_ASYNC_DIR}/fs_async.c
+)
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Zephyr fs API 之上的异步读写
+ *
+ * 调用方填好 struct fs_async_req 后 fs_async_submit() 立即返回，请求由队列的 work queue
+ * 线程依次调用 fs_seek + fs_read/fs_write 或 fs_sync 完成，完成时先调用 req->cb，
+ * 再 raise req->signal (k_poll 等待, result 为 req->result)。signal 之后队列不再访问请求，
+ * 等待方可以立即重用它; 只有 cb 时, cb 返回后才能重用。
+ * 每个挂载点使用一个队列: 同一挂载点上的操作在文件系统内部本来就是串行的。
+ *
+ * work queue 每次取出所有排队的请求一起处理:
+ * - 以 sync 为界, 以及读写交替处，把请求分成段，段之间保持提交顺序;
+ * - 段内按 (文件, 偏移) 排序, 但范围重叠的两个请求不交换顺序;
+ * - 排序后同一文件首尾相接的请求，总长度不超过 merge_buf_size 时合并成一次 fs_read|fs_write
+ *   (经 merge_buf 复制)。
+ *
+ * 请求在完成之前不能修改, buf 必须一直有效。文件在队列中有请求时调用方不能直接访问。
+ */
+#ifndef FS_ASYNC_H_
+#define FS_ASYNC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/sys/slist.h>
+
+/* 一次最多取出处理的请求数 */
+#ifndef FS_ASYNC_BATCH_MAX
+#define FS_ASYNC_BATCH_MAX      (32)
+#endif
+
+enum fs_async_op {
+    FS_ASYNC_READ,
+    FS_ASYNC_WRITE,
+    FS_ASYNC_SYNC,
+};
+
+struct fs_async_req;
+
+/* 在 work queue 线程中、raise req->signal 之前调用 */
+typedef void (*fs_async_cb_t)(struct fs_async_req *req, void *user_data);
+
+struct fs_async_req {
+    /* 调用方填写 */
+    enum fs_async_op op;
+    struct fs_file_t *file;
+    off_t offset;               /* 读写的文件偏移, sync 时忽略 */
+    void *buf;
+    size_t len;
+    struct k_poll_signal *signal;   /* 可以为 NULL */
+    fs_async_cb_t cb;               /* 可以为 NULL */
+    void *user_data;
+
+    /* 完成后有效: 读写的字节数或负数 errno */
+    ssize_t result;
+
+    /* 内部使用 */
+    sys_snode_t node;
+};
+
+struct fs_async_config {
+    const char *name;           /* work queue 线程名 */
+    k_thread_stack_t *stack;
+    size_t stack_size;
+    int priority;
+    uint8_t *merge_buf;         /* NULL 表示不合并 */
+    size_t merge_buf_size;
+};
+
+struct fs_async_stats {
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t batches;           /* work queue 处理的批数 */
+    uint32_t max_batch;
+    uint32_t reordered;         /* 排序时移动位置的请求数 */
+    uint32_t merged;            /* 合并到前一个请求中的请求数 */
+    uint32_t fs_calls;          /* 实际调用的 fs_read/fs_write/fs_sync 次数 */
+};
+
+struct fs_async_queue {
+    struct fs_async_config cfg;
+    struct k_work_q wq;
+    struct k_work work;
+    struct k_spinlock lock;
+    sys_slist_t pending;
+    struct fs_async_stats stats;
+};
+
+/* 启动队列的 work queue 线程, 每个挂载点调用一次 */
+int fs_async_queue_init(struct fs_async_queue *q, const struct fs_async_config *cfg);
+
+/**
+ * @brief 提交请求
+ *
+ * @return 0 成功, -EINVAL 参数错误
+ */
+int fs_async_submit(struct fs_async_queue *q, struct fs_async_req *req);
+
+/* 等待已经提交的请求全部完成 */
+void fs_async_drain(struct fs_async_queue *q);
+
+void fs_async_stats_get(struct fs_async_queue *q, struct fs_async_stats *stats);
+void fs_async_stats_reset(struct fs_async_queue *q);
+
+#endif /* FS_ASYNC_H_ */
@@ -0,0 +1,2532 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "fs_perf.h"
+#include "fs_perf_perm.h"
+#include "fs_perf_port.h"
+#include "fs_perf_verify.h"
+#if __has_include("fs_async.h")
+#include "fs_async.h"
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/random/random.h>
+#include <zephyr/sys/printk.h>
+
+static const struct fs_perf_backend *cur_backend;
+static struct fs_perf_options cur_opts = FS_PERF_OPTIONS_DEFAULT;
+static uint64_t cycles_per_sec;
+
+static unsigned char grw_data_pattern;
+
+/* fs_read|write API 的 buffer 需要按介质要求对齐，例如 SD 卡的 DMA 要求 32 字节对齐，
+ 不对齐时 card_read_blocks() 会使用内部 buffer 中转，读速度大幅降低。
+ 这里按最大的对齐要求分配，所有 backend 都满足; opts.buf_misalign 不为 0 时，
+ buffer 从 buffer_area + buf_misalign 开始，用来测试不对齐的 buffer。
+ */
+static uint8_t buffer_area[FS_PERF_BLOCK_SIZE_MAX + FS_PERF_BUF_MISALIGN_MAX] __aligned(FS_PERF_BUF_ALIGN_MAX);
+static uint8_t *buffer = buffer_area;
+
+BUILD_ASSERT(FS_PERF_ITERATIONS_MAX <= FS_PERF_SAMPLES_MAX, "iterations exceed sample stats");
+
+/* 全局统计, 只保存统计的 iteration; warm-up 使用 warmup_stat */
+static struct fs_perf_stats stats[FS_PERF_ITERATIONS_MAX];
+static struct fs_perf_stats warmup_stat;
+/* 当前 case 已经统计的 iteration 数 */
+static int case_iterations;
+
+/* 单次操作耗时, 每个 case 开始时清零 */
+static struct fs_perf_hist latency[FS_PERF_OP_COUNT];
+static const char *const op_names[FS_PERF_OP_COUNT] = {
+    [FS_PERF_OP_READ] = "read",
+    [FS_PERF_OP_WRITE] = "write",
+    [FS_PERF_OP_SEEK] = "seek",
+    [FS_PERF_OP_SYNC] = "sync",
+};
+
+/* 计时循环内只记录到直方图，不打印 */
+#define LATENCY_RECORD(op, start) \
+    fs_perf_hist_record(&latency[op], k_cycle_get_64() - (start))
+
+/******************************************************************/
+/* 随机访问的顺序: 每个 case 生成一个 [0, blocks) 上的排列，写和读使用同一个排列 */
+static struct fs_perf_perm block_perm;
+
+static int random_order_prepare(struct fs_perf_config *config)
+{
+    uint32_t blocks = config->file_size_bytes / config->block_size_bytes;
+    int rc;
+
+    if (blocks == 0 || blocks * config->block_size_bytes != config->file_size_bytes) {
+        printk("ERROR: file_size %u is not a multiple of block_size %u\n",
+            config->file_size_bytes, config->block_size_bytes);
+        return -ENOTSUP;
+    }
+
+    /* seed 为 0 时随机生成，打印出来以便复现 */
+    config->seed = (cur_opts.random_seed != 0) ? cur_opts.random_seed : sys_rand32_get();
+    rc = fs_perf_perm_init(&block_perm, blocks, config->seed);
+    if (rc < 0) {
+        return -ENOTSUP;
+    }
+    printk("random order: %u blocks, seed 0x%08x\n", blocks, config->seed);
+    return 0;
+}
+
+struct offset_iter {
+    const struct fs_perf_config *config;
+    uint32_t index;
+};
+
+static void offset_iter_init(struct offset_iter *it, const struct fs_perf_config *config)
+{
+    memset(it, 0, sizeof(*it));
+    it->config = config;
+}
+
+static uint32_t offset_iter_next(struct offset_iter *it)
+{
+    return fs_perf_perm_get(&block_perm, it->index++) * it->config->block_size_bytes;
+}
+/******************************************************************/
+/* CPU 占用: 计时区间前后各采样一次，差值就是这段时间内的 CPU 消耗 */
+struct cpu_sample {
+    uint64_t busy;      /* 所有线程 (不含 idle) 运行的 cycle 数 */
+    uint64_t caller;    /* 当前线程运行的 cycle 数 */
+};
+
+/* 当前线程实际运行的 cycle 数 */
+static uint64_t thread_exec_cycles(void)
+{
+#ifdef CONFIG_THREAD_RUNTIME_STATS
+    k_thread_runtime_stats_t rt;
+
+    if (k_thread_runtime_stats_get(k_current_get(), &rt) == 0) {
+        return rt.execution_cycles;
+    }
+#endif
+    return 0;
+}
+
+static void cpu_sample(struct cpu_sample *sample)
+{
+    sample->busy = 0;
+    sample->caller = thread_exec_cycles();
+#ifdef CONFIG_SCHED_THREAD_USAGE_ALL
+    k_thread_runtime_stats_t rt;
+
+    /* total_cycles 不含 idle 线程; 中断的时间计入被打断的线程 */
+    if (k_thread_runtime_stats_all_get(&rt) == 0) {
+        sample->busy = rt.total_cycles;
+    }
+#endif
+}
+
+/* 每 MB 的 cycle 数 */
+static uint64_t cycles_per_mb(uint64_t cycles, uint64_t bytes)
+{
+    return (bytes > 0) ? cycles * 1024 * 1024 / bytes : 0;
+}
+
+/******************************************************************/
+
+/* 生成测试数据 */
+static void generate_test_data(uint8_t *buf, size_t size, uint8_t pattern)
+{
+    memset(buf, pattern&0xFF, size);
+    DCache_Clean((uint32_t)buf, size);
+}
+
+/* opts.verify 的数据 seed: 每次 iteration 不同, 读到上一次 iteration 的旧数据也能发现 */
+static uint32_t verify_seed(const struct fs_perf_config *config)
+{
+    return ((uint32_t)grw_data_pattern * 0x01000193u) ^ config->seed;
+}
+
+/* 生成文件偏移 offset 处的一个块, 返回耗时 */
+static uint64_t verify_fill_block(uint32_t len, uint32_t offset, uint32_t seed)
+{
+    uint64_t start = k_cycle_get_64();
+
+    fs_perf_verify_fill(buffer, len, offset, seed);
+    DCache_Clean((uint32_t)buffer, len);
+    return k_cycle_get_64() - start;
+}
+
+/* 检查读出的文件偏移 offset 处的一个块, 累计耗时到 *cycles */
+static int verify_check_block(uint32_t len, uint32_t offset, uint32_t seed, uint64_t *cycles)
+{
+    uint64_t start = k_cycle_get_64();
+    uint32_t bad_offset, expected, actual = 0;
+    int rc;
+
+    rc = fs_perf_verify_check(buffer, len, offset, seed, &bad_offset, &expected);
+    *cycles += k_cycle_get_64() - start;
+    if (rc < 0) {
+        /* bad_offset 按 4 字节向下对齐, 可能在块开始之前或跨过块的结尾; 块外的字节显示为 0 */
+        uint32_t from = MAX(bad_offset, offset);
+        uint32_t n = MIN(bad_offset + 4, offset + len) - from;
+
+        memcpy((uint8_t *)&actual + (from - bad_offset), buffer + (from - offset), n);
+        printk("ERROR: Data verification failed at offset %u: expected 0x%08x, read 0x%08x\n",
+            bad_offset, expected, actual);
+    }
+    return rc;
+}
+
+static uint32_t speed_kbps(uint32_t bytes, uint64_t cycles)
+{
+    if (cycles == 0) {
+        return 0;
+    }
+    return (uint32_t)(((float)bytes / 1024 * cycles_per_sec * FS_PERF_SPEED_MULTIPLIER) / cycles);
+}
+
+static int file_open_path(struct fs_file_t *file, const char *path, fs_mode_t flags)
+{
+    fs_file_t_init(file);
+    if (cur_backend->file_open != NULL) {
+        return cur_backend->file_open(file, path, flags);
+    }
+    return fs_open(file, path, flags);
+}
+
+static int test_file_open(struct fs_file_t *file, fs_mode_t flags)
+{
+    return file_open_path(file, cur_backend->test_file, flags);
+}
+
+static int test_file_close(struct fs_file_t *file)
+{
+    if (cur_backend->file_close != NULL) {
+        return cur_backend->file_close(file);
+    }
+    return fs_close(file);
+}
+
+/* 从 CPU 统计中扣除校验的耗时; 没有开启 runtime stats 时统计值为 0 */
+static uint64_t sub_verify(uint64_t cycles, uint64_t verify_cycles)
+{
+    return (cycles > verify_cycles) ? cycles - verify_cycles : 0;
+}
+
+/* 测试写入 */
+static int test_write(struct fs_perf_stats *stat)
+{
+    int rc;
+    struct fs_file_t file;
+    uint64_t start_cycles, end_cycles, op_start;
+    struct cpu_sample cpu_start, cpu_end;
+    struct offset_iter it;
+
+    uint32_t block_size = stat->config->block_size_bytes;  // buffer_size
+    uint32_t file_size = stat->config->file_size_bytes;
+    uint32_t chunk_size = -1;    // chunk size read or write each time
+    uint32_t offset = -1;
+    size_t total_written = 0;
+    uint32_t seed = verify_seed(stat->config);
+    uint64_t verify_cycles = 0;
+
+    /* 打开文件用于写入 */
+    rc = test_file_open(&file, FS_O_CREATE | FS_O_WRITE);
+    if (rc < 0) {
+        printk("Failed to open file for writing: %d\n", rc);
+        return rc;
+    }
+
+    /* 生成测试数据; verify 时每个块在写之前按偏移生成 */
+    if (!cur_opts.verify) {
+        generate_test_data(buffer, block_size, grw_data_pattern);
+    }
+    offset_iter_init(&it, stat->config);
+
+    /* 开始计时 */
+    cpu_sample(&cpu_start);
+    start_cycles = k_cycle_get_64();
+
+    while (total_written < file_size) {
+        offset = total_written;
+        if (stat->config->random_access) {
+            offset = offset_iter_next(&it);
+            op_start = k_cycle_get_64();
+            rc = fs_seek(&file, offset, FS_SEEK_SET);
+            LATENCY_RECORD(FS_PERF_OP_SEEK, op_start);
+            if (rc < 0) {
+                printk("Seek failed: %d, offset %d\n", rc, offset);
+                goto out;
+            }
+        }
+
+        chunk_size = (file_size - total_written < block_size) ? file_size - total_written : block_size;
+        if (cur_opts.verify) {
+            verify_cycles += verify_fill_block(chunk_size, offset, seed);
+        }
+        op_start = k_cycle_get_64();
+        rc = fs_write(&file, buffer, chunk_size);
+        LATENCY_RECORD(FS_PERF_OP_WRITE, op_start);
+        if (rc < 0 || rc != chunk_size) {
+            printk("Write failed: expected %d, written %d; at %d\n", chunk_size, rc, total_written);
+            rc = (rc < 0) ? rc : -EIO;
+            goto out;
+        }
+
+        total_written += rc;
+        stat->write_operations_completed++;
+        rc = 0;
+    }
+
+    if (cur_opts.sync_after_write) {
+        op_start = k_cycle_get_64();
+        rc = fs_sync(&file);
+        LATENCY_RECORD(FS_PERF_OP_SYNC, op_start);
+        if (rc < 0) {
+            printk("Sync failed: %d\n", rc);
+        }
+    }
+
+out:
+    /* 结束计时 */
+    end_cycles = k_cycle_get_64();
+    cpu_sample(&cpu_end);
+
+    /* 生成数据在测试线程中运行，同时计入了 busy 和 caller */
+    stat->write_success = (rc == 0 && total_written == file_size);
+    stat->written_bytes = total_written;
+    stat->write_verify_cycles = verify_cycles;
+    stat->write_time_cycles = end_cycles - start_cycles - verify_cycles;
+    stat->write_cpu_cycles = sub_verify(cpu_end.busy - cpu_start.busy, verify_cycles);
+    stat->write_caller_cycles = sub_verify(cpu_end.caller - cpu_start.caller, verify_cycles);
+
+    int close_rc = test_file_close(&file);
+    if (close_rc != 0) {
+        printk("Error closing file: %d\n", close_rc);
+        if (rc == 0) {
+            rc = close_rc;
+        }
+    }
+
+    return rc;
+}
+
+/* 测试读取 */
+static int test_read(struct fs_perf_stats *stat)
+{
+    int rc;
+    struct fs_file_t file;
+    uint64_t start_cycles, end_cycles, op_start;
+    struct cpu_sample cpu_start, cpu_end;
+    struct offset_iter it;
+
+    uint32_t block_size = stat->config->block_size_bytes;  // buffer_size
+    uint32_t file_size = stat->config->file_size_bytes;
+    uint32_t chunk_size;    // chunk size read or write each time
+    uint32_t offset;
+    size_t total_read = 0;
+    uint32_t seed = verify_seed(stat->config);
+    uint64_t verify_cycles = 0;
+
+    /* 打开文件用于读取 */
+    rc = test_file_open(&file, FS_O_READ);
+    if (rc < 0) {
+        printk("Failed to open file for reading: %d\n", rc);
+        return rc;
+    }
+
+    offset_iter_init(&it, stat->config);
+
+    /* 开始计时 */
+    cpu_sample(&cpu_start);
+    start_cycles = k_cycle_get_64();
+
+    while (total_read < file_size) {
+        offset = total_read;
+        if (stat->config->random_access) {
+            offset = offset_iter_next(&it);
+            op_start = k_cycle_get_64();
+            rc = fs_seek(&file, offset, FS_SEEK_SET);
+            LATENCY_RECORD(FS_PERF_OP_SEEK, op_start);
+            if (rc < 0) {
+                printk("Seek failed: %d, offset %d\n", rc, offset);
+                goto out;
+            }
+        }
+
+        chunk_size = (file_size - total_read < block_size) ? file_size - total_read : block_size;
+        op_start = k_cycle_get_64();
+        rc = fs_read(&file, buffer, chunk_size);
+        LATENCY_RECORD(FS_PERF_OP_READ, op_start);
+        if (rc < 0 || rc != chunk_size) {
+            printk("Read failed: expected %d, read %d; at %d\n", chunk_size, rc, total_read);
+            rc = (rc < 0) ? rc : -EIO;
+            goto out;
+        }
+
+        /* 验证数据完整性 */
+        if (cur_opts.verify && verify_check_block(chunk_size, offset, seed, &verify_cycles) < 0) {
+            rc = -EIO;
+            goto out;
+        }
+
+        total_read += rc;
+        stat->read_operations_completed++;
+        rc = 0;
+    }
+
+out:
+    /* 结束计时 */
+    end_cycles = k_cycle_get_64();
+    cpu_sample(&cpu_end);
+
+    stat->read_success = (rc == 0 && total_read == file_size);
+    stat->read_bytes = total_read;
+    stat->read_verify_cycles = verify_cycles;
+    stat->read_time_cycles = end_cycles - start_cycles - verify_cycles;
+    stat->read_cpu_cycles = sub_verify(cpu_end.busy - cpu_start.busy, verify_cycles);
+    stat->read_caller_cycles = sub_verify(cpu_end.caller - cpu_start.caller, verify_cycles);
+
+    test_file_close(&file);
+    return rc;
+}
+
+/* 计算均值, 只有成功的 iteration 参与均值计算，
+    以防在 pos=0 处失败时，read_bytes或written_bytes 为0，导致计算的速度为0*/
+static void calc_performance_results(struct fs_perf_config *config)
+{
+    uint32_t read_success_times = 0;
+    uint32_t write_success_times = 0;
+    /* 成功的 iteration 的累计值, 计算每 MB 的 CPU 消耗 */
+    uint64_t write_bytes = 0, write_time = 0, write_cpu = 0, write_caller = 0;
+    uint64_t read_bytes = 0, read_time = 0, read_cpu = 0, read_caller = 0;
+    uint32_t write_samples[FS_PERF_ITERATIONS_MAX];
+    uint32_t read_samples[FS_PERF_ITERATIONS_MAX];
+
+    for (int i = 0; i < case_iterations; i++) {
+        struct fs_perf_stats *stat = &stats[i];
+
+        stat->read_time_us = fs_perf_cycles_to_us(stat->read_time_cycles);
+        stat->write_time_us = fs_perf_cycles_to_us(stat->write_time_cycles);
+        stat->read_speed_kbps = speed_kbps(stat->read_bytes, stat->read_time_cycles);
+        stat->write_speed_kbps = speed_kbps(stat->written_bytes, stat->write_time_cycles);
+
+        if (stat->read_success) {
+            read_samples[read_success_times] = stat->read_speed_kbps;
+            read_success_times++;
+            read_bytes += stat->read_bytes;
+            read_time += stat->read_time_cycles;
+            read_cpu += stat->read_cpu_cycles;
+            read_caller += stat->read_caller_cycles;
+        }
+        if (stat->write_success) {
+            write_samples[write_success_times] = stat->write_speed_kbps;
+            write_success_times++;
+            write_bytes += stat->written_bytes;
+            write_time += stat->write_time_cycles;
+            write_cpu += stat->write_cpu_cycles;
+            write_caller += stat->write_caller_cycles;
+        }
+    }
+
+    config->write_cpu_per_mb = cycles_per_mb(write_cpu, write_bytes);
+    config->read_cpu_per_mb = cycles_per_mb(read_cpu, read_bytes);
+    config->write_caller_cpu_per_mb = cycles_per_mb(write_caller, write_bytes);
+    config->read_caller_cpu_per_mb = cycles_per_mb(read_caller, read_bytes);
+    config->write_cpu_util_x100 = (write_time > 0) ? (uint32_t)(write_cpu * 100 / write_time) : 0;
+    config->read_cpu_util_x100 = (read_time > 0) ? (uint32_t)(read_cpu * 100 / read_time) : 0;
+
+    /* 没有成功的 iteration 时 *_stats 清零，速度为 -1 */
+    config->avg_write_speed = (fs_perf_sample_calc(write_samples, write_success_times, cur_opts.reject_outliers,
+                                                   &config->write_stats) == 0) ? config->write_stats.mean : -1;
+    config->avg_read_speed = (fs_perf_sample_calc(read_samples, read_success_times, cur_opts.reject_outliers,
+                                                  &config->read_stats) == 0) ? config->read_stats.mean : -1;
+    config->iterations = case_iterations;
+    config->read_success_rate_x100  = read_success_times * 100 / case_iterations;
+    config->write_success_rate_x100 = write_success_times * 100 / case_iterations;
+}
+
+uint64_t fs_perf_cycles_to_us(uint64_t cycles)
+{
+    return cycles * 1000000ULL / cycles_per_sec;
+}
+
+const struct fs_perf_hist *fs_perf_latency(enum fs_perf_op op)
+{
+    return &latency[op];
+}
+
+/* 显示单次操作耗时的分布 */
+static void display_latency_results(void)
+{
+    printk("latency (us)  count      min      p50      p90      p99    p99.9      max\n");
+    for (int op = 0; op < FS_PERF_OP_COUNT; op++) {
+        const struct fs_perf_hist *hist = &latency[op];
+        if (hist->count == 0) {
+            continue;
+        }
+        printk("%-10s %8u %8llu %8llu %8llu %8llu %8llu %8llu\n",
+            op_names[op], hist->count,
+            fs_perf_cycles_to_us(hist->min),
+            fs_perf_cycles_to_us(fs_perf_hist_percentile(hist, 5000)),
+            fs_perf_cycles_to_us(fs_perf_hist_percentile(hist, 9000)),
+            fs_perf_cycles_to_us(fs_perf_hist_percentile(hist, 9900)),
+            fs_perf_cycles_to_us(fs_perf_hist_percentile(hist, 9990)),
+            fs_perf_cycles_to_us(hist->max));
+    }
+}
+
+/* 自适应结束: 已统计 min_iterations 次，读写速度的置信区间都足够窄 */
+static bool case_converged(struct fs_perf_config *config)
+{
+    if (cur_opts.ci_target_permille == 0 || case_iterations < cur_opts.min_iterations) {
+        return false;
+    }
+
+    calc_performance_results(config);
+    return fs_perf_sample_converged(&config->write_stats, cur_opts.ci_target_permille) &&
+        fs_perf_sample_converged(&config->read_stats, cur_opts.ci_target_permille);
+}
+
+/* 设备层访问量与写放大 */
+static void calc_dev_io_results(struct fs_perf_config *config, struct fs_perf_dev_io *io)
+{
+    uint64_t fs_written = 0;
+
+    config->write_amp_x100 = 0;
+    config->erase_count = 0;
+    memset(io, 0, sizeof(*io));
+    if (cur_backend->case_dev_io == NULL) {
+        return;
+    }
+
+    cur_backend->case_dev_io(io);
+    for (int i = 0; i < case_iterations; i++) {
+        fs_written += stats[i].written_bytes;
+    }
+    if (fs_written > 0) {
+        config->write_amp_x100 = io->write_bytes * 100 / fs_written;
+    }
+    config->erase_count = io->erase_count;
+}
+
+#define KBPS_FMT(v) (v) / FS_PERF_SPEED_MULTIPLIER, (v) % FS_PERF_SPEED_MULTIPLIER
+
+/* 速度分布; 有失败时提醒平均值只来自成功的 iteration */
+static void display_sample_stats(const char *name, const struct fs_perf_sample_stats *st,
+                                 uint32_t success_rate_x100)
+{
+    if (st->n == 0) {
+        printk("%s: no successful iteration\n", name);
+        return;
+    }
+    printk("%s: n %u, mean %u.%.2u, median %u.%.2u, MAD %u.%.2u, stddev %u.%.2u KB/s; "
+            "95%% CI +-%u.%.2u KB/s (%u.%u%%); outliers %u%s\n",
+        name, st->n, KBPS_FMT(st->mean), KBPS_FMT(st->median), KBPS_FMT(st->mad), KBPS_FMT(st->stddev),
+        KBPS_FMT(st->ci95),
+        (st->mean > 0) ? (uint32_t)((uint64_t)st->ci95 * 100 / st->mean) : 0,
+        (st->mean > 0) ? (uint32_t)((uint64_t)st->ci95 * 1000 / st->mean % 10) : 0,
+        st->outliers, (cur_opts.reject_outliers && st->outliers > 0) ? " (excluded)" : "");
+    if (success_rate_x100 < 100) {
+        printk("WARNING: %s failed in %u%% of iterations, speed is over successful ones only\n",
+            name, 100 - success_rate_x100);
+    }
+}
+
+/* 显示性能结果 */
+static void display_performance_results(struct fs_perf_config *config,
+                                        const struct fs_perf_dev_io *io)
+{
+    printk("\n====== %s Performance Results ======\n", cur_backend->name);
+    if (cur_opts.buf_misalign != 0) {
+        printk("buffer %p, misaligned by %u bytes\n", buffer, cur_opts.buf_misalign);
+    }
+    if (cur_opts.warmup > 0) {
+        printk("%d warm-up iteration(s) not counted\n", cur_opts.warmup);
+    }
+    printk("file_size %d bytes, block_size %d bytes, random access %d. "
+            "Average read speed %u.%.2u KB/s. Average write speed %u.%.2u KB/s. "
+            "ReadSuccessRate %u%%, WriteSuccessRate %u%%\n",
+        config->file_size_bytes, config->block_size_bytes, config->random_access,
+        config->avg_read_speed / FS_PERF_SPEED_MULTIPLIER, config->avg_read_speed % FS_PERF_SPEED_MULTIPLIER,
+        config->avg_write_speed / FS_PERF_SPEED_MULTIPLIER, config->avg_write_speed % FS_PERF_SPEED_MULTIPLIER,
+        config->read_success_rate_x100, config->write_success_rate_x100);
+    display_sample_stats("write", &config->write_stats, config->write_success_rate_x100);
+    display_sample_stats("read", &config->read_stats, config->read_success_rate_x100);
+    if (cur_backend->case_dev_io != NULL) {
+        printk("device: write %llu bytes, read %llu bytes, erase %u times (%llu bytes); "
+                "write amplification %u.%.2u\n",
+            io->write_bytes, io->read_bytes, io->erase_count, io->erase_bytes,
+            config->write_amp_x100 / 100, config->write_amp_x100 % 100);
+    }
+    /* 忙等 (轮询、memcpy) 的配置 CPU 占用接近 100%，等 DMA/中断的配置占用低 */
+    if (config->write_cpu_per_mb != 0 || config->read_cpu_per_mb != 0) {
+        printk("cpu: write %llu cycles/MB (%llu us/MB, caller %llu us/MB), busy %u%%; "
+                "read %llu cycles/MB (%llu us/MB, caller %llu us/MB), busy %u%%\n",
+            config->write_cpu_per_mb, fs_perf_cycles_to_us(config->write_cpu_per_mb),
+            fs_perf_cycles_to_us(config->write_caller_cpu_per_mb), config->write_cpu_util_x100,
+            config->read_cpu_per_mb, fs_perf_cycles_to_us(config->read_cpu_per_mb),
+            fs_perf_cycles_to_us(config->read_caller_cpu_per_mb), config->read_cpu_util_x100);
+    }
+    if (cur_opts.verify && case_iterations > 0) {
+        uint64_t write_verify = 0, read_verify = 0;
+
+        for (int i = 0; i < case_iterations; i++) {
+            write_verify += stats[i].write_verify_cycles;
+            read_verify += stats[i].read_verify_cycles;
+        }
+        printk("verify: data checked, excluded from timing: write %llu us, read %llu us per iteration\n",
+            fs_perf_cycles_to_us(write_verify / case_iterations), fs_perf_cycles_to_us(read_verify / case_iterations));
+    }
+
+    /* outlier_mask 按成功的 iteration 编号 */
+    int write_sample = 0, read_sample = 0;
+
+    for (int i = 0; i < case_iterations; i++) {
+        struct fs_perf_stats *stat = &stats[i];
+        bool write_outlier = stat->write_success &&
+            (config->write_stats.outlier_mask & (1UL << write_sample++)) != 0;
+        bool read_outlier = stat->read_success &&
+            (config->read_stats.outlier_mask & (1UL << read_sample++)) != 0;
+
+        printk("[%d] WriteSuccess %d, Completed Operations %u; ReadSuccess %d, Completed Operations %u\n",
+            i, stat->write_success, stat->write_operations_completed, stat->read_success, stat->read_operations_completed);
+        printk("[%d] Write: %llu us, %u.%.2u KB/s%s\n",
+            i, stat->write_time_us,
+            stat->write_speed_kbps / FS_PERF_SPEED_MULTIPLIER, stat->write_speed_kbps % FS_PERF_SPEED_MULTIPLIER,
+            write_outlier ? " (outlier)" : "");
+        printk("[%d] Read:  %llu us, %u.%.2u KB/s%s\n",
+            i, stat->read_time_us,
+            stat->read_speed_kbps / FS_PERF_SPEED_MULTIPLIER, stat->read_speed_kbps % FS_PERF_SPEED_MULTIPLIER,
+            read_outlier ? " (outlier)" : "");
+    }
+    display_latency_results();
+    if (cur_backend->case_report != NULL) {
+        cur_backend->case_report();
+    }
+    printk("======================================\n\n");
+}
+
+void fs_perf_print_fs_status(void)
+{
+    struct fs_statvfs sbuf;
+    int rc = fs_statvfs(cur_backend->mnt_point, &sbuf);
+    if (rc < 0) {
+        printk("FAIL: statvfs: %d\n", rc);
+        return;
+    }
+
+    printk("%s: bsize = %lu ; frsize = %lu ; blocks = %lu ; bfree = %lu;"
+            "total size %lu KB, available size %lu KB, used %lu KB\n",
+        cur_backend->mnt_point,
+        sbuf.f_bsize, sbuf.f_frsize, sbuf.f_blocks, sbuf.f_bfree,
+        sbuf.f_frsize * sbuf.f_blocks / 1024,
+        sbuf.f_frsize * sbuf.f_bfree / 1024,
+        (sbuf.f_blocks - sbuf.f_bfree) * sbuf.f_frsize / 1024);
+}
+
+int fs_perf_set_options(const struct fs_perf_options *opts)
+{
+    if (opts->iterations <= 0 || opts->iterations > FS_PERF_ITERATIONS_MAX) {
+        printk("ERROR: iterations %d, max %d\n", opts->iterations, FS_PERF_ITERATIONS_MAX);
+        return -EINVAL;
+    }
+    if (opts->buf_misalign >= FS_PERF_BUF_MISALIGN_MAX) {
+        printk("ERROR: buf_misalign %u, max %d\n", opts->buf_misalign, FS_PERF_BUF_MISALIGN_MAX - 1);
+        return -EINVAL;
+    }
+    if (opts->warmup < 0 || opts->warmup > FS_PERF_ITERATIONS_MAX) {
+        printk("ERROR: warmup %d, max %d\n", opts->warmup, FS_PERF_ITERATIONS_MAX);
+        return -EINVAL;
+    }
+    if (opts->ci_target_permille != 0 && (opts->min_iterations < 2 || opts->min_iterations > opts->iterations)) {
+        printk("ERROR: min_iterations %d, must be 2..iterations (%d)\n", opts->min_iterations, opts->iterations);
+        return -EINVAL;
+    }
+
+    cur_opts = *opts;
+    buffer = buffer_area + cur_opts.buf_misalign;
+    return 0;
+}
+
+void fs_perf_get_options(struct fs_perf_options *opts)
+{
+    *opts = cur_opts;
+}
+
+int fs_perf_init(const struct fs_perf_backend *backend, const struct fs_perf_options *opts)
+{
+    int rc;
+
+    if (opts != NULL) {
+        rc = fs_perf_set_options(opts);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+    if (backend->buf_align > FS_PERF_BUF_ALIGN_MAX ||
+        (backend->buf_align & (backend->buf_align - 1)) != 0) {
+        printk("ERROR: %s buf_align %u, max %d\n", backend->name, backend->buf_align, FS_PERF_BUF_ALIGN_MAX);
+        return -EINVAL;
+    }
+
+    cur_backend = backend;
+    cycles_per_sec = sys_clock_hw_cycles_per_sec();
+    printk("\n***** %s Performance Test *****\n", backend->name);
+    printk("cycles_per_sec=%llu\n", cycles_per_sec);
+
+    if (backend->mount != NULL) {
+        rc = backend->mount();
+        if (rc < 0) {
+            printk("%s mount failed: %d\n", backend->name, rc);
+            return rc;
+        }
+    }
+
+    if (backend->print_info != NULL) {
+        backend->print_info();
+    }
+
+    /* 清理旧测试文件，确保测试环境重置 */
+    (void)fs_unlink(backend->test_file);
+    fs_perf_print_fs_status();
+
+    return 0;
+}
+
+int fs_perf_run_case(struct fs_perf_config *config)
+{
+    int rc;
+    struct fs_perf_dev_io dev_io;
+
+    if (config->block_size_bytes == 0 || config->block_size_bytes > FS_PERF_BLOCK_SIZE_MAX) {
+        printk("ERROR: block_size %d exceeds %d\n", config->block_size_bytes, FS_PERF_BLOCK_SIZE_MAX);
+        return -ENOTSUP;
+    }
+
+    /* 预生成 随机序列 */
+    if (config->random_access) {
+        rc = random_order_prepare(config);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    memset(stats, 0, sizeof(stats));
+    case_iterations = 0;
+
+    for (int i = 0; i < cur_opts.warmup + cur_opts.iterations; i++) {
+        bool warmup = i < cur_opts.warmup;
+        struct fs_perf_stats *stat = warmup ? &warmup_stat : &stats[i - cur_opts.warmup];
+
+        /* warm-up 的耗时和设备访问量不计入结果 */
+        if (i == cur_opts.warmup) {
+            for (int op = 0; op < FS_PERF_OP_COUNT; op++) {
+                fs_perf_hist_reset(&latency[op]);
+            }
+            if (cur_backend->case_start != NULL) {
+                cur_backend->case_start();
+            }
+        }
+
+        memset(stat, 0, sizeof(*stat));
+        stat->config = config;
+        grw_data_pattern = cur_opts.pattern_base + i;
+
+        if (cur_opts.unlink_each_iteration) {
+            (void)fs_unlink(cur_backend->test_file);
+        }
+
+        if (warmup) {
+            printk("warm-up: %d:%d\n", i, cur_opts.warmup);
+        } else {
+            printk("iteration: %d:%d\n", i - cur_opts.warmup, cur_opts.iterations);
+        }
+        printk("Test 1: write test... [%d]\n", grw_data_pattern);
+        FS_PERF_DCACHE_FLUSH_ALL();
+        rc = test_write(stat);
+        if (rc != 0) {
+            printk("[%d] write test failed: %d\n", i, rc);
+            if (cur_opts.stop_on_error) {
+                return rc;
+            }
+        }
+
+        if (cur_opts.case_delay_ms > 0) {
+            k_msleep(cur_opts.case_delay_ms);
+        }
+
+        printk("Test 2: read test...\n");
+        FS_PERF_DCACHE_FLUSH_ALL();
+        rc = test_read(stat);
+        if (rc != 0) {
+            printk("[%d] read test failed: %d\n", i, rc);
+            if (cur_opts.stop_on_error) {
+                return rc;
+            }
+        }
+
+        if (cur_opts.case_delay_ms > 0) {
+            k_msleep(cur_opts.case_delay_ms);
+        }
+
+        if (!warmup) {
+            case_iterations++;
+            if (case_converged(config)) {
+                printk("95%% CI within %u.%u%% after %d iterations, stop\n",
+                    cur_opts.ci_target_permille / 10, cur_opts.ci_target_permille % 10, case_iterations);
+                break;
+            }
+        }
+    }
+
+    calc_performance_results(config);
+    calc_dev_io_results(config, &dev_io);
+
+    /* 显示结果 */
+    display_performance_results(config, &dev_io);
+    return 0;
+}
+
+int fs_perf_run_configs(struct fs_perf_config *configs, size_t count)
+{
+    int rc;
+
+    for (size_t c = 0; c < count; c++) {
+        struct fs_perf_config *config = &configs[c];
+
+        printk("\n\n[%d:%d] file_size %d bytes, block_size %d bytes, random access %d\n",
+            (int)c, (int)count, config->file_size_bytes, config->block_size_bytes, config->random_access);
+
+        rc = fs_perf_run_case(config);
+        if (rc == -ENOTSUP) {
+            continue;
+        }
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    return 0;
+}
+
+/* 顺序写入 file_size 字节的文件，不计时 */
+static int prepare_test_file(const char *path, uint32_t file_size)
+{
+    int rc;
+    struct fs_file_t file;
+    uint32_t written = 0;
+    uint32_t chunk_size;
+
+    rc = file_open_path(&file, path, FS_O_CREATE | FS_O_WRITE);
+    if (rc < 0) {
+        printk("Failed to open %s for writing: %d\n", path, rc);
+        return rc;
+    }
+
+    generate_test_data(buffer, FS_PERF_BLOCK_SIZE_MAX, cur_opts.pattern_base);
+    while (written < file_size) {
+        chunk_size = MIN(file_size - written, FS_PERF_BLOCK_SIZE_MAX);
+        rc = fs_write(&file, buffer, chunk_size);
+        if (rc < 0 || rc != chunk_size) {
+            printk("Write failed: expected %d, written %d; at %d\n", chunk_size, rc, written);
+            rc = (rc < 0) ? rc : -EIO;
+            break;
+        }
+        written += chunk_size;
+        rc = 0;
+    }
+
+    int close_rc = test_file_close(&file);
+    return (rc < 0) ? rc : close_rc;
+}
+
+int fs_perf_run_seek_sweep(uint32_t file_size, uint32_t points, uint32_t repeats)
+{
+    int rc;
+    struct fs_file_t file;
+    uint64_t start_cycles, cycles;
+    uint64_t min_cycles, max_cycles, total_cycles;
+    uint32_t offset;
+
+    if (points == 0 || repeats == 0) {
+        return -EINVAL;
+    }
+
+    printk("\n====== %s seek latency vs offset: file %u bytes ======\n", cur_backend->name, file_size);
+    rc = prepare_test_file(cur_backend->test_file, file_size);
+    if (rc < 0) {
+        return rc;
+    }
+
+    rc = test_file_open(&file, FS_O_READ);
+    if (rc < 0) {
+        printk("Failed to open file for reading: %d\n", rc);
+        return rc;
+    }
+
+    printk("offset (KB)   avg (us)   min (us)   max (us)\n");
+    for (uint32_t p = 1; p <= points && rc == 0; p++) {
+        /* 按扇区对齐，避免 seek 时读入半个扇区的数据 */
+        offset = (uint32_t)((uint64_t)file_size * p / points) & ~511U;
+        min_cycles = UINT64_MAX;
+        max_cycles = 0;
+        total_cycles = 0;
+
+        for (uint32_t r = 0; r < repeats; r++) {
+            /* 先回到文件头，下一次 seek 必须从头定位 */
+            rc = fs_seek(&file, 0, FS_SEEK_SET);
+            if (rc < 0) {
+                break;
+            }
+            start_cycles = k_cycle_get_64();
+            rc = fs_seek(&file, offset, FS_SEEK_SET);
+            cycles = k_cycle_get_64() - start_cycles;
+            if (rc < 0) {
+                printk("Seek failed: %d, offset %d\n", rc, offset);
+                break;
+            }
+            min_cycles = MIN(min_cycles, cycles);
+            max_cycles = MAX(max_cycles, cycles);
+            total_cycles += cycles;
+        }
+
+        if (rc == 0) {
+            printk("%10u %10llu %10llu %10llu\n", offset / 1024,
+                fs_perf_cycles_to_us(total_cycles / repeats),
+                fs_perf_cycles_to_us(min_cycles),
+                fs_perf_cycles_to_us(max_cycles));
+        }
+    }
+    printk("======================================\n\n");
+
+    int close_rc = test_file_close(&file);
+    (void)fs_unlink(cur_backend->test_file);
+    return (rc < 0) ? rc : close_rc;
+}
+
+/* 执行一次操作，返回 0 或负数 errno */
+static int job_do_io(struct fs_file_t *file, const struct fs_perf_io *io)
+{
+    uint64_t op_start;
+    int rc;
+
+    op_start = k_cycle_get_64();
+    rc = fs_seek(file, io->offset, FS_SEEK_SET);
+    LATENCY_RECORD(FS_PERF_OP_SEEK, op_start);
+    if (rc < 0) {
+        printk("Seek failed: %d, offset %u\n", rc, io->offset);
+        return rc;
+    }
+
+    op_start = k_cycle_get_64();
+    if (io->read) {
+        rc = fs_read(file, buffer, io->size);
+        LATENCY_RECORD(FS_PERF_OP_READ, op_start);
+    } else {
+        rc = fs_write(file, buffer, io->size);
+        LATENCY_RECORD(FS_PERF_OP_WRITE, op_start);
+    }
+    if (rc < 0 || rc != io->size) {
+        printk("%s failed: expected %u, got %d; at %u\n",
+            io->read ? "Read" : "Write", io->size, rc, io->offset);
+        return (rc < 0) ? rc : -EIO;
+    }
+    return 0;
+}
+
+static int job_sync(struct fs_file_t *file, struct fs_perf_job_result *res)
+{
+    uint64_t op_start = k_cycle_get_64();
+    int rc = fs_sync(file);
+    uint64_t cycles = k_cycle_get_64() - op_start;
+
+    fs_perf_hist_record(&latency[FS_PERF_OP_SYNC], cycles);
+    res->io_cycles += cycles;
+    res->syncs++;
+    if (rc < 0) {
+        printk("Sync failed: %d\n", rc);
+    }
+    return rc;
+}
+
+static void display_job_results(const struct fs_perf_job *job, const struct fs_perf_job_result *res)
+{
+    uint64_t io_us = fs_perf_cycles_to_us(res->io_cycles);
+    uint64_t elapsed_us = fs_perf_cycles_to_us(res->elapsed_cycles);
+    uint32_t kbps = speed_kbps(res->read_bytes + res->write_bytes, res->io_cycles);
+    uint32_t ops = res->reads + res->writes;
+
+    printk("\n====== %s job \"%s\" Results ======\n", cur_backend->name, job->name);
+    printk("file %u bytes, unit %u, seed 0x%08x; %u reads (%llu bytes), %u writes (%llu bytes), "
+            "%u syncs, %u errors\n",
+        job->file_size, job->unit, res->seed, res->reads, res->read_bytes,
+        res->writes, res->write_bytes, res->syncs, res->errors);
+    printk("io time %llu us, %u.%.2u KB/s, %llu IOPS; elapsed %llu us (with think time)\n",
+        io_us, kbps / FS_PERF_SPEED_MULTIPLIER, kbps % FS_PERF_SPEED_MULTIPLIER,
+        (io_us > 0) ? (uint64_t)ops * 1000000 / io_us : 0, elapsed_us);
+    if (cur_backend->case_dev_io != NULL) {
+        printk("write amplification %u.%.2u\n", res->write_amp_x100 / 100, res->write_amp_x100 % 100);
+    }
+    display_latency_results();
+    if (cur_backend->case_report != NULL) {
+        cur_backend->case_report();
+    }
+    printk("======================================\n\n");
+}
+
+int fs_perf_run_job(const struct fs_perf_job *job, struct fs_perf_job_result *res)
+{
+    int rc;
+    struct fs_file_t file;
+    struct fs_perf_job_gen gen;
+    struct fs_perf_job_result local;
+    struct fs_perf_io io;
+    uint64_t start_cycles, op_start;
+    uint32_t writes_since_sync = 0;
+    uint32_t think_us;
+
+    if (res == NULL) {
+        res = &local;
+    }
+    memset(res, 0, sizeof(*res));
+    res->seed = (cur_opts.random_seed != 0) ? cur_opts.random_seed : sys_rand32_get();
+
+    rc = fs_perf_job_gen_init(&gen, job, FS_PERF_BLOCK_SIZE_MAX, res->seed);
+    if (rc < 0) {
+        printk("ERROR: job \"%s\" invalid\n", job->name);
+        return rc;
+    }
+
+    printk("\n\njob \"%s\": file %u bytes, %u ops, read %u%%\n",
+        job->name, job->file_size, job->ops, job->read_percent);
+
+    /* 预先写满工作集，不计入统计 */
+    if (cur_opts.unlink_each_iteration) {
+        (void)fs_unlink(cur_backend->test_file);
+    }
+    rc = prepare_test_file(cur_backend->test_file, job->file_size);
+    if (rc < 0) {
+        return rc;
+    }
+
+    for (int op = 0; op < FS_PERF_OP_COUNT; op++) {
+        fs_perf_hist_reset(&latency[op]);
+    }
+    if (cur_backend->case_start != NULL) {
+        cur_backend->case_start();
+    }
+
+    rc = test_file_open(&file, FS_O_RDWR);
+    if (rc < 0) {
+        printk("Failed to open file: %d\n", rc);
+        return rc;
+    }
+
+    generate_test_data(buffer, FS_PERF_BLOCK_SIZE_MAX, cur_opts.pattern_base);
+    FS_PERF_DCACHE_FLUSH_ALL();
+
+    start_cycles = k_cycle_get_64();
+    for (uint32_t n = 0; n < job->ops; n++) {
+        fs_perf_job_gen_next(&gen, &io);
+
+        op_start = k_cycle_get_64();
+        rc = job_do_io(&file, &io);
+        res->io_cycles += k_cycle_get_64() - op_start;
+        if (rc < 0) {
+            res->errors++;
+            if (cur_opts.stop_on_error) {
+                break;
+            }
+            rc = 0;
+            continue;
+        }
+
+        if (io.read) {
+            res->reads++;
+            res->read_bytes += io.size;
+        } else {
+            res->writes++;
+            res->write_bytes += io.size;
+            if (job->sync_every != 0 && ++writes_since_sync == job->sync_every) {
+                writes_since_sync = 0;
+                (void)job_sync(&file, res);
+            }
+        }
+
+        think_us = fs_perf_job_gen_think_us(&gen);
+        if (think_us > 0) {
+            k_usleep(think_us);
+        }
+    }
+
+    if (rc == 0 && res->writes > 0 && cur_opts.sync_after_write) {
+        rc = job_sync(&file, res);
+    }
+    res->elapsed_cycles = k_cycle_get_64() - start_cycles;
+
+    int close_rc = test_file_close(&file);
+    if (rc == 0) {
+        rc = close_rc;
+    }
+
+    if (cur_backend->case_dev_io != NULL && res->write_bytes > 0) {
+        struct fs_perf_dev_io dev_io = {0};
+
+        cur_backend->case_dev_io(&dev_io);
+        res->write_amp_x100 = dev_io.write_bytes * 100 / res->write_bytes;
+    }
+
+    display_job_results(job, res);
+    return rc;
+}
+
+int fs_perf_run_jobs(const struct fs_perf_job *jobs, size_t count)
+{
+    int rc;
+
+    for (size_t j = 0; j < count; j++) {
+        rc = fs_perf_run_job(&jobs[j], NULL);
+        if (rc == -EINVAL) {
+            continue;
+        }
+        if (rc < 0 && cur_opts.stop_on_error) {
+            return rc;
+        }
+    }
+
+    return 0;
+}
+
+/******************************************************************/
+/* 异步写, 只有 app include 了 fs_async.cmake 时才编译 */
+#if __has_include("fs_async.h")
+static struct fs_async_req async_reqs[FS_PERF_ASYNC_DEPTH_MAX];
+static struct k_poll_signal async_signals[FS_PERF_ASYNC_DEPTH_MAX];
+static uint64_t async_submit_cycles[FS_PERF_ASYNC_DEPTH_MAX];
+/* 请求从提交到完成的耗时, 在 work queue 线程中 raise signal 之前记录, async_wait 返回后 slot 可以重用 */
+static struct fs_perf_hist async_latency;
+
+static void async_write_done(struct fs_async_req *req, void *user_data)
+{
+    uint32_t slot = POINTER_TO_UINT(user_data);
+
+    fs_perf_hist_record(&async_latency, k_cycle_get_64() - async_submit_cycles[slot]);
+}
+
+/* 等 slot 中的请求完成, 返回 0 或负数 errno */
+static int async_wait(uint32_t slot, size_t expected)
+{
+    struct k_poll_event event;
+    ssize_t result;
+
+    k_poll_event_init(&event, K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &async_signals[slot]);
+    (void)k_poll(&event, 1, K_FOREVER);
+
+    result = async_reqs[slot].result;
+    if (result < 0 || (size_t)result != expected) {
+        printk("async %s failed: expected %u, got %d; at %d\n",
+            (async_reqs[slot].op == FS_ASYNC_SYNC) ? "sync" : "write",
+            (uint32_t)expected, (int)result, (int)async_reqs[slot].offset);
+        return (result < 0) ? (int)result : -EIO;
+    }
+    return 0;
+}
+
+static void async_submit(struct fs_async_queue *q, uint32_t slot, enum fs_async_op op,
+    struct fs_file_t *file, uint32_t offset, uint32_t len)
+{
+    struct fs_async_req *req = &async_reqs[slot];
+
+    memset(req, 0, sizeof(*req));
+    req->op = op;
+    req->file = file;
+    req->offset = offset;
+    req->buf = buffer;
+    req->len = len;
+    req->signal = &async_signals[slot];
+    req->cb = async_write_done;
+    req->user_data = UINT_TO_POINTER(slot);
+
+    async_submit_cycles[slot] = k_cycle_get_64();
+    (void)fs_async_submit(q, req);
+}
+
+/*
+ * 与 test_write 按同样的偏移和块大小写, 最多 depth 个请求在队列中。
+ * 所有请求共用 buffer, 写的是固定的 pattern (opts.verify 按偏移生成的数据需要每个请求一个 buffer)
+ */
+static int test_async_write(struct fs_perf_config *config, struct fs_async_queue *q,
+    uint32_t depth, uint64_t *cycles)
+{
+    int rc;
+    struct fs_file_t file;
+    struct offset_iter it;
+    uint32_t block_size = config->block_size_bytes;
+    uint32_t blocks = config->file_size_bytes / block_size;
+    uint32_t offset;
+    uint32_t slot;
+    uint64_t start_cycles;
+
+    rc = test_file_open(&file, FS_O_CREATE | FS_O_WRITE);
+    if (rc < 0) {
+        printk("Failed to open file for writing: %d\n", rc);
+        return rc;
+    }
+
+    generate_test_data(buffer, block_size, grw_data_pattern);
+    offset_iter_init(&it, config);
+    FS_PERF_DCACHE_FLUSH_ALL();
+
+    start_cycles = k_cycle_get_64();
+    for (uint32_t n = 0; n < blocks; n++) {
+        slot = n % depth;
+        if (n >= depth) {
+            rc = async_wait(slot, block_size);
+            if (rc < 0) {
+                break;
+            }
+        }
+        offset = config->random_access ? offset_iter_next(&it) : n * block_size;
+        async_submit(q, slot, FS_ASYNC_WRITE, &file, offset, block_size);
+    }
+
+    /* 出错后也要等所有已提交的请求完成，之后才能关闭文件 */
+    for (uint32_t n = (blocks > depth) ? blocks - depth : 0; n < blocks; n++) {
+        int wait_rc = async_wait(n % depth, block_size);
+
+        if (rc == 0) {
+            rc = wait_rc;
+        }
+    }
+
+    if (rc == 0 && cur_opts.sync_after_write) {
+        async_submit(q, 0, FS_ASYNC_SYNC, &file, 0, 0);
+        rc = async_wait(0, 0);
+    }
+    *cycles = k_cycle_get_64() - start_cycles;
+
+    int close_rc = test_file_close(&file);
+    return (rc < 0) ? rc : close_rc;
+}
+
+int fs_perf_run_async_write(struct fs_perf_config *config, struct fs_async_queue *q,
+    const uint32_t *depths, size_t count)
+{
+    int rc;
+    struct fs_perf_stats stat;
+    struct fs_async_stats qstats;
+    uint64_t cycles;
+    uint32_t kbps;
+
+    if (config->block_size_bytes == 0 || config->block_size_bytes > FS_PERF_BLOCK_SIZE_MAX ||
+        config->file_size_bytes % config->block_size_bytes != 0) {
+        printk("ERROR: file_size %u, block_size %u not supported\n",
+            config->file_size_bytes, config->block_size_bytes);
+        return -ENOTSUP;
+    }
+    for (size_t d = 0; d < count; d++) {
+        if (depths[d] == 0 || depths[d] > FS_PERF_ASYNC_DEPTH_MAX) {
+            printk("ERROR: queue depth %u exceeds %d\n", depths[d], FS_PERF_ASYNC_DEPTH_MAX);
+            return -ENOTSUP;
+        }
+    }
+    if (config->random_access) {
+        rc = random_order_prepare(config);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+    for (uint32_t slot = 0; slot < FS_PERF_ASYNC_DEPTH_MAX; slot++) {
+        k_poll_signal_init(&async_signals[slot]);
+    }
+
+    /* 每种方式都是覆盖写已有的文件 */
+    rc = prepare_test_file(cur_backend->test_file, config->file_size_bytes);
+    if (rc < 0) {
+        return rc;
+    }
+    grw_data_pattern = cur_opts.pattern_base;
+
+    printk("\n====== %s async write: file %u bytes, block %u bytes, random access %d ======\n",
+        cur_backend->name, config->file_size_bytes, config->block_size_bytes, config->random_access);
+    printk("mode          KB/s    p50 (us)    p99 (us)    max (us)  fs calls  batches  merged  reordered\n");
+
+    memset(&stat, 0, sizeof(stat));
+    stat.config = config;
+    fs_perf_hist_reset(&latency[FS_PERF_OP_WRITE]);
+    FS_PERF_DCACHE_FLUSH_ALL();
+    rc = test_write(&stat);
+    if (rc < 0) {
+        return rc;
+    }
+    kbps = speed_kbps(stat.written_bytes, stat.write_time_cycles);
+    printk("sync    %7u.%.2u %11llu %11llu %11llu %9u\n",
+        kbps / FS_PERF_SPEED_MULTIPLIER, kbps % FS_PERF_SPEED_MULTIPLIER,
+        fs_perf_cycles_to_us(fs_perf_hist_percentile(&latency[FS_PERF_OP_WRITE], 5000)),
+        fs_perf_cycles_to_us(fs_perf_hist_percentile(&latency[FS_PERF_OP_WRITE], 9900)),
+        fs_perf_cycles_to_us(latency[FS_PERF_OP_WRITE].max),
+        stat.write_operations_completed);
+
+    for (size_t d = 0; d < count && rc == 0; d++) {
+        fs_perf_hist_reset(&async_latency);
+        fs_async_stats_reset(q);
+
+        rc = test_async_write(config, q, depths[d], &cycles);
+        if (rc < 0) {
+            printk("queue depth %u failed: %d\n", depths[d], rc);
+            break;
+        }
+
+        fs_async_stats_get(q, &qstats);
+        kbps = speed_kbps(config->file_size_bytes, cycles);
+        printk("qd %-4u %7u.%.2u %11llu %11llu %11llu %9u %8u %7u %10u\n", depths[d],
+            kbps / FS_PERF_SPEED_MULTIPLIER, kbps % FS_PERF_SPEED_MULTIPLIER,
+            fs_perf_cycles_to_us(fs_perf_hist_percentile(&async_latency, 5000)),
+            fs_perf_cycles_to_us(fs_perf_hist_percentile(&async_latency, 9900)),
+            fs_perf_cycles_to_us(async_latency.max),
+            qstats.fs_calls, qstats.batches, qstats.merged, qstats.reordered);
+    }
+    printk("======================================\n\n");
+    return rc;
+}
+#endif /* __has_include("fs_async.h") */
+
+/******************************************************************/
+/* 多线程测试 */
+enum mt_phase {
+    MT_PHASE_WRITE,
+    MT_PHASE_READ,
+    MT_PHASE_COUNT,
+};
+
+struct mt_worker {
+    struct k_thread thread;
+    struct k_sem go;
+    struct fs_file_t *file;
+    struct fs_perf_perm perm;
+    uint32_t index;
+    int priority;
+    uint32_t base;              /* 在文件中的起始偏移 */
+    struct fs_perf_mt_config *config;
+    struct fs_perf_mt_thread_result *res;
+    enum mt_phase phase;
+};
+
+static K_THREAD_STACK_ARRAY_DEFINE(mt_stacks, FS_PERF_MT_THREADS_MAX, FS_PERF_MT_STACK_SIZE);
+static uint8_t mt_buffers[FS_PERF_MT_THREADS_MAX][FS_PERF_MT_BLOCK_SIZE_MAX] __aligned(FS_PERF_BUF_ALIGN_MAX);
+static struct mt_worker mt_workers[FS_PERF_MT_THREADS_MAX];
+static struct fs_file_t mt_files[FS_PERF_MT_THREADS_MAX];
+static K_SEM_DEFINE(mt_done, 0, FS_PERF_MT_THREADS_MAX);
+/* same_file 时保护共享 fs_file_t 的文件位置 */
+static K_MUTEX_DEFINE(mt_file_lock);
+#ifdef FS_PERF_LOCK_STATS
+/* 非 0: 正在运行的 worker 数, __wrap_z_impl_k_mutex_lock 只统计这些线程 */
+static volatile uint32_t mt_tracked_threads;
+
+int __real_z_impl_k_mutex_lock(struct k_mutex *mutex, k_timeout_t timeout);
+int __wrap_z_impl_k_mutex_lock(struct k_mutex *mutex, k_timeout_t timeout);
+
+static struct mt_worker *mt_current_worker(void)
+{
+    k_tid_t tid = k_current_get();
+
+    for (uint32_t t = 0; t < mt_tracked_threads; t++) {
+        if (&mt_workers[t].thread == tid) {
+            return &mt_workers[t];
+        }
+    }
+    return NULL;
+}
+
+/* 链接器 --wrap 之后，所有 k_mutex_lock 经过这里; worker 线程等待文件系统锁的时间计入 fs_lock_wait_cycles */
+int __wrap_z_impl_k_mutex_lock(struct k_mutex *mutex, k_timeout_t timeout)
+{
+    struct mt_worker *w;
+    uint64_t start;
+    int rc;
+
+    /* 共享文件锁在 mt_block_io 中单独统计 */
+    if (mt_tracked_threads == 0 || mutex == &mt_file_lock || (w = mt_current_worker()) == NULL) {
+        return __real_z_impl_k_mutex_lock(mutex, timeout);
+    }
+    start = k_cycle_get_64();
+    rc = __real_z_impl_k_mutex_lock(mutex, timeout);
+    w->res->fs_lock_wait_cycles += k_cycle_get_64() - start;
+    return rc;
+}
+#endif /* FS_PERF_LOCK_STATS */
+
+static void mt_file_path(char *path, size_t len, const struct fs_perf_mt_config *config, uint32_t index)
+{
+    if (config->same_file) {
+        snprintk(path, len, "%s", cur_backend->test_file);
+    } else {
+        /* 不依赖长文件名 (FatFs 8.3) */
+        snprintk(path, len, "%s/mt%u.dat", cur_backend->mnt_point, index);
+    }
+}
+
+static int mt_block_io(struct mt_worker *w, uint32_t offset)
+{
+    uint32_t block_size = w->config->block_size;
+    uint8_t *buf = mt_buffers[w->index];
+    uint64_t lock_start = 0;
+    int rc;
+
+    if (w->config->same_file) {
+        lock_start = k_cycle_get_64();
+        k_mutex_lock(&mt_file_lock, K_FOREVER);
+        w->res->lock_wait_cycles += k_cycle_get_64() - lock_start;
+    }
+
+    rc = fs_seek(w->file, offset, FS_SEEK_SET);
+    if (rc == 0) {
+        rc = (w->phase == MT_PHASE_WRITE) ? fs_write(w->file, buf, block_size)
+                                          : fs_read(w->file, buf, block_size);
+    }
+
+    if (w->config->same_file) {
+        k_mutex_unlock(&mt_file_lock);
+    }
+
+    if (rc < 0 || rc != block_size) {
+        printk("thread %u: %s failed: expected %u, got %d; at %u\n", w->index,
+            (w->phase == MT_PHASE_WRITE) ? "Write" : "Read", block_size, rc, offset);
+        return (rc < 0) ? rc : -EIO;
+    }
+    return 0;
+}
+
+static void mt_run_phase(struct mt_worker *w)
+{
+    struct fs_perf_mt_thread_result *res = w->res;
+    uint32_t block_size = w->config->block_size;
+    uint32_t blocks = w->config->file_size / block_size;
+    uint64_t start_cycles = k_cycle_get_64();
+    uint64_t exec_start = thread_exec_cycles();
+    uint64_t cycles, exec;
+    uint32_t b;
+    int rc = 0;
+
+    for (uint32_t n = 0; n < blocks; n++) {
+        b = w->config->random_access ? fs_perf_perm_get(&w->perm, n) : n;
+        rc = mt_block_io(w, w->base + b * block_size);
+        if (rc < 0) {
+            res->errors++;
+            if (cur_opts.stop_on_error) {
+                break;
+            }
+            continue;
+        }
+        if (w->phase == MT_PHASE_WRITE) {
+            res->write_bytes += block_size;
+        } else {
+            res->read_bytes += block_size;
+        }
+    }
+
+    if (w->phase == MT_PHASE_WRITE && cur_opts.sync_after_write) {
+        if (w->config->same_file) {
+            k_mutex_lock(&mt_file_lock, K_FOREVER);
+        }
+        if (fs_sync(w->file) < 0) {
+            res->errors++;
+        }
+        if (w->config->same_file) {
+            k_mutex_unlock(&mt_file_lock);
+        }
+    }
+
+    cycles = k_cycle_get_64() - start_cycles;
+    exec = thread_exec_cycles() - exec_start;
+    if (exec != 0 && exec < cycles) {
+        res->offcpu_cycles += cycles - exec;
+    }
+    if (w->phase == MT_PHASE_WRITE) {
+        res->write_cycles = cycles;
+    } else {
+        res->read_cycles = cycles;
+    }
+}
+
+static void mt_worker_entry(void *p1, void *p2, void *p3)
+{
+    struct mt_worker *w = p1;
+
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    for (int phase = 0; phase < MT_PHASE_COUNT; phase++) {
+        k_sem_take(&w->go, K_FOREVER);
+        mt_run_phase(w);
+        k_sem_give(&mt_done);
+    }
+}
+
+/* 同时放行所有线程，等全部完成，返回整个阶段的 cycle 数 */
+static uint64_t mt_run_all(struct fs_perf_mt_config *config, enum mt_phase phase)
+{
+    uint64_t start_cycles;
+
+    /* 锁调度，避免优先级比 main 高的线程在其它线程放行之前就开始 */
+    k_sched_lock();
+    start_cycles = k_cycle_get_64();
+    for (uint32_t t = 0; t < config->threads; t++) {
+        mt_workers[t].phase = phase;
+        k_sem_give(&mt_workers[t].go);
+    }
+    k_sched_unlock();
+
+    for (uint32_t t = 0; t < config->threads; t++) {
+        k_sem_take(&mt_done, K_FOREVER);
+    }
+    return k_cycle_get_64() - start_cycles;
+}
+
+static void display_mt_results(const struct fs_perf_mt_config *config)
+{
+    const struct fs_perf_mt_thread_result *res;
+    uint32_t write_kbps, read_kbps;
+    uint64_t busy_us;
+
+    printk("\n====== %s %u threads, %s, %u bytes/thread, block %u, random %d ======\n",
+        cur_backend->name, config->threads, config->same_file ? "same file" : "separate files",
+        config->file_size, config->block_size, config->random_access);
+    printk("thread prio  write KB/s   read KB/s  file lock (us)  fs lock (us)  off-CPU (us)  errors\n");
+    for (uint32_t t = 0; t < config->threads; t++) {
+        res = &config->thread_res[t];
+        write_kbps = speed_kbps(res->write_bytes, res->write_cycles);
+        read_kbps = speed_kbps(res->read_bytes, res->read_cycles);
+        printk("%6u %4d %7u.%.2u %8u.%.2u %15llu %13llu %13llu %7u\n", t,
+            mt_workers[t].priority,
+            write_kbps / FS_PERF_SPEED_MULTIPLIER, write_kbps % FS_PERF_SPEED_MULTIPLIER,
+            read_kbps / FS_PERF_SPEED_MULTIPLIER, read_kbps % FS_PERF_SPEED_MULTIPLIER,
+            fs_perf_cycles_to_us(res->lock_wait_cycles),
+            fs_perf_cycles_to_us(res->fs_lock_wait_cycles),
+            fs_perf_cycles_to_us(res->offcpu_cycles), res->errors);
+
+        busy_us = fs_perf_cycles_to_us(res->write_cycles + res->read_cycles);
+        if (busy_us > 0) {
+            printk("       file lock %llu%%, fs lock %llu%%, off-CPU %llu%% of %llu us\n",
+                fs_perf_cycles_to_us(res->lock_wait_cycles) * 100 / busy_us,
+                fs_perf_cycles_to_us(res->fs_lock_wait_cycles) * 100 / busy_us,
+                fs_perf_cycles_to_us(res->offcpu_cycles) * 100 / busy_us, busy_us);
+        }
+    }
+#ifndef FS_PERF_LOCK_STATS
+    printk("fs lock: not measured (FS_PERF_LOCK_STATS off in fs_perf.cmake)\n");
+#endif
+    printk("aggregate: write %u.%.2u KB/s, read %u.%.2u KB/s\n",
+        config->agg_write_speed / FS_PERF_SPEED_MULTIPLIER, config->agg_write_speed % FS_PERF_SPEED_MULTIPLIER,
+        config->agg_read_speed / FS_PERF_SPEED_MULTIPLIER, config->agg_read_speed % FS_PERF_SPEED_MULTIPLIER);
+#ifndef CONFIG_THREAD_RUNTIME_STATS
+    printk("off-CPU time needs CONFIG_THREAD_RUNTIME_STATS\n");
+#endif
+    if (cur_backend->case_report != NULL) {
+        cur_backend->case_report();
+    }
+    printk("======================================\n\n");
+}
+
+int fs_perf_run_mt(struct fs_perf_mt_config *config)
+{
+    int rc = 0;
+    char path[64];
+    uint32_t files = config->same_file ? 1 : config->threads;
+    uint32_t opened = 0;
+    uint32_t seed = (cur_opts.random_seed != 0) ? cur_opts.random_seed : sys_rand32_get();
+    uint64_t write_cycles, read_cycles;
+    uint64_t write_bytes = 0, read_bytes = 0;
+
+    if (config->threads == 0 || config->threads > FS_PERF_MT_THREADS_MAX ||
+        config->block_size == 0 || config->block_size > FS_PERF_MT_BLOCK_SIZE_MAX ||
+        config->file_size < config->block_size || config->file_size % config->block_size != 0) {
+        printk("ERROR: %u threads, file_size %u, block_size %u not supported\n",
+            config->threads, config->file_size, config->block_size);
+        return -EINVAL;
+    }
+    for (uint32_t t = 0; t < config->threads && config->thread_cfg != NULL; t++) {
+        if (config->thread_cfg[t].stack_size > FS_PERF_MT_STACK_SIZE) {
+            printk("ERROR: thread %u stack %u > %u\n", t,
+                (uint32_t)config->thread_cfg[t].stack_size, FS_PERF_MT_STACK_SIZE);
+            return -EINVAL;
+        }
+    }
+
+    memset(config->thread_res, 0, sizeof(config->thread_res));
+    config->agg_write_speed = 0;
+    config->agg_read_speed = 0;
+
+    /* 先写出完整的文件，计时阶段只覆盖写，不分配空间 */
+    for (uint32_t f = 0; f < files && rc == 0; f++) {
+        mt_file_path(path, sizeof(path), config, f);
+        rc = prepare_test_file(path, config->same_file ? config->file_size * config->threads
+                                                       : config->file_size);
+    }
+    for (uint32_t f = 0; f < files && rc == 0; f++) {
+        mt_file_path(path, sizeof(path), config, f);
+        rc = file_open_path(&mt_files[f], path, FS_O_RDWR);
+        if (rc < 0) {
+            printk("Failed to open %s: %d\n", path, rc);
+        } else {
+            opened++;
+        }
+    }
+
+    if (rc == 0 && cur_backend->case_start != NULL) {
+        cur_backend->case_start();
+    }
+
+    for (uint32_t t = 0; t < config->threads && rc == 0; t++) {
+        struct mt_worker *w = &mt_workers[t];
+        const struct fs_perf_mt_thread *tc = (config->thread_cfg != NULL) ? &config->thread_cfg[t] : NULL;
+        size_t stack_size = (tc != NULL && tc->stack_size != 0) ? tc->stack_size : FS_PERF_MT_STACK_SIZE;
+        int prio = (tc != NULL) ? tc->priority : FS_PERF_MT_PRIORITY;
+
+        w->index = t;
+        w->priority = prio;
+        w->config = config;
+        w->res = &config->thread_res[t];
+        w->file = config->same_file ? &mt_files[0] : &mt_files[t];
+        w->base = config->same_file ? t * config->file_size : 0;
+        (void)fs_perf_perm_init(&w->perm, config->file_size / config->block_size, seed + t);
+        generate_test_data(mt_buffers[t], config->block_size, cur_opts.pattern_base + t);
+        k_sem_init(&w->go, 0, 1);
+
+        k_thread_create(&w->thread, mt_stacks[t], stack_size, mt_worker_entry,
+            w, NULL, NULL, prio, 0, K_NO_WAIT);
+        snprintk(path, sizeof(path), "fs_perf_mt%u", t);
+        k_thread_name_set(&w->thread, path);
+    }
+    FS_PERF_DCACHE_FLUSH_ALL();
+
+    if (rc == 0) {
+#ifdef FS_PERF_LOCK_STATS
+        mt_tracked_threads = config->threads;
+#endif
+        write_cycles = mt_run_all(config, MT_PHASE_WRITE);
+        if (cur_opts.case_delay_ms > 0) {
+            k_msleep(cur_opts.case_delay_ms);
+        }
+        read_cycles = mt_run_all(config, MT_PHASE_READ);
+
+        for (uint32_t t = 0; t < config->threads; t++) {
+            k_thread_join(&mt_workers[t].thread, K_FOREVER);
+        }
+#ifdef FS_PERF_LOCK_STATS
+        mt_tracked_threads = 0;
+#endif
+        for (uint32_t t = 0; t < config->threads; t++) {
+            write_bytes += config->thread_res[t].write_bytes;
+            read_bytes += config->thread_res[t].read_bytes;
+            if (config->thread_res[t].errors != 0 && cur_opts.stop_on_error) {
+                rc = -EIO;
+            }
+        }
+        config->agg_write_speed = speed_kbps(write_bytes, write_cycles);
+        config->agg_read_speed = speed_kbps(read_bytes, read_cycles);
+        display_mt_results(config);
+    }
+
+    for (uint32_t f = 0; f < opened; f++) {
+        int close_rc = test_file_close(&mt_files[f]);
+
+        if (rc == 0) {
+            rc = close_rc;
+        }
+    }
+    for (uint32_t f = 0; f < files && !config->same_file; f++) {
+        mt_file_path(path, sizeof(path), config, f);
+        (void)fs_unlink(path);
+    }
+    return rc;
+}
+
+int fs_perf_run_mt_configs(struct fs_perf_mt_config *configs, size_t count)
+{
+    int rc;
+    struct fs_perf_mt_config *config;
+
+    for (size_t c = 0; c < count; c++) {
+        printk("\n\n[%d:%d] %u threads, %s\n", (int)c, (int)count,
+            configs[c].threads, configs[c].same_file ? "same file" : "separate files");
+
+        rc = fs_perf_run_mt(&configs[c]);
+        if (rc == -EINVAL) {
+            continue;
+        }
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    /* 与第一个同类 (same_file 相同) config 的百分比, 看吞吐量是否随线程数增长 */
+    printk("\n====== %s multi-thread scaling ======\n", cur_backend->name);
+    printk("threads  mode            write KB/s   read KB/s  write/1st %%  read/1st %%\n");
+    for (size_t c = 0; c < count; c++) {
+        const struct fs_perf_mt_config *ref = NULL;
+
+        config = &configs[c];
+        for (size_t r = 0; r <= c && ref == NULL; r++) {
+            if (configs[r].same_file == config->same_file && configs[r].agg_write_speed != 0) {
+                ref = &configs[r];
+            }
+        }
+        printk("%7u  %-14s %7u.%.2u %8u.%.2u %12u %11u\n", config->threads,
+            config->same_file ? "same file" : "separate files",
+            config->agg_write_speed / FS_PERF_SPEED_MULTIPLIER, config->agg_write_speed % FS_PERF_SPEED_MULTIPLIER,
+            config->agg_read_speed / FS_PERF_SPEED_MULTIPLIER, config->agg_read_speed % FS_PERF_SPEED_MULTIPLIER,
+            (ref != NULL) ? (uint32_t)((uint64_t)config->agg_write_speed * 100 / ref->agg_write_speed) : 0,
+            (ref != NULL && ref->agg_read_speed != 0)
+                ? (uint32_t)((uint64_t)config->agg_read_speed * 100 / ref->agg_read_speed) : 0);
+    }
+    printk("======================================\n\n");
+    return 0;
+}
+
+int fs_perf_run_ceiling(const struct fs_perf_backend *ceiling, const struct fs_perf_config *configs,
+                        struct fs_perf_config *results, size_t count)
+{
+    const struct fs_perf_backend *device = cur_backend;
+    struct fs_statvfs sbuf;
+    uint64_t size_max = UINT32_MAX;
+    int rc = 0;
+
+    for (size_t c = 0; c < count; c++) {
+        results[c] = configs[c];
+        results[c].avg_write_speed = (uint32_t)-1;
+        results[c].avg_read_speed = (uint32_t)-1;
+    }
+    if (ceiling->buf_align > FS_PERF_BUF_ALIGN_MAX || (ceiling->buf_align & (ceiling->buf_align - 1)) != 0) {
+        printk("ERROR: %s buf_align %u, max %d\n", ceiling->name, ceiling->buf_align, FS_PERF_BUF_ALIGN_MAX);
+        return -EINVAL;
+    }
+
+    printk("\n***** %s software ceiling for %s *****\n", ceiling->name, device->name);
+    if (ceiling->mount != NULL) {
+        rc = ceiling->mount();
+        if (rc < 0) {
+            printk("%s mount failed: %d\n", ceiling->name, rc);
+            return rc;
+        }
+    }
+
+    cur_backend = ceiling;
+    (void)fs_unlink(ceiling->test_file);
+    fs_perf_print_fs_status();
+
+    /* RAM 介质一般比设备小; 留一半空间给 LittleFS 这类写时复制的文件系统 */
+    if (fs_statvfs(ceiling->mnt_point, &sbuf) == 0) {
+        size_max = (uint64_t)sbuf.f_frsize * sbuf.f_bfree / 2;
+    }
+
+    for (size_t c = 0; c < count; c++) {
+        struct fs_perf_config *config = &results[c];
+
+        if (config->file_size_bytes > size_max) {
+            uint32_t file_size = ROUND_DOWN((uint32_t)size_max, config->block_size_bytes);
+
+            printk("%s: file_size %u -> %u bytes\n", ceiling->name, config->file_size_bytes, file_size);
+            if (file_size == 0) {
+                continue;
+            }
+            config->file_size_bytes = file_size;
+        }
+
+        printk("\n\n[%d:%d] ceiling: file_size %d bytes, block_size %d bytes, random access %d\n",
+            (int)c, (int)count, config->file_size_bytes, config->block_size_bytes, config->random_access);
+        rc = fs_perf_run_case(config);
+        if (rc == -ENOTSUP) {
+            rc = 0;
+            continue;
+        }
+        if (rc < 0) {
+            break;
+        }
+    }
+
+    (void)fs_unlink(ceiling->test_file);
+    if (ceiling->unmount != NULL) {
+        int unmount_rc = ceiling->unmount();
+
+        if (unmount_rc < 0) {
+            printk("%s unmount failed: %d\n", ceiling->name, unmount_rc);
+        }
+    }
+    cur_backend = device;
+    return rc;
+}
+
+/* KB/s * FS_PERF_SPEED_MULTIPLIER, -1 打印为 "-" */
+static void print_ceiling_speed(uint32_t kbps)
+{
+    if (kbps == (uint32_t)-1) {
+        printk(" %12s", "-");
+    } else {
+        printk(" %9u.%.2u", kbps / FS_PERF_SPEED_MULTIPLIER, kbps % FS_PERF_SPEED_MULTIPLIER);
+    }
+}
+
+static void print_ceiling_percent(uint32_t kbps, uint32_t ceiling_kbps)
+{
+    if (kbps == (uint32_t)-1 || ceiling_kbps == (uint32_t)-1 || ceiling_kbps == 0) {
+        printk(" %6s", "-");
+    } else {
+        printk(" %5u%%", (uint32_t)((uint64_t)kbps * 100 / ceiling_kbps));
+    }
+}
+
+void fs_perf_print_ceiling(const struct fs_perf_config *device, const struct fs_perf_config *ceiling,
+                           size_t count)
+{
+    /* 接近 100% 说明瓶颈在文件系统/CPU, 换更快的介质也没用 */
+    printk("\n====== %s vs software ceiling ======\n", cur_backend->name);
+    printk(" file_size  block  random   write KB/s      ceiling      %%    read KB/s      ceiling      %%\n");
+    for (size_t c = 0; c < count; c++) {
+        printk("%10u %6u %7d", device[c].file_size_bytes, device[c].block_size_bytes, device[c].random_access);
+        print_ceiling_speed(device[c].avg_write_speed);
+        print_ceiling_speed(ceiling[c].avg_write_speed);
+        print_ceiling_percent(device[c].avg_write_speed, ceiling[c].avg_write_speed);
+        print_ceiling_speed(device[c].avg_read_speed);
+        print_ceiling_speed(ceiling[c].avg_read_speed);
+        print_ceiling_percent(device[c].avg_read_speed, ceiling[c].avg_read_speed);
+        printk("\n");
+    }
+    printk("======================================\n\n");
+}
+
+/******************************************************************/
+/* 老化: 老化文件的大小保存在 aging_sizes 中，0 表示空位 */
+static const struct fs_perf_aging *aging_cfg;
+static uint32_t aging_sizes[FS_PERF_AGING_FILES_MAX];
+static uint32_t aging_weight_total;
+static uint32_t aging_rng;
+/* 累计的操作数, 复制到每个比例的结果中 */
+static struct fs_perf_aging_level aging_total;
+
+/* xorshift32, 不能为 0 */
+static uint32_t aging_rand(void)
+{
+    uint32_t x = aging_rng;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    aging_rng = x;
+    return x;
+}
+
+static uint32_t aging_pick_size(void)
+{
+    uint32_t w = aging_rand() % aging_weight_total;
+
+    for (uint32_t i = 0; i < aging_cfg->size_count; i++) {
+        if (w < aging_cfg->sizes[i].weight) {
+            return aging_cfg->sizes[i].size;
+        }
+        w -= aging_cfg->sizes[i].weight;
+    }
+    return aging_cfg->sizes[0].size;
+}
+
+/* 从随机位置开始找一个已用 (used) 或空的位置, 没有时返回 -1 */
+static int aging_pick_slot(bool used)
+{
+    uint32_t start = aging_rand() % FS_PERF_AGING_FILES_MAX;
+
+    for (uint32_t i = 0; i < FS_PERF_AGING_FILES_MAX; i++) {
+        uint32_t slot = (start + i) % FS_PERF_AGING_FILES_MAX;
+
+        if ((aging_sizes[slot] != 0) == used) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+static void aging_path(char *path, size_t len, uint32_t slot)
+{
+    snprintk(path, len, "%s/a%03u", aging_cfg->dir, slot);
+}
+
+static int volume_used(uint64_t *used, uint64_t *total)
+{
+    struct fs_statvfs sbuf;
+    int rc = fs_statvfs(cur_backend->mnt_point, &sbuf);
+
+    if (rc < 0) {
+        printk("FAIL: statvfs: %d\n", rc);
+        return rc;
+    }
+    *total = (uint64_t)sbuf.f_frsize * sbuf.f_blocks;
+    *used = (uint64_t)sbuf.f_frsize * (sbuf.f_blocks - sbuf.f_bfree);
+    return 0;
+}
+
+/* 写 size 字节, *written 累加实际写入的字节; 空间不足时返回 -ENOSPC */
+static int aging_write(struct fs_file_t *file, uint32_t size, uint32_t *written)
+{
+    while (size > 0) {
+        uint32_t chunk_size = MIN(size, FS_PERF_BLOCK_SIZE_MAX);
+        ssize_t rc = fs_write(file, buffer, chunk_size);
+
+        if (rc > 0) {
+            *written += rc;
+            aging_total.written_bytes += rc;
+            size -= rc;
+        }
+        if (rc != chunk_size) {
+            /* FAT 空间不足时返回写入的字节数, LittleFS 返回 -ENOSPC */
+            return (rc >= 0 || rc == -ENOSPC) ? -ENOSPC : (int)rc;
+        }
+    }
+    return 0;
+}
+
+enum aging_op {
+    AGING_CREATE,
+    AGING_REWRITE,
+    AGING_APPEND,
+};
+
+/* 新建、重写 (截断后重新写) 或追加 slot 对应的文件 */
+static int aging_write_file(uint32_t slot, enum aging_op op, uint32_t size)
+{
+    static const fs_mode_t flags[] = {
+        [AGING_CREATE] = FS_O_CREATE | FS_O_WRITE,
+        [AGING_REWRITE] = FS_O_WRITE,
+        [AGING_APPEND] = FS_O_WRITE | FS_O_APPEND,
+    };
+    struct fs_file_t file;
+    char path[64];
+    uint32_t written = 0;
+    int rc;
+
+    aging_path(path, sizeof(path), slot);
+    fs_file_t_init(&file);
+    rc = fs_open(&file, path, flags[op]);
+    if (rc < 0) {
+        printk("aging: open %s failed: %d\n", path, rc);
+        return rc;
+    }
+
+    if (op == AGING_REWRITE) {
+        rc = fs_truncate(&file, 0);
+        if (rc == 0) {
+            aging_sizes[slot] = 0;
+            aging_total.rewrites++;
+        }
+    } else if (op == AGING_APPEND) {
+        aging_total.appends++;
+    } else {
+        aging_total.creates++;
+    }
+    if (rc == 0) {
+        rc = aging_write(&file, size, &written);
+    }
+    aging_sizes[slot] += written;
+
+    int close_rc = fs_close(&file);
+    if (rc == 0) {
+        rc = close_rc;
+    }
+
+    /* 一个字节都没写进去的新文件不保留 */
+    if (aging_sizes[slot] == 0) {
+        (void)fs_unlink(path);
+    }
+    return rc;
+}
+
+static int aging_delete(uint32_t slot)
+{
+    char path[64];
+    int rc;
+
+    aging_path(path, sizeof(path), slot);
+    rc = fs_unlink(path);
+    if (rc < 0) {
+        printk("aging: unlink %s failed: %d\n", path, rc);
+        return rc;
+    }
+    aging_sizes[slot] = 0;
+    aging_total.files--;
+    aging_total.deletes++;
+    return 0;
+}
+
+/* 增加最多 room 字节: 有空位时新建文件，否则追加到已有的文件 */
+static int aging_grow(uint64_t room)
+{
+    uint32_t size = (uint32_t)MIN((uint64_t)aging_pick_size(), MAX(room, 1));
+    int slot = aging_pick_slot(false);
+    int rc;
+
+    if (slot >= 0) {
+        rc = aging_write_file(slot, AGING_CREATE, size);
+        if (aging_sizes[slot] != 0) {
+            aging_total.files++;
+        }
+        return rc;
+    }
+    return aging_write_file(aging_pick_slot(true), AGING_APPEND, size);
+}
+
+/* 重写一个文件, 新的大小最多比原来多 room 字节 */
+static int aging_rewrite(uint64_t room)
+{
+    int slot = aging_pick_slot(true);
+    uint32_t old_size = aging_sizes[slot];
+    uint32_t size = (uint32_t)MIN((uint64_t)aging_pick_size(), old_size + room);
+    int rc;
+
+    rc = aging_write_file(slot, AGING_REWRITE, size);
+    if (old_size != 0 && aging_sizes[slot] == 0) {
+        aging_total.files--;
+    }
+    return rc;
+}
+
+/* 填充到 target_percent, 然后在目标附近做 churn_ops 次 delete + create/rewrite */
+static int aging_fill(uint32_t target_percent)
+{
+    uint64_t used, total, target;
+    uint32_t churn = 0;
+    int rc;
+
+    rc = volume_used(&used, &total);
+    if (rc < 0) {
+        return rc;
+    }
+    target = total * target_percent / 100;
+
+    while (used < target || churn < aging_cfg->churn_ops) {
+        uint64_t room = (used < target) ? target - used : 0;
+        uint32_t r = aging_rand() % 100;
+
+        if (aging_cfg->max_bytes != 0 && aging_total.written_bytes >= aging_cfg->max_bytes) {
+            printk("WARNING: aging stopped after max_bytes %llu, %u%% not reached\n",
+                aging_cfg->max_bytes, target_percent);
+            return 0;
+        }
+
+        if (used >= target) {
+            /* churn: 超过目标时删除，否则新建或重写，已用空间在目标附近波动 */
+            churn++;
+            if (used > target && aging_total.files > 0) {
+                rc = aging_delete(aging_pick_slot(true));
+            } else if ((r & 1) && aging_total.files > 0) {
+                rc = aging_rewrite(room);
+            } else {
+                rc = aging_grow(room);
+            }
+        } else if (r < 15 && aging_total.files > 0) {
+            /* 填充过程中也有删除和重写，空出来的块在后面被新文件复用 */
+            rc = aging_delete(aging_pick_slot(true));
+        } else if (r < 30 && aging_total.files > 0) {
+            rc = aging_rewrite(room);
+        } else {
+            rc = aging_grow(room);
+        }
+
+        if (rc == -ENOSPC) {
+            printk("WARNING: aging: volume full before %u%%\n", target_percent);
+            return 0;
+        }
+        if (rc < 0) {
+            return rc;
+        }
+        rc = volume_used(&used, &total);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+    return 0;
+}
+
+static void aging_clean(bool all)
+{
+    char path[64];
+
+    for (uint32_t slot = 0; slot < FS_PERF_AGING_FILES_MAX; slot++) {
+        if (all || aging_sizes[slot] != 0) {
+            aging_path(path, sizeof(path), slot);
+            (void)fs_unlink(path);
+        }
+        aging_sizes[slot] = 0;
+    }
+    aging_total.files = 0;
+}
+
+int fs_perf_run_aging(const struct fs_perf_aging *aging, const uint32_t *levels_percent, size_t level_count,
+                      struct fs_perf_aging_level *level_results, const struct fs_perf_config *configs,
+                      struct fs_perf_config *results, size_t count)
+{
+    struct fs_statvfs sbuf;
+    uint64_t used, total, size_max;
+    int rc = 0;
+
+    for (size_t i = 0; i < level_count * count; i++) {
+        results[i] = configs[i % count];
+        results[i].avg_write_speed = (uint32_t)-1;
+        results[i].avg_read_speed = (uint32_t)-1;
+    }
+    memset(level_results, 0, level_count * sizeof(*level_results));
+    if (aging->dir == NULL || aging->sizes == NULL || aging->size_count == 0) {
+        return -EINVAL;
+    }
+    aging_weight_total = 0;
+    for (uint32_t i = 0; i < aging->size_count; i++) {
+        if (aging->sizes[i].size == 0) {
+            return -EINVAL;
+        }
+        aging_weight_total += aging->sizes[i].weight;
+    }
+    for (size_t l = 0; l < level_count; l++) {
+        if (levels_percent[l] == 0 || levels_percent[l] >= 100 ||
+            (l > 0 && levels_percent[l] <= levels_percent[l - 1])) {
+            printk("ERROR: aging levels must be increasing, 1 ~ 99%%\n");
+            return -EINVAL;
+        }
+    }
+    if (aging_weight_total == 0) {
+        return -EINVAL;
+    }
+
+    aging_cfg = aging;
+    aging_rng = (aging->seed != 0) ? aging->seed : sys_rand32_get();
+    if (aging_rng == 0) {
+        aging_rng = 0x9e3779b9U;
+    }
+    memset(&aging_total, 0, sizeof(aging_total));
+
+    printk("\n***** %s aging: dir %s, churn %u ops, seed 0x%08x *****\n",
+        cur_backend->name, aging->dir, aging->churn_ops, aging_rng);
+    rc = fs_mkdir(aging->dir);
+    if (rc < 0 && rc != -EEXIST) {
+        printk("mkdir %s failed: %d\n", aging->dir, rc);
+        return rc;
+    }
+    /* 上次中断留下的老化文件 */
+    aging_clean(true);
+    (void)fs_unlink(cur_backend->test_file);
+
+    /* 老化数据只用于占用空间，内容不重要 */
+    generate_test_data(buffer, FS_PERF_BLOCK_SIZE_MAX, cur_opts.pattern_base);
+
+    for (size_t l = 0; l < level_count; l++) {
+        struct fs_perf_aging_level *lr = &level_results[l];
+        int64_t start = k_uptime_get();
+
+        rc = aging_fill(levels_percent[l]);
+        if (rc < 0) {
+            printk("aging to %u%% failed: %d\n", levels_percent[l], rc);
+            break;
+        }
+        rc = volume_used(&used, &total);
+        if (rc < 0) {
+            break;
+        }
+        *lr = aging_total;
+        lr->target_percent = levels_percent[l];
+        lr->fill_x100 = (total > 0) ? (uint32_t)(used * 10000 / total) : 0;
+        lr->aging_ms = k_uptime_get() - start;
+
+        printk("\n>>>>>> %s aged to %u.%.2u%% (target %u%%): %u files, %u creates, %u deletes, "
+                "%u rewrites, %u appends, %llu bytes written, %llu ms\n",
+            cur_backend->name, lr->fill_x100 / 100, lr->fill_x100 % 100, lr->target_percent, lr->files,
+            lr->creates, lr->deletes, lr->rewrites, lr->appends, lr->written_bytes, lr->aging_ms);
+        fs_perf_print_fs_status();
+
+        for (size_t c = 0; c < count; c++) {
+            struct fs_perf_config *config = &results[l * count + c];
+
+            /* 与 fs_perf_run_ceiling 相同, 留一半空间给写时复制 */
+            size_max = 0;
+            if (fs_statvfs(cur_backend->mnt_point, &sbuf) == 0) {
+                size_max = (uint64_t)sbuf.f_frsize * sbuf.f_bfree / 2;
+            }
+            if (config->file_size_bytes > size_max) {
+                printk("skip: [%d:%d] file %u bytes does not fit at %u%%\n",
+                    (int)c, (int)count, config->file_size_bytes, lr->target_percent);
+                continue;
+            }
+
+            printk("\n\n[%d:%d] aged %u%%: file_size %d bytes, block_size %d bytes, random access %d\n",
+                (int)c, (int)count, lr->target_percent,
+                config->file_size_bytes, config->block_size_bytes, config->random_access);
+            rc = fs_perf_run_case(config);
+            /* 测试文件不计入下一个比例的老化数据 */
+            (void)fs_unlink(cur_backend->test_file);
+            if (rc == -ENOTSUP) {
+                rc = 0;
+                continue;
+            }
+            if (rc < 0) {
+                break;
+            }
+        }
+        if (rc < 0) {
+            break;
+        }
+    }
+
+    aging_clean(false);
+    (void)fs_unlink(aging->dir);
+    return rc;
+}
+
+void fs_perf_print_aging(const struct fs_perf_aging_level *level_results, size_t level_count,
+                         const struct fs_perf_config *results, size_t count)
+{
+    printk("\n====== %s throughput vs fill level ======\n", cur_backend->name);
+    printk("                   target");
+    for (size_t l = 0; l < level_count; l++) {
+        printk(" %11u%%", level_results[l].target_percent);
+    }
+    printk("\n                   actual");
+    for (size_t l = 0; l < level_count; l++) {
+        printk(" %9u.%.2u", level_results[l].fill_x100 / 100, level_results[l].fill_x100 % 100);
+    }
+    printk("\n                    files");
+    for (size_t l = 0; l < level_count; l++) {
+        printk(" %12u", level_results[l].files);
+    }
+
+    for (int read = 0; read < 2; read++) {
+        printk("\n%s KB/s\n file_size  block  random", read ? "read" : "write");
+        for (size_t c = 0; c < count; c++) {
+            printk("\n%10u %6u %7d", results[c].file_size_bytes, results[c].block_size_bytes,
+                results[c].random_access);
+            for (size_t l = 0; l < level_count; l++) {
+                const struct fs_perf_config *r = &results[l * count + c];
+
+                print_ceiling_speed(read ? r->avg_read_speed : r->avg_write_speed);
+            }
+        }
+    }
+    printk("\n======================================\n\n");
+}
+
+/******************************************************************/
+/* 挂载时间 */
+static const struct fs_perf_mount_bench *mount_cfg;
+static uint32_t mount_files;        /* 已经创建的小文件数 */
+static uint32_t mount_fill_files;   /* 已经创建的填充文件数 */
+
+static void mount_file_path(char *path, size_t len, uint32_t i)
+{
+    snprintk(path, len, "%s/d%03u/f%04u", mount_cfg->dir, i / mount_cfg->files_per_dir, i);
+}
+
+static void mount_dir_path(char *path, size_t len, uint32_t d)
+{
+    snprintk(path, len, "%s/d%03u", mount_cfg->dir, d);
+}
+
+static void mount_fill_path(char *path, size_t len, uint32_t i)
+{
+    snprintk(path, len, "%s/fill%03u", mount_cfg->dir, i);
+}
+
+static uint32_t mount_dirs(void)
+{
+    return DIV_ROUND_UP(mount_files, mount_cfg->files_per_dir);
+}
+
+/* 写一个 size 字节的填充文件, *written 为实际写入的字节; 写入不足 (空间不足) 时停止并返回 -ENOSPC */
+static int mount_fill_file(const char *path, uint32_t size, uint32_t *written)
+{
+    struct fs_file_t file;
+    int rc;
+
+    *written = 0;
+    rc = file_open_path(&file, path, FS_O_CREATE | FS_O_WRITE);
+    if (rc < 0) {
+        printk("Failed to open %s for writing: %d\n", path, rc);
+        return rc;
+    }
+
+    generate_test_data(buffer, FS_PERF_BLOCK_SIZE_MAX, cur_opts.pattern_base);
+    while (*written < size) {
+        uint32_t chunk_size = MIN(size - *written, FS_PERF_BLOCK_SIZE_MAX);
+        ssize_t wr = fs_write(&file, buffer, chunk_size);
+
+        if (wr > 0) {
+            *written += wr;
+        }
+        if (wr != chunk_size) {
+            printk("Fill %s stopped: %u of %u bytes written (%d)\n", path, *written, size, (int)wr);
+            /* FAT 空间不足时返回写入的字节数, LittleFS 返回 -ENOSPC */
+            rc = (wr >= 0 || wr == -ENOSPC) ? -ENOSPC : (int)wr;
+            break;
+        }
+    }
+
+    int close_rc = test_file_close(&file);
+    return (rc < 0) ? rc : close_rc;
+}
+
+/* 增加小文件到 files 个, 再增加填充文件到 fill_percent */
+static int mount_populate(uint32_t files, uint32_t fill_percent)
+{
+    char path[64];
+    uint64_t used, total, target;
+    uint32_t written;
+    int rc;
+
+    for (; mount_files < files; mount_files++) {
+        if (mount_files % mount_cfg->files_per_dir == 0) {
+            mount_dir_path(path, sizeof(path), mount_files / mount_cfg->files_per_dir);
+            rc = fs_mkdir(path);
+            if (rc < 0 && rc != -EEXIST) {
+                printk("mkdir %s failed: %d\n", path, rc);
+                return rc;
+            }
+        }
+        mount_file_path(path, sizeof(path), mount_files);
+        rc = prepare_test_file(path, mount_cfg->file_size);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+
+    rc = volume_used(&used, &total);
+    if (rc < 0) {
+        return rc;
+    }
+    target = total * fill_percent / 100;
+    while (used < target) {
+        mount_fill_path(path, sizeof(path), mount_fill_files);
+        rc = mount_fill_file(path, (uint32_t)MIN(target - used, (uint64_t)mount_cfg->fill_file_size), &written);
+        mount_fill_files++;
+        if (rc < 0) {
+            printk("Fill to %u%% stopped at %llu of %llu bytes used, last file %u bytes\n",
+                fill_percent, used + written, total, written);
+            return rc;
+        }
+        rc = volume_used(&used, &total);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+    return 0;
+}
+
+static void mount_clean(void)
+{
+    char path[64];
+
+    for (uint32_t i = 0; i < mount_fill_files; i++) {
+        mount_fill_path(path, sizeof(path), i);
+        (void)fs_unlink(path);
+    }
+    for (uint32_t i = 0; i < mount_files; i++) {
+        mount_file_path(path, sizeof(path), i);
+        (void)fs_unlink(path);
+    }
+    for (uint32_t d = 0; d < mount_dirs(); d++) {
+        mount_dir_path(path, sizeof(path), d);
+        (void)fs_unlink(path);
+    }
+    (void)fs_unlink(mount_cfg->dir);
+    mount_files = 0;
+    mount_fill_files = 0;
+}
+
+static int mount_call(int (*fn)(void), const char *what, uint32_t *us)
+{
+    uint64_t start = k_cycle_get_64();
+    int rc = fn();
+
+    *us = (uint32_t)fs_perf_cycles_to_us(k_cycle_get_64() - start);
+    if (rc < 0) {
+        printk("%s %s failed: %d\n", cur_backend->name, what, rc);
+    }
+    return rc;
+}
+
+static int mount_statvfs(uint32_t *us)
+{
+    struct fs_statvfs sbuf;
+    uint64_t start = k_cycle_get_64();
+    int rc = fs_statvfs(cur_backend->mnt_point, &sbuf);
+
+    *us = (uint32_t)fs_perf_cycles_to_us(k_cycle_get_64() - start);
+    if (rc < 0) {
+        printk("FAIL: statvfs: %d\n", rc);
+    }
+    return rc;
+}
+
+static uint32_t max_u32(const uint32_t *v, uint32_t n)
+{
+    uint32_t m = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        m = MAX(m, v[i]);
+    }
+    return m;
+}
+
+/* 一个点: 先重新挂载一次写回填充的数据, 之后每次都是冷挂载 */
+static int mount_measure(struct fs_perf_mount_result *res)
+{
+    int (*do_mount)(void) = (mount_cfg->mount != NULL) ? mount_cfg->mount : cur_backend->mount;
+    int (*do_unmount)(void) = (mount_cfg->unmount != NULL) ? mount_cfg->unmount : cur_backend->unmount;
+    uint32_t mount_us[FS_PERF_SAMPLES_MAX], statvfs_us[FS_PERF_SAMPLES_MAX];
+    uint32_t warm_us[FS_PERF_SAMPLES_MAX], unmount_us[FS_PERF_SAMPLES_MAX];
+    uint32_t ready_us[FS_PERF_SAMPLES_MAX];
+    struct fs_perf_sample_stats st;
+    uint32_t us;
+    int rc;
+
+    rc = mount_call(do_unmount, "unmount", &us);
+    if (rc == 0) {
+        rc = mount_call(do_mount, "mount", &us);
+    }
+    for (uint32_t r = 0; r < mount_cfg->repeats && rc == 0; r++) {
+        rc = mount_call(do_unmount, "unmount", &unmount_us[r]);
+        if (rc < 0) {
+            break;
+        }
+        /* 挂载失败时文件系统不可用，不再继续 */
+        rc = mount_call(do_mount, "mount", &mount_us[r]);
+        if (rc < 0) {
+            break;
+        }
+        rc = mount_statvfs(&statvfs_us[r]);
+        if (rc == 0) {
+            rc = mount_statvfs(&warm_us[r]);
+        }
+        ready_us[r] = mount_us[r] + statvfs_us[r];
+    }
+    if (rc < 0) {
+        return rc;
+    }
+
+    (void)fs_perf_sample_calc(mount_us, mount_cfg->repeats, false, &res->mount_us);
+    (void)fs_perf_sample_calc(statvfs_us, mount_cfg->repeats, false, &res->statvfs_us);
+    (void)fs_perf_sample_calc(warm_us, mount_cfg->repeats, false, &st);
+    res->statvfs_warm_us = st.median;
+    (void)fs_perf_sample_calc(unmount_us, mount_cfg->repeats, false, &st);
+    res->unmount_us = st.median;
+    res->mount_max_us = max_u32(mount_us, mount_cfg->repeats);
+    res->statvfs_max_us = max_u32(statvfs_us, mount_cfg->repeats);
+    res->ready_max_us = max_u32(ready_us, mount_cfg->repeats);
+    return 0;
+}
+
+int fs_perf_run_mount(const struct fs_perf_mount_bench *bench, const struct fs_perf_mount_point *points,
+                      struct fs_perf_mount_result *results, size_t count)
+{
+    uint64_t used, total;
+    int rc = 0;
+
+    memset(results, 0, count * sizeof(*results));
+    for (size_t p = 0; p < count; p++) {
+        results[p].rc = -ECANCELED;
+        if (points[p].fill_percent >= 100 ||
+            (p > 0 && (points[p].files < points[p - 1].files ||
+                       points[p].fill_percent < points[p - 1].fill_percent))) {
+            printk("ERROR: mount points must not decrease, fill < 100%%\n");
+            return -EINVAL;
+        }
+    }
+    if (bench->dir == NULL || bench->files_per_dir == 0 || bench->fill_file_size == 0 ||
+        bench->repeats == 0 || bench->repeats > FS_PERF_SAMPLES_MAX) {
+        return -EINVAL;
+    }
+    if ((bench->mount == NULL ? cur_backend->mount : bench->mount) == NULL ||
+        (bench->unmount == NULL ? cur_backend->unmount : bench->unmount) == NULL) {
+        printk("ERROR: %s has no mount/unmount\n", cur_backend->name);
+        return -EINVAL;
+    }
+
+    mount_cfg = bench;
+    mount_files = 0;
+    mount_fill_files = 0;
+    printk("\n***** %s mount time: dir %s, %u files per dir, file %u bytes, %u repeats *****\n",
+        cur_backend->name, bench->dir, bench->files_per_dir, bench->file_size, bench->repeats);
+    rc = fs_mkdir(bench->dir);
+    if (rc < 0 && rc != -EEXIST) {
+        printk("mkdir %s failed: %d\n", bench->dir, rc);
+        return rc;
+    }
+
+    for (size_t p = 0; p < count; p++) {
+        struct fs_perf_mount_result *res = &results[p];
+
+        rc = mount_populate(points[p].files, points[p].fill_percent);
+        if (rc < 0) {
+            printk("populate %u files, %u%% failed: %d\n", points[p].files, points[p].fill_percent, rc);
+            res->rc = rc;
+            break;
+        }
+        rc = volume_used(&used, &total);
+        if (rc < 0) {
+            res->rc = rc;
+            break;
+        }
+        res->files = mount_files;
+        res->dirs = mount_dirs();
+        res->fill_x100 = (total > 0) ? (uint32_t)(used * 10000 / total) : 0;
+
+        printk("\n>>>>>> %s: %u files in %u dirs, %u.%.2u%% used\n", cur_backend->name,
+            res->files, res->dirs, res->fill_x100 / 100, res->fill_x100 % 100);
+        rc = mount_measure(res);
+        res->rc = rc;
+        if (rc < 0) {
+            break;
+        }
+        printk("mount %u us (max %u), first statvfs %u us (max %u), ready max %u us\n",
+            res->mount_us.median, res->mount_max_us, res->statvfs_us.median, res->statvfs_max_us,
+            res->ready_max_us);
+    }
+
+    /* 挂载失败时删除也会失败, 下次运行时 fs_mkdir 返回 -EEXIST，文件会被覆盖 */
+    mount_clean();
+    return rc;
+}
+
+void fs_perf_print_mount(const struct fs_perf_mount_result *results, size_t count)
+{
+    printk("\n====== %s mount time (us) ======\n", cur_backend->name);
+    printk(" files  dirs   used%%    mount p50     mean   +-ci95      max | statvfs p50      max |"
+            " ready max | warm statvfs  unmount\n");
+    for (size_t p = 0; p < count; p++) {
+        const struct fs_perf_mount_result *r = &results[p];
+
+        if (r->rc < 0) {
+            printk("%6u %5u %4u.%.2u  failed: %d\n", r->files, r->dirs, r->fill_x100 / 100, r->fill_x100 % 100,
+                r->rc);
+            continue;
+        }
+        printk("%6u %5u %4u.%.2u %12u %8u %8u %8u | %11u %8u | %9u | %12u %8u\n",
+            r->files, r->dirs, r->fill_x100 / 100, r->fill_x100 % 100,
+            r->mount_us.median, r->mount_us.mean, r->mount_us.ci95, r->mount_max_us,
+            r->statvfs_us.median, r->statvfs_max_us, r->ready_max_us, r->statvfs_warm_us, r->unmount_us);
+    }
+    printk("ready = mount + first statvfs; each mount follows an unmount that drops the medium cache\n");
+    printk("======================================\n\n");
+}
+
+void fs_perf_deinit(void)
+{
+    int rc;
+
+    /* 清理测试文件 */
+    (void)fs_unlink(cur_backend->test_file);
+
+    if (cur_backend->unmount != NULL) {
+        rc = cur_backend->unmount();
+        if (rc < 0) {
+            printk("%s unmount failed: %d\n", cur_backend->name, rc);
+        }
+    }
+
+    printk("\n***** Finish %s Performance Test *****\n", cur_backend->name);
+}
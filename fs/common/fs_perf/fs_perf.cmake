@@ -0,0 +1,27 @@
+# Copyright (c) 2024 Realtek Semiconductor Corp.
+# SPDX-License-Identifier: Apache-2.0
+#
+# 文件系统性能测试公共库, 在 app 的 CMakeLists.txt 中 find_package(Zephyr) 之后 include
+
+set(FS_PERF_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+target_include_directories(app PRIVATE ${FS_PERF_DIR})
+target_sources(app PRIVATE
+    ${FS_PERF_DIR}/fs_perf.c
+    ${FS_PERF_DIR}/fs_perf_hist.c
+    ${FS_PERF_DIR}/fs_perf_perm.c
+    ${FS_PERF_DIR}/fs_perf_sample.c
+    ${FS_PERF_DIR}/fs_perf_verify.c
+    ${FS_PERF_DIR}/fs_perf_workload.c
+)
+
+# fs_perf_run_mt 统计 worker 线程在 fs 调用中等待文件系统 k_mutex 的时间。
+# 打开后所有的 k_mutex_lock 都经过 fs_perf.c 中的 wrapper, 只有运行多线程测试的 app 在 include 之前
+# set(FS_PERF_LOCK_STATS ON)
+option(FS_PERF_LOCK_STATS "Measure fs mutex waits in fs_perf multi-thread runs" OFF)
+if(FS_PERF_LOCK_STATS)
+    target_compile_definitions(app PRIVATE FS_PERF_LOCK_STATS=1)
+    zephyr_ld_options(
+        -Wl,--wrap=z_impl_k_mutex_lock
+    )
+endif()
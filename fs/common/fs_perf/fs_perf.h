@@ -0,0 +1,480 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * 文件系统性能测试公共库
+ *
+ * performance_fatfs_sd / performance_littlefs_norflash 以及 fs_perf_handover 中的
+ * 测试程序共用同一套 test_write()/test_read()、统计和打印逻辑，介质之间的差异
+ * (挂载方式、测试文件路径、buffer 对齐要求) 通过 struct fs_perf_backend 描述。
+ * 所有计时统一使用 k_cycle_get_64()，不同介质的结果可以直接比较。
+ */
+#ifndef FS_PERF_H_
+#define FS_PERF_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/fs/fs.h>
+
+#include "fs_perf_hist.h"
+#include "fs_perf_sample.h"
+#include "fs_perf_workload.h"
+
+#ifndef FS_PERF_BLOCK_SIZE_MAX
+#define FS_PERF_BLOCK_SIZE_MAX  (32*1024)   /* fs_read|write 单次读|写的 最大大小 */
+#endif
+
+#ifndef FS_PERF_ITERATIONS_MAX
+#define FS_PERF_ITERATIONS_MAX  (20)     /* 不含 warm-up, 不超过 FS_PERF_SAMPLES_MAX */
+#endif
+
+/* buffer 按此对齐，backend->buf_align 不能超过它 */
+#ifndef FS_PERF_BUF_ALIGN_MAX
+#define FS_PERF_BUF_ALIGN_MAX   (4096)
+#endif
+
+/* opts.buf_misalign 的上限 (不含) */
+#define FS_PERF_BUF_MISALIGN_MAX (64)
+
+/* opts.verify 的默认值: 是否检查读出数据的有效性 */
+#ifndef FS_PERF_CHECK_READ_DATA
+#define FS_PERF_CHECK_READ_DATA (1)
+#endif
+
+/* 随机写的时候，速度可能小于1，而 printk 不支持打印浮点，所以放大显示 */
+#define FS_PERF_SPEED_MULTIPLIER (100)
+
+/* 设备层 (文件系统之下) 的访问量, 自 case_start 以来的累计值 */
+struct fs_perf_dev_io {
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    uint64_t erase_bytes;
+    uint32_t erase_count;       /* 擦除操作次数 */
+};
+
+/* 介质/文件系统描述 */
+struct fs_perf_backend {
+    const char *name;           /* 打印用, 例如 "FATFS-SD" */
+    const char *mnt_point;      /* 挂载点, fs_statvfs() 使用 */
+    const char *test_file;      /* 测试文件的完整路径 */
+    uint32_t buf_align;         /* fs_read|write buffer 的对齐要求, 2 的幂, 0 表示不要求 */
+
+    /* 以下回调都是可选的，NULL 表示不需要 (例如 fstab 中 automount 的分区) */
+    int (*mount)(void);
+    int (*unmount)(void);
+    void (*print_info)(void);
+    void (*case_start)(void);   /* 每个 case 开始前, 例如清零介质层的计数器 */
+    void (*case_report)(void);  /* 每个 case 结果打印时, 打印介质层的统计 */
+    /* 每个 case 结束时获取设备层访问量，用于计算写放大 */
+    void (*case_dev_io)(struct fs_perf_dev_io *io);
+
+    /* 打开/关闭测试文件, NULL 表示直接使用 fs_open()/fs_close();
+       用于给文件打开文件系统特有的功能, 例如 FatFs 的 fast seek */
+    int (*file_open)(struct fs_file_t *file, const char *path, fs_mode_t flags);
+    int (*file_close)(struct fs_file_t *file);
+};
+
+struct fs_perf_config {
+    uint32_t file_size_bytes;   // total file size
+    uint32_t block_size_bytes;  // read/write size each time
+    bool random_access;
+    uint32_t seed;  // random_access 时实际使用的排列 seed, 由 fs_perf_run_case 填写
+
+    /* 结果, KB/s * FS_PERF_SPEED_MULTIPLIER, -1 表示没有一次成功 */
+    uint32_t avg_write_speed;
+    uint32_t avg_read_speed;
+    uint32_t read_success_rate_x100;
+    uint32_t write_success_rate_x100;
+    /* 设备写入字节 / fs_write 字节 * 100, backend 没有 case_dev_io 时为 0 */
+    uint32_t write_amp_x100;
+    uint32_t erase_count;
+    /* 成功的 iteration 中每 MB 消耗的 CPU cycle (所有线程, 不含 idle)，
+       以及其中测试线程自己的部分; 需要 CONFIG_THREAD_RUNTIME_STATS, 否则为 0 */
+    uint64_t write_cpu_per_mb;
+    uint64_t read_cpu_per_mb;
+    uint64_t write_caller_cpu_per_mb;
+    uint64_t read_caller_cpu_per_mb;
+    uint32_t write_cpu_util_x100;   /* CPU 忙的时间 / 写测试时间 * 100 */
+    uint32_t read_cpu_util_x100;
+    /* 成功的 iteration 的速度分布 (不含 warm-up)，单位与 avg_* 相同;
+       opts.reject_outliers 时 avg_* 等于其中的 mean */
+    struct fs_perf_sample_stats write_stats;
+    struct fs_perf_sample_stats read_stats;
+    uint32_t iterations;            /* 实际统计的 iteration 数，自适应结束时小于 opts.iterations */
+};
+
+/* 单次 iteration 的统计 */
+struct fs_perf_stats {
+    struct fs_perf_config *config;
+
+    uint64_t read_time_cycles;
+    uint64_t write_time_cycles;
+    uint64_t read_time_us;      // cycles -> us 换算得
+    uint64_t write_time_us;     // cycles -> us 换算得
+
+    uint32_t write_speed_kbps;  // KB/s * FS_PERF_SPEED_MULTIPLIER
+    uint32_t read_speed_kbps;   // KB/s * FS_PERF_SPEED_MULTIPLIER
+    uint32_t written_bytes;
+    uint32_t read_bytes;
+
+    uint32_t write_operations_completed;
+    uint32_t read_operations_completed;
+
+    /* 计时期间 CPU 忙的 cycle 数 (所有线程) 和测试线程运行的 cycle 数 */
+    uint64_t write_cpu_cycles;
+    uint64_t read_cpu_cycles;
+    uint64_t write_caller_cycles;
+    uint64_t read_caller_cycles;
+
+    /* opts.verify 生成/检查数据的 cycle 数, 已经从上面的耗时和 CPU 统计中扣除 */
+    uint64_t write_verify_cycles;
+    uint64_t read_verify_cycles;
+
+    bool read_success;  // true: 每次都读成功
+    bool write_success; // true: 每次都写成功了
+};
+
+/* 分别统计单次耗时的操作 */
+enum fs_perf_op {
+    FS_PERF_OP_READ,
+    FS_PERF_OP_WRITE,
+    FS_PERF_OP_SEEK,
+    FS_PERF_OP_SYNC,
+    FS_PERF_OP_COUNT,
+};
+
+struct fs_perf_options {
+    int iterations;             /* 统计的 iteration 数 (自适应时为上限), <= FS_PERF_ITERATIONS_MAX */
+    int warmup;                 /* 先运行的不统计的 iteration 数，排除冷 cache、新建文件的影响 */
+    /* 自适应: 至少统计 min_iterations 次后，读写速度的 95% 置信区间半宽都不超过平均值的
+       ci_target_permille / 1000 时提前结束; ci_target_permille 为 0 时固定运行 iterations 次 */
+    int min_iterations;
+    uint32_t ci_target_permille;
+    bool reject_outliers;       /* 平均值、标准差、置信区间不含离群的 iteration */
+    uint8_t pattern_base;       /* 第 i 次 iteration 使用 pattern_base + i */
+    bool sync_after_write;      /* 写后 sync，确保数据已经写入设备 */
+    bool unlink_each_iteration; /* 每次 iteration 前删除测试文件 */
+    bool stop_on_error;         /* 读写失败时结束整个 case，否则只记为失败 */
+    uint32_t case_delay_ms;     /* write 和 read 之间的延迟，方便逻辑分析仪区分波形 */
+    uint32_t buf_misalign;      /* fs_read|write buffer 故意偏离对齐位置的字节数, 0 表示对齐 */
+    uint32_t random_seed;       /* 随机访问顺序的 seed, 0 表示每个 case 随机生成 */
+    /* 每个块按文件偏移和 iteration 生成数据, 读出后逐字检查; 生成和检查的时间不计入结果 */
+    bool verify;
+};
+
+#define FS_PERF_OPTIONS_DEFAULT {           \
+    .iterations = 5,                        \
+    .warmup = 1,                            \
+    .min_iterations = 3,                    \
+    .ci_target_permille = 0,                \
+    .reject_outliers = true,                \
+    .pattern_base = 0xA5,                   \
+    .sync_after_write = true,               \
+    .unlink_each_iteration = false,         \
+    .stop_on_error = true,                  \
+    .case_delay_ms = 0,                     \
+    .buf_misalign = 0,                      \
+    .random_seed = 0,                       \
+    .verify = FS_PERF_CHECK_READ_DATA,      \
+}
+
+/**
+ * @brief 挂载 backend，打印文件系统信息并删除旧的测试文件
+ *
+ * @param backend 介质描述，调用方保证在测试期间一直有效
+ * @param opts 测试选项，NULL 表示使用 FS_PERF_OPTIONS_DEFAULT
+ *
+ * @return 0 成功，负数为 errno
+ */
+int fs_perf_init(const struct fs_perf_backend *backend, const struct fs_perf_options *opts);
+
+/**
+ * @brief 修改测试选项，之后运行的 case 生效
+ *
+ * @return 0 成功，-EINVAL 选项不支持
+ */
+int fs_perf_set_options(const struct fs_perf_options *opts);
+
+void fs_perf_get_options(struct fs_perf_options *opts);
+
+/**
+ * @brief 运行一个 case: opts.warmup 次预热，再最多 opts.iterations 次 写+读，计算并打印结果
+ *
+ * 结果保存在 config 的 avg_* / *_stats / *_success_rate_x100 中，成功率按统计的 iteration 计算。
+ *
+ * @return 0 成功; -ENOTSUP 参数不支持; 其它负数为 stop_on_error 时的读写错误
+ */
+int fs_perf_run_case(struct fs_perf_config *config);
+
+/**
+ * @brief 依次运行 configs 中的所有 case
+ *
+ * 参数不支持的 case 打印错误后跳过，读写错误 (stop_on_error) 时立即返回。
+ */
+int fs_perf_run_configs(struct fs_perf_config *configs, size_t count);
+
+/* fs_perf_run_job 的结果 */
+struct fs_perf_job_result {
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t syncs;
+    uint32_t errors;
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    uint64_t io_cycles;         /* 只包含 fs_seek/fs_read/fs_write/fs_sync 的时间 */
+    uint64_t elapsed_cycles;    /* 包含 think time */
+    uint32_t seed;              /* 实际使用的 seed */
+    uint32_t write_amp_x100;    /* backend 没有 case_dev_io 时为 0 */
+};
+
+/**
+ * @brief 按 job 描述运行混合负载
+ *
+ * 先顺序写满 job->file_size 字节 (不计时)，再以读写方式打开测试文件执行 job->ops 次操作。
+ * 使用 opts.random_seed (0 表示随机生成) 作为序列的 seed，opts.stop_on_error 决定出错时是否结束。
+ * 结果和单次操作耗时分布会打印出来，也可以通过 res (可以为 NULL) 和 fs_perf_latency() 获取。
+ *
+ * @return 0 成功; -EINVAL job 参数错误; 其它负数为 errno
+ */
+int fs_perf_run_job(const struct fs_perf_job *job, struct fs_perf_job_result *res);
+
+/* 依次运行 jobs, 读写错误 (stop_on_error) 时立即返回 */
+int fs_perf_run_jobs(const struct fs_perf_job *jobs, size_t count);
+
+/**
+ * @brief 测量 fs_seek 耗时与偏移的关系
+ *
+ * 先顺序写入 file_size 字节的测试文件，再用 backend->file_open 以只读方式打开，
+ * 对 points 个均匀分布的偏移，各测量 repeats 次 "从文件头 seek 到该偏移" 的耗时。
+ *
+ * @return 0 成功，负数为 errno
+ */
+int fs_perf_run_seek_sweep(uint32_t file_size, uint32_t points, uint32_t repeats);
+
+/* fs_perf_run_async_write 的最大队列深度 */
+#ifndef FS_PERF_ASYNC_DEPTH_MAX
+#define FS_PERF_ASYNC_DEPTH_MAX (16)
+#endif
+
+struct fs_async_queue;
+
+/**
+ * @brief 对比 test_write() 与经过 fs_async 队列的异步写
+ *
+ * 先不计时地写出完整的测试文件，再按 config 用 test_write() 同步写一遍，
+ * 然后对 depths 中的每个队列深度，保持最多 depth 个写请求在队列中，按同样的偏移和块大小写
+ * (sync_after_write 时最后提交一个 sync 请求)。打印吞吐量、请求从提交到完成的耗时分布，
+ * 以及队列的合并/重排统计。
+ * 所有请求共用一个 buffer, 写入的是固定的 pattern, 不是 opts.verify 的按偏移生成的数据。
+ *
+ * 需要 app 的 CMakeLists.txt 另外 include fs_async.cmake, 否则不编译。
+ *
+ * @param q 测试文件所在挂载点的队列
+ *
+ * @return 0 成功; -ENOTSUP 参数不支持; 其它负数为 errno
+ */
+int fs_perf_run_async_write(struct fs_perf_config *config, struct fs_async_queue *q,
+    const uint32_t *depths, size_t count);
+
+/* 多线程测试 */
+#ifndef FS_PERF_MT_THREADS_MAX
+#define FS_PERF_MT_THREADS_MAX  (4)
+#endif
+
+/* 每个线程的栈和 buffer 静态分配, thread_cfg 中的 stack_size 不能超过它 */
+#ifndef FS_PERF_MT_STACK_SIZE
+#define FS_PERF_MT_STACK_SIZE   (3072)
+#endif
+
+#ifndef FS_PERF_MT_BLOCK_SIZE_MAX
+#define FS_PERF_MT_BLOCK_SIZE_MAX (4*1024)
+#endif
+
+/* thread_cfg 为 NULL 时使用的优先级, 比 main 线程低 */
+#ifndef FS_PERF_MT_PRIORITY
+#define FS_PERF_MT_PRIORITY     (5)
+#endif
+
+struct fs_perf_mt_thread {
+    int priority;
+    size_t stack_size;          /* 0 表示 FS_PERF_MT_STACK_SIZE */
+};
+
+/* 单个线程的结果 */
+struct fs_perf_mt_thread_result {
+    uint64_t write_bytes;
+    uint64_t read_bytes;
+    uint64_t write_cycles;      /* 从开始写到写完 (含 sync) */
+    uint64_t read_cycles;
+    /* 等待共享文件锁的时间, 只有 same_file 时不为 0 */
+    uint64_t lock_wait_cycles;
+    /* 在 fs 调用中等待其它 k_mutex (VFS、LittleFS 挂载点锁、FatFs 卷锁) 的时间,
+       通过链接器 --wrap=z_impl_k_mutex_lock 统计, 需要 cmake 选项 FS_PERF_LOCK_STATS
+       (见 fs_perf.cmake), 否则为 0 */
+    uint64_t fs_lock_wait_cycles;
+    /* 读写期间线程没有运行的时间 (off-CPU): 除了等锁、等设备，也包括就绪但被同优先级或
+       更高优先级的线程抢占的时间，N 个线程共用一个 CPU 时约为 (N-1)/N。
+       需要 CONFIG_THREAD_RUNTIME_STATS, 否则为 0 */
+    uint64_t offcpu_cycles;
+    uint32_t errors;
+};
+
+struct fs_perf_mt_config {
+    uint32_t threads;           /* 1 ~ FS_PERF_MT_THREADS_MAX */
+    bool same_file;             /* true: 所有线程读写同一个文件的不同区域; false: 每个线程一个文件 */
+    uint32_t file_size;         /* 每个线程读写的字节数 */
+    uint32_t block_size;        /* <= FS_PERF_MT_BLOCK_SIZE_MAX */
+    bool random_access;
+    /* threads 个元素, NULL 表示都使用 FS_PERF_MT_PRIORITY 和 FS_PERF_MT_STACK_SIZE */
+    const struct fs_perf_mt_thread *thread_cfg;
+
+    /* 结果, KB/s * FS_PERF_SPEED_MULTIPLIER, 按所有线程的总字节数和整个阶段的时间计算 */
+    uint32_t agg_write_speed;
+    uint32_t agg_read_speed;
+    struct fs_perf_mt_thread_result thread_res[FS_PERF_MT_THREADS_MAX];
+};
+
+/**
+ * @brief 多个线程同时读写同一个挂载点
+ *
+ * 先不计时地准备好文件，然后所有线程同时开始写 (每个线程写自己的 file_size 字节，
+ * sync_after_write 时最后 sync)，全部写完后再同时开始读。
+ * same_file 时线程共用一个 fs_file_t，seek + read|write 在一把锁内完成，等锁的时间单独统计。
+ * 在 fs 调用内部等待文件系统 k_mutex 的时间也单独统计 (CONFIG_USERSPACE 时系统调用经过
+ * z_vrfy_k_mutex_lock, 不经过 --wrap, 统计为 0)。
+ * 每个线程的结果和总吞吐量会打印出来，也保存在 config 中。
+ *
+ * @return 0 成功; -EINVAL 参数错误; 其它负数为 errno
+ */
+int fs_perf_run_mt(struct fs_perf_mt_config *config);
+
+/* 依次运行 configs, 最后打印吞吐量随线程数变化的汇总表 */
+int fs_perf_run_mt_configs(struct fs_perf_mt_config *configs, size_t count);
+
+/**
+ * @brief 在几乎没有介质延迟的 backend (RAM disk、RAM 模拟的 flash) 上运行同样的 configs
+ *
+ * 结果是 文件系统 + 测试代码 自身的速度上限，用来判断设备上的结果受限于介质还是软件。
+ * 运行期间临时切换到 ceiling (有 mount 回调时挂载)，结束后卸载并切回当前 backend。
+ * configs 复制到 results 后运行; 文件超过 ceiling 可用空间的一半时按 block_size 缩小，
+ * 不影响 KB/s 的比较。没有运行或失败的 case 速度为 -1。
+ *
+ * @return 0 成功; 负数为挂载失败或 stop_on_error 时的读写错误
+ */
+int fs_perf_run_ceiling(const struct fs_perf_backend *ceiling, const struct fs_perf_config *configs,
+                        struct fs_perf_config *results, size_t count);
+
+/* 在当前 backend 的结果旁边打印软件上限，以及设备速度占上限的百分比 */
+void fs_perf_print_ceiling(const struct fs_perf_config *device, const struct fs_perf_config *ceiling,
+                           size_t count);
+
+/* 老化时同时存在的文件数上限; 达到后新增的数据追加到已有的文件 */
+#ifndef FS_PERF_AGING_FILES_MAX
+#define FS_PERF_AGING_FILES_MAX (256)
+#endif
+
+/* 老化: 用混合大小文件的 create/delete/rewrite/append 把卷填到目标比例 */
+struct fs_perf_aging {
+    const char *dir;            /* 老化文件所在目录的完整路径, 不存在时创建 */
+    const struct fs_perf_size_bin *sizes;   /* 新建/重写/追加的大小, 按 weight 选择 */
+    uint32_t size_count;
+    uint32_t churn_ops;         /* 每个比例达到后再做的 delete + create/rewrite 次数, 制造碎片 */
+    uint32_t seed;              /* 0 表示随机生成 */
+    uint64_t max_bytes;         /* 老化最多写入的字节数 (大容量 SD 卡填满太慢), 0 表示不限制 */
+};
+
+/* 一个填充比例的老化结果 */
+struct fs_perf_aging_level {
+    uint32_t target_percent;
+    uint32_t fill_x100;         /* 老化之后 (不含测试文件) 实际的已用比例 * 100 */
+    uint32_t files;
+    uint32_t creates;           /* 累计值, 包含之前的比例 */
+    uint32_t deletes;
+    uint32_t rewrites;
+    uint32_t appends;
+    uint64_t written_bytes;
+    uint64_t aging_ms;          /* 本比例的老化耗时 */
+};
+
+/**
+ * @brief 依次把当前 backend 老化到 levels_percent 中的每个比例, 每个比例运行一遍 configs
+ *
+ * 比例需要从小到大: 老化是累积的，后面的比例在前面的碎片之上继续填充。
+ * 第 l 个比例的结果在 results[l * count + c]; 测试文件放不下 (超过剩余空间的一半) 的 case
+ * 不运行，速度为 -1。结束后删除所有老化文件。
+ *
+ * @return 0 成功; -EINVAL 参数错误; 负数为老化失败或 stop_on_error 时的读写错误
+ */
+int fs_perf_run_aging(const struct fs_perf_aging *aging, const uint32_t *levels_percent, size_t level_count,
+                      struct fs_perf_aging_level *level_results, const struct fs_perf_config *configs,
+                      struct fs_perf_config *results, size_t count);
+
+/* 打印每个 case 的读写速度随填充比例的变化 */
+void fs_perf_print_aging(const struct fs_perf_aging_level *level_results, size_t level_count,
+                         const struct fs_perf_config *results, size_t count);
+
+/* 挂载时间测试的一个点: 卷先被填充到 files 个小文件、fill_percent 的已用比例 (累积) */
+struct fs_perf_mount_point {
+    uint32_t files;
+    uint32_t fill_percent;      /* 0 表示不额外填充 */
+};
+
+struct fs_perf_mount_bench {
+    const char *dir;            /* 填充文件所在目录的完整路径, 不存在时创建 */
+    uint32_t files_per_dir;     /* 小文件分散在 dir/dNNN 子目录中, 每个子目录的文件数 */
+    uint32_t file_size;         /* 每个小文件的字节数 */
+    uint32_t fill_file_size;    /* 填充到 fill_percent 用的大文件, 每个文件的字节数 */
+    uint32_t repeats;           /* 每个点 unmount + mount 的次数, 1 ~ FS_PERF_SAMPLES_MAX */
+    /* 重新挂载, NULL 时使用 backend 的 mount/unmount; unmount 中应清空介质层的缓存，
+       让每次挂载和之后的第一次 fs_statvfs 都和上电后一样是冷的 */
+    int (*mount)(void);
+    int (*unmount)(void);
+};
+
+/* 一个点的结果, 时间单位 us */
+struct fs_perf_mount_result {
+    uint32_t files;
+    uint32_t dirs;
+    uint32_t fill_x100;         /* 实际的已用比例 * 100 */
+    struct fs_perf_sample_stats mount_us;
+    struct fs_perf_sample_stats statvfs_us;     /* 挂载后第一次 fs_statvfs */
+    uint32_t mount_max_us;
+    uint32_t statvfs_max_us;
+    uint32_t ready_max_us;      /* mount + 第一次 fs_statvfs 的最大值, 与启动时间预算比较 */
+    uint32_t statvfs_warm_us;   /* 第二次 fs_statvfs 的中位数 */
+    uint32_t unmount_us;        /* 中位数 */
+    int rc;
+};
+
+/**
+ * @brief 测量当前 backend 的挂载时间随文件数和填充比例的变化
+ *
+ * 按 points 的顺序逐步增加小文件和填充 (files、fill_percent 都不能减少)，每个点先重新挂载一次
+ * 写回填充的数据, 再重复 repeats 次 unmount、mount、fs_statvfs、fs_statvfs。结束后删除填充的文件。
+ *
+ * @return 0 成功; -EINVAL 参数错误; 负数为填充或挂载失败
+ */
+int fs_perf_run_mount(const struct fs_perf_mount_bench *bench, const struct fs_perf_mount_point *points,
+                      struct fs_perf_mount_result *results, size_t count);
+
+void fs_perf_print_mount(const struct fs_perf_mount_result *results, size_t count);
+
+/**
+ * @brief 最近一个 case 中某类操作的耗时直方图 (所有 iteration 累计, 单位 cycle)
+ */
+const struct fs_perf_hist *fs_perf_latency(enum fs_perf_op op);
+
+/* cycles -> us */
+uint64_t fs_perf_cycles_to_us(uint64_t cycles);
+
+/* 删除测试文件并卸载 backend */
+void fs_perf_deinit(void);
+
+/* 打印文件系统的使用情况 */
+void fs_perf_print_fs_status(void);
+
+#endif /* FS_PERF_H_ */
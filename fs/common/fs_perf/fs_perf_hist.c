@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "fs_perf_hist.h"
+
+#include <string.h>
+
+static uint32_t hist_index(uint64_t v)
+{
+    uint32_t msb;
+    uint32_t index;
+
+    if (v < FS_PERF_HIST_SUBS) {
+        return (uint32_t)v;
+    }
+
+    msb = 63 - __builtin_clzll(v);
+    index = ((msb - FS_PERF_HIST_SUB_BITS + 1) << FS_PERF_HIST_SUB_BITS) +
+            (uint32_t)((v >> (msb - FS_PERF_HIST_SUB_BITS)) & (FS_PERF_HIST_SUBS - 1));
+
+    return (index < FS_PERF_HIST_BUCKETS) ? index : FS_PERF_HIST_BUCKETS - 1;
+}
+
+/* 桶中最大的值 */
+static uint64_t hist_upper_bound(uint32_t index)
+{
+    uint32_t major = index >> FS_PERF_HIST_SUB_BITS;
+    uint32_t sub = index & (FS_PERF_HIST_SUBS - 1);
+    uint32_t shift;
+
+    if (major == 0) {
+        return sub;
+    }
+
+    shift = major - 1;
+    return ((uint64_t)(FS_PERF_HIST_SUBS + sub + 1) << shift) - 1;
+}
+
+void fs_perf_hist_reset(struct fs_perf_hist *hist)
+{
+    memset(hist, 0, sizeof(*hist));
+    hist->min = UINT64_MAX;
+}
+
+void fs_perf_hist_record(struct fs_perf_hist *hist, uint64_t cycles)
+{
+    hist->buckets[hist_index(cycles)]++;
+    hist->count++;
+    hist->total += cycles;
+    if (cycles < hist->min) {
+        hist->min = cycles;
+    }
+    if (cycles > hist->max) {
+        hist->max = cycles;
+    }
+}
+
+uint64_t fs_perf_hist_percentile(const struct fs_perf_hist *hist, uint32_t per_10000)
+{
+    uint64_t target;
+    uint64_t seen = 0;
+
+    if (hist->count == 0) {
+        return 0;
+    }
+
+    /* 第 ceil(count * p) 个样本 */
+    target = ((uint64_t)hist->count * per_10000 + 9999) / 10000;
+    if (target == 0) {
+        target = 1;
+    }
+
+    for (uint32_t i = 0; i < FS_PERF_HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= target) {
+            uint64_t upper = (i == FS_PERF_HIST_BUCKETS - 1) ? hist->max : hist_upper_bound(i);
+            return (upper < hist->max) ? upper : hist->max;
+        }
+    }
+
+    return hist->max;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * 单次操作耗时的直方图，单位为 cycle。
+ *
+ * 按 2 的幂分段，每段再等分为 2^FS_PERF_HIST_SUB_BITS 个桶，相对误差不超过
+ * 1/2^FS_PERF_HIST_SUB_BITS。记录只做一次计数，不打印，可以放在计时循环内。
+ */
+#ifndef FS_PERF_HIST_H_
+#define FS_PERF_HIST_H_
+
+#include <stdint.h>
+
+#define FS_PERF_HIST_SUB_BITS   (3)
+#define FS_PERF_HIST_SUBS       (1 << FS_PERF_HIST_SUB_BITS)
+/* 最大可记录 2^40 cycles, 超出的记入最后一个桶 */
+#define FS_PERF_HIST_MAX_BITS   (40)
+#define FS_PERF_HIST_BUCKETS    ((FS_PERF_HIST_MAX_BITS - FS_PERF_HIST_SUB_BITS + 1) * FS_PERF_HIST_SUBS)
+
+struct fs_perf_hist {
+    uint32_t buckets[FS_PERF_HIST_BUCKETS];
+    uint32_t count;
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+};
+
+void fs_perf_hist_reset(struct fs_perf_hist *hist);
+
+void fs_perf_hist_record(struct fs_perf_hist *hist, uint64_t cycles);
+
+/**
+ * @brief 取百分位数
+ *
+ * @param per_10000 百分位 * 100, 例如 p99.9 传 9990
+ *
+ * @return 所在桶的上界 (cycles)，不超过记录到的最大值; 没有记录时返回 0
+ */
+uint64_t fs_perf_hist_percentile(const struct fs_perf_hist *hist, uint32_t per_10000);
+
+#endif /* FS_PERF_HIST_H_ */
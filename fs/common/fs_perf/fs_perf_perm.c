@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "fs_perf_perm.h"
+
+#include <errno.h>
+
+/* murmur3 的 fmix32，作为 Feistel 的轮函数 */
+static uint32_t mix32(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x85ebca6bU;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35U;
+    x ^= x >> 16;
+    return x;
+}
+
+int fs_perf_perm_init(struct fs_perf_perm *perm, uint32_t n, uint32_t seed)
+{
+    uint32_t bits = 2;
+
+    if (n == 0) {
+        return -EINVAL;
+    }
+
+    /* 最小的偶数 bits, 使 2^bits >= n */
+    while (bits < 32 && ((uint64_t)1 << bits) < n) {
+        bits += 2;
+    }
+
+    perm->n = n;
+    perm->half_bits = bits / 2;
+    perm->half_mask = (1U << perm->half_bits) - 1;
+    for (int i = 0; i < FS_PERF_PERM_ROUNDS; i++) {
+        /* splitmix32 生成每一轮的 key */
+        seed += 0x9e3779b9U;
+        perm->keys[i] = mix32(seed);
+    }
+    return 0;
+}
+
+static uint32_t feistel(const struct fs_perf_perm *perm, uint32_t x)
+{
+    uint32_t left = x >> perm->half_bits;
+    uint32_t right = x & perm->half_mask;
+
+    for (int i = 0; i < FS_PERF_PERM_ROUNDS; i++) {
+        uint32_t next = left ^ (mix32(right ^ perm->keys[i]) & perm->half_mask);
+        left = right;
+        right = next;
+    }
+    return (left << perm->half_bits) | right;
+}
+
+uint32_t fs_perf_perm_get(const struct fs_perf_perm *perm, uint32_t index)
+{
+    uint32_t x = index;
+
+    do {
+        x = feistel(perm, x);
+    } while (x >= perm->n);
+
+    return x;
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * [0, n) 上的伪随机排列，O(1) 内存。
+ *
+ * 在不小于 n 的 2^(2h) 上做 h+h 位的平衡 Feistel 变换 (对任意轮函数都是双射)，
+ * 结果 >= n 时对结果继续变换 (cycle walking)，直到落在 [0, n) 内，
+ * 因此得到的仍是 [0, n) 上的双射。2^(2h) < 4n，平均变换不到 4 次。
+ * 同样的 seed 和 n 得到同样的排列。
+ */
+#ifndef FS_PERF_PERM_H_
+#define FS_PERF_PERM_H_
+
+#include <stdint.h>
+
+#define FS_PERF_PERM_ROUNDS     (4)
+
+struct fs_perf_perm {
+    uint32_t n;
+    uint32_t half_bits;
+    uint32_t half_mask;
+    uint32_t keys[FS_PERF_PERM_ROUNDS];
+};
+
+/**
+ * @brief 初始化 [0, n) 上的排列
+ *
+ * @return 0 成功; -EINVAL n 为 0
+ */
+int fs_perf_perm_init(struct fs_perf_perm *perm, uint32_t n, uint32_t seed);
+
+/* 第 index 个元素, index < n */
+uint32_t fs_perf_perm_get(const struct fs_perf_perm *perm, uint32_t index);
+
+#endif /* FS_PERF_PERM_H_ */
@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Ameba 与 native_sim 之间的差异。
+ * native_sim 上没有 D-Cache，也没有 ameba_soc.h 提供的 DCache_xxx / DiagPrintf。
+ */
+#ifndef FS_PERF_PORT_H_
+#define FS_PERF_PORT_H_
+
+#if defined(CONFIG_ARCH_POSIX)
+#include <zephyr/sys/printk.h>
+
+#define DCache_Clean(addr, size)            do { } while (0)
+#define DCache_Invalidate(addr, size)       do { } while (0)
+#define DCache_CleanInvalidate(addr, size)  do { } while (0)
+#define DiagPrintf                          printk
+#else
+#include "ameba_soc.h"
+#endif
+
+/* 清空整个 D-Cache，保证每次测试都从同样的 cache 状态开始 */
+#define FS_PERF_DCACHE_FLUSH_ALL()  DCache_CleanInvalidate(0xFFFFFFFF, 0xFFFFFFFF)
+
+#endif /* FS_PERF_PORT_H_ */
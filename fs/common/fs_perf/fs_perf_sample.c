@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "fs_perf_sample.h"
+
+#include <errno.h>
+#include <string.h>
+
+/* 95% 双侧 t 分布临界值 * 1000, 下标为自由度 - 1; 更大的自由度用 1.960 */
+static const uint16_t t95_x1000[] = {
+    12706, 4303, 3182, 2776, 2571, 2447, 2365, 2306, 2262, 2228,
+    2201, 2179, 2160, 2145, 2131, 2120, 2110, 2101, 2093, 2086,
+    2080, 2074, 2069, 2064, 2060, 2056, 2052, 2048, 2045, 2042,
+};
+
+static uint64_t isqrt64(uint64_t v)
+{
+    uint64_t res = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= res + bit) {
+            v -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return res;
+}
+
+static void sort_u32(uint32_t *v, uint32_t n)
+{
+    for (uint32_t i = 1; i < n; i++) {
+        uint32_t x = v[i];
+        uint32_t j = i;
+
+        while (j > 0 && v[j - 1] > x) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+}
+
+static uint32_t median_sorted(const uint32_t *v, uint32_t n)
+{
+    return (n & 1) ? v[n / 2] : (uint32_t)(((uint64_t)v[n / 2 - 1] + v[n / 2]) / 2);
+}
+
+static uint32_t abs_diff(uint32_t a, uint32_t b)
+{
+    return (a > b) ? a - b : b - a;
+}
+
+int fs_perf_sample_calc(const uint32_t *samples, uint32_t count, bool reject_outliers,
+                        struct fs_perf_sample_stats *st)
+{
+    uint32_t sorted[FS_PERF_SAMPLES_MAX];
+    uint64_t sum = 0, sq_sum = 0;
+    uint32_t n = 0;
+
+    memset(st, 0, sizeof(*st));
+    if (count == 0 || count > FS_PERF_SAMPLES_MAX) {
+        return -EINVAL;
+    }
+
+    memcpy(sorted, samples, count * sizeof(sorted[0]));
+    sort_u32(sorted, count);
+    st->median = median_sorted(sorted, count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        sorted[i] = abs_diff(samples[i], st->median);
+    }
+    sort_u32(sorted, count);
+    st->mad = median_sorted(sorted, count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (st->mad != 0 && (uint64_t)abs_diff(samples[i], st->median) * 6745 > (uint64_t)st->mad * 35000) {
+            st->outlier_mask |= 1UL << i;
+            st->outliers++;
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (reject_outliers && (st->outlier_mask & (1UL << i)) != 0) {
+            continue;
+        }
+        sum += samples[i];
+        n++;
+    }
+    /* 全部是离群值不可能发生: 至少一半的样本离 median 不超过 MAD */
+    st->n = n;
+    st->mean = (uint32_t)(sum / n);
+    if (n < 2) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (reject_outliers && (st->outlier_mask & (1UL << i)) != 0) {
+            continue;
+        }
+        uint64_t d = abs_diff(samples[i], st->mean);
+        sq_sum += d * d;
+    }
+    st->stddev = (uint32_t)isqrt64(sq_sum / (n - 1));
+
+    /* t * s / sqrt(n), sqrt(n) 放大 1000 倍保留精度 */
+    uint32_t t = (n - 1 <= sizeof(t95_x1000) / sizeof(t95_x1000[0])) ? t95_x1000[n - 2] : 1960;
+    st->ci95 = (uint32_t)((uint64_t)t * st->stddev / isqrt64((uint64_t)n * 1000000));
+    return 0;
+}
+
+bool fs_perf_sample_converged(const struct fs_perf_sample_stats *st, uint32_t permille)
+{
+    if (st->n < 2) {
+        return false;
+    }
+    return (uint64_t)st->ci95 * 1000 <= (uint64_t)st->mean * permille;
+}
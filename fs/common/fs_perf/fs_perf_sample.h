@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * 每个 case 多次 iteration 的速度样本的统计。
+ *
+ * 只用整数运算。离群值按 modified z-score (Iglewicz & Hoaglin) 判断:
+ * 0.6745 * |x - median| / MAD > 3.5; MAD 为 0 时不判断。
+ * 95% 置信区间按 t 分布计算: mean ± t(n-1) * stddev / sqrt(n)。
+ */
+#ifndef FS_PERF_SAMPLE_H_
+#define FS_PERF_SAMPLE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* 样本数上限, outlier_mask 每个样本占一位 */
+#define FS_PERF_SAMPLES_MAX     (32)
+
+struct fs_perf_sample_stats {
+    uint8_t n;              /* 参与统计的样本数 (reject_outliers 时不含离群值) */
+    uint8_t outliers;
+    uint32_t outlier_mask;  /* bit i: samples[i] 是离群值 */
+    uint32_t mean;
+    uint32_t median;
+    uint32_t mad;           /* median absolute deviation */
+    uint32_t stddev;        /* 样本标准差 (n - 1) */
+    uint32_t ci95;          /* 95% 置信区间的半宽, n < 2 时为 0 */
+};
+
+/**
+ * @brief 计算 samples[0, count) 的统计值
+ *
+ * median/mad 和离群值总是按全部样本计算;
+ * reject_outliers 时 mean/stddev/ci95 只用非离群的样本。
+ *
+ * @return 0 成功; -EINVAL count 为 0 或超过 FS_PERF_SAMPLES_MAX
+ */
+int fs_perf_sample_calc(const uint32_t *samples, uint32_t count, bool reject_outliers,
+                        struct fs_perf_sample_stats *st);
+
+/* ci95 / mean 是否不超过 permille / 1000; n < 2 时为 false */
+bool fs_perf_sample_converged(const struct fs_perf_sample_stats *st, uint32_t permille);
+
+#endif /* FS_PERF_SAMPLE_H_ */
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "fs_perf_verify.h"
+
+#include <errno.h>
+#include <string.h>
+
+/* 文件偏移 off (4 字节对齐) 处的字; 乘法散列让相邻的字和相邻的 seed 都差很多位 */
+static inline uint32_t verify_word(uint32_t seed, uint32_t off)
+{
+    uint32_t x = (off >> 2) ^ seed;
+
+    x *= 0x9E3779B1u;
+    return x ^ (x >> 16);
+}
+
+/* 文件偏移 off 处的一个字节, 按小端取字中的字节 */
+static inline uint8_t verify_byte(uint32_t seed, uint32_t off)
+{
+    return (uint8_t)(verify_word(seed, off & ~3u) >> ((off & 3u) * 8));
+}
+
+void fs_perf_verify_fill(uint8_t *buf, uint32_t len, uint32_t offset, uint32_t seed)
+{
+    /* 文件偏移不是 4 的倍数时先补齐到字边界 */
+    while (len > 0 && (offset & 3u) != 0) {
+        *buf++ = verify_byte(seed, offset++);
+        len--;
+    }
+    for (; len >= 4; len -= 4, buf += 4, offset += 4) {
+        uint32_t w = verify_word(seed, offset);
+
+        memcpy(buf, &w, 4);
+    }
+    while (len > 0) {
+        *buf++ = verify_byte(seed, offset++);
+        len--;
+    }
+}
+
+int fs_perf_verify_check(const uint8_t *buf, uint32_t len, uint32_t offset, uint32_t seed,
+                         uint32_t *bad_offset, uint32_t *expected)
+{
+    while (len > 0 && (offset & 3u) != 0) {
+        if (*buf != verify_byte(seed, offset)) {
+            goto mismatch;
+        }
+        buf++;
+        offset++;
+        len--;
+    }
+    for (; len >= 4; len -= 4, buf += 4, offset += 4) {
+        uint32_t w;
+
+        memcpy(&w, buf, 4);
+        if (w != verify_word(seed, offset)) {
+            goto mismatch;
+        }
+    }
+    while (len > 0) {
+        if (*buf != verify_byte(seed, offset)) {
+            goto mismatch;
+        }
+        buf++;
+        offset++;
+        len--;
+    }
+    return 0;
+
+mismatch:
+    *bad_offset = offset & ~3u;
+    *expected = verify_word(seed, offset & ~3u);
+    return -EIO;
+}
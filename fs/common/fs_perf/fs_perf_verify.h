@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * 读回数据校验。
+ *
+ * 文件中偏移 off 处的每个 32 位字都由 (seed, off) 生成，seed 每次 iteration 不同:
+ * 读到其它偏移的块、上一次 iteration 的旧数据、或者块中的某个扇区放错位置，都能发现。
+ * 生成和检查都按字处理 (buffer 可以不对齐)，不需要保存期望数据的 buffer。
+ */
+#ifndef FS_PERF_VERIFY_H_
+#define FS_PERF_VERIFY_H_
+
+#include <stdint.h>
+
+/* 生成文件偏移 [offset, offset + len) 的数据, offset 需要 4 字节对齐 */
+void fs_perf_verify_fill(uint8_t *buf, uint32_t len, uint32_t offset, uint32_t seed);
+
+/**
+ * @brief 检查 buf 是否是文件偏移 [offset, offset + len) 的数据
+ *
+ * @param bad_offset 不一致时写入第一个不一致的字所在的文件偏移
+ * @param expected 不一致时写入该字的期望值, 可以从中解出 seed，判断是不是旧数据
+ *
+ * @return 0 一致; -EIO 不一致
+ */
+int fs_perf_verify_check(const uint8_t *buf, uint32_t len, uint32_t offset, uint32_t seed,
+                         uint32_t *bad_offset, uint32_t *expected);
+
+#endif /* FS_PERF_VERIFY_H_ */
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "fs_perf_workload.h"
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+/* xorshift32, 不能为 0 */
+static uint32_t rng_next(struct fs_perf_job_gen *gen)
+{
+    uint32_t x = gen->rng;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    gen->rng = x;
+    return x;
+}
+
+/* [0, n) */
+static uint32_t rng_below(struct fs_perf_job_gen *gen, uint32_t n)
+{
+    return (uint32_t)(((uint64_t)rng_next(gen) * n) >> 32);
+}
+
+/* [0, 1) */
+static double rng_unit(struct fs_perf_job_gen *gen)
+{
+    return rng_next(gen) / 4294967296.0;
+}
+
+static bool dist_valid(const struct fs_perf_job *job, enum fs_perf_dist dist)
+{
+    switch (dist) {
+    case FS_PERF_DIST_SEQ:
+    case FS_PERF_DIST_UNIFORM:
+        return true;
+    case FS_PERF_DIST_ZIPF:
+        return job->zipf_theta_x100 > 0 && job->zipf_theta_x100 < 100;
+    case FS_PERF_DIST_HOTSPOT:
+        return job->hot_percent > 0 && job->hot_percent < 100 && job->hot_access_percent <= 100;
+    case FS_PERF_DIST_STRIDED:
+        return job->stride_blocks > 0;
+    }
+    return false;
+}
+
+/* Gray et al., "Quickly Generating Billion-Record Synthetic Databases" 中的 zipf 生成方法,
+   初始化 O(blocks), 每次生成 O(1) */
+static void zipf_init(struct fs_perf_job_gen *gen)
+{
+    double theta = gen->job->zipf_theta_x100 / 100.0;
+    double zeta2 = 0;
+    double n = gen->blocks;
+
+    gen->zipf_zetan = 0;
+    for (uint32_t i = 1; i <= gen->blocks; i++) {
+        gen->zipf_zetan += 1.0 / pow(i, theta);
+    }
+    for (uint32_t i = 1; i <= 2 && i <= gen->blocks; i++) {
+        zeta2 += 1.0 / pow(i, theta);
+    }
+    gen->zipf_alpha = 1.0 / (1.0 - theta);
+    gen->zipf_half_pow = pow(0.5, theta);
+    gen->zipf_eta = (gen->blocks > 1) ?
+        (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / gen->zipf_zetan) : 0;
+}
+
+/* 排名, 0 最热门 */
+static uint32_t zipf_next(struct fs_perf_job_gen *gen)
+{
+    double u = rng_unit(gen);
+    double uz = u * gen->zipf_zetan;
+    uint32_t rank;
+
+    if (uz < 1.0 || gen->blocks == 1) {
+        return 0;
+    }
+    if (uz < 1.0 + gen->zipf_half_pow) {
+        return 1;
+    }
+    rank = (uint32_t)(gen->blocks * pow(gen->zipf_eta * u - gen->zipf_eta + 1.0, gen->zipf_alpha));
+    return (rank < gen->blocks) ? rank : gen->blocks - 1;
+}
+
+int fs_perf_job_gen_init(struct fs_perf_job_gen *gen, const struct fs_perf_job *job,
+                         uint32_t max_size, uint32_t seed)
+{
+    memset(gen, 0, sizeof(*gen));
+
+    if (job->unit == 0 || job->file_size < job->unit || job->read_percent > 100 ||
+        job->think_us_max < job->think_us_min) {
+        return -EINVAL;
+    }
+    if ((job->read_percent > 0 && !dist_valid(job, job->read_dist)) ||
+        (job->read_percent < 100 && !dist_valid(job, job->write_dist))) {
+        return -EINVAL;
+    }
+
+    for (uint32_t i = 0; i < job->size_count; i++) {
+        if (job->sizes[i].size == 0 || job->sizes[i].size > max_size) {
+            return -EINVAL;
+        }
+        gen->size_weight_total += job->sizes[i].weight;
+    }
+    if (job->sizes == NULL ? job->unit > max_size : gen->size_weight_total == 0) {
+        return -EINVAL;
+    }
+
+    gen->job = job;
+    gen->blocks = job->file_size / job->unit;
+    gen->rng = (seed != 0) ? seed : 0x9e3779b9U;
+
+    if (job->read_dist == FS_PERF_DIST_ZIPF || job->write_dist == FS_PERF_DIST_ZIPF) {
+        (void)fs_perf_perm_init(&gen->perm, gen->blocks, seed);
+        zipf_init(gen);
+    }
+    return 0;
+}
+
+static uint32_t next_block(struct fs_perf_job_gen *gen, enum fs_perf_dist dist, uint32_t *cursor)
+{
+    const struct fs_perf_job *job = gen->job;
+    uint32_t block;
+    uint32_t hot_blocks;
+
+    switch (dist) {
+    case FS_PERF_DIST_STRIDED:
+        block = *cursor;
+        *cursor = (*cursor + job->stride_blocks) % gen->blocks;
+        return block;
+    case FS_PERF_DIST_ZIPF:
+        return fs_perf_perm_get(&gen->perm, zipf_next(gen));
+    case FS_PERF_DIST_HOTSPOT:
+        hot_blocks = (uint64_t)gen->blocks * job->hot_percent / 100;
+        if (hot_blocks == 0) {
+            hot_blocks = 1;
+        }
+        if (hot_blocks >= gen->blocks || rng_below(gen, 100) < job->hot_access_percent) {
+            return rng_below(gen, hot_blocks);
+        }
+        return hot_blocks + rng_below(gen, gen->blocks - hot_blocks);
+    case FS_PERF_DIST_UNIFORM:
+    default:
+        return rng_below(gen, gen->blocks);
+    }
+}
+
+static uint32_t next_size(struct fs_perf_job_gen *gen)
+{
+    const struct fs_perf_job *job = gen->job;
+    uint32_t w;
+
+    if (job->sizes == NULL) {
+        return job->unit;
+    }
+
+    w = rng_below(gen, gen->size_weight_total);
+    for (uint32_t i = 0; i < job->size_count; i++) {
+        if (w < job->sizes[i].weight) {
+            return job->sizes[i].size;
+        }
+        w -= job->sizes[i].weight;
+    }
+    return job->sizes[job->size_count - 1].size;
+}
+
+void fs_perf_job_gen_next(struct fs_perf_job_gen *gen, struct fs_perf_io *io)
+{
+    const struct fs_perf_job *job = gen->job;
+    enum fs_perf_dist dist;
+    uint32_t *cursor;
+
+    io->read = rng_below(gen, 100) < job->read_percent;
+    dist = io->read ? job->read_dist : job->write_dist;
+    cursor = &gen->cursor[io->read ? 0 : 1];
+    /* SEQ 的 cursor 是字节偏移, 按每次实际的大小前进, 前后两次操作首尾相接 */
+    io->offset = (dist == FS_PERF_DIST_SEQ) ? *cursor : next_block(gen, dist, cursor) * job->unit;
+    io->size = next_size(gen);
+    if (io->size > job->file_size - io->offset) {
+        io->size = job->file_size - io->offset;
+    }
+    if (dist == FS_PERF_DIST_SEQ) {
+        *cursor = (io->offset + io->size) % job->file_size;
+    }
+}
+
+uint32_t fs_perf_job_gen_think_us(struct fs_perf_job_gen *gen)
+{
+    const struct fs_perf_job *job = gen->job;
+
+    if (job->think_us_max == 0) {
+        return 0;
+    }
+    return job->think_us_min + rng_below(gen, job->think_us_max - job->think_us_min + 1);
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * 负载描述 (类似 fio 的 job) 和访问序列生成
+ *
+ * 测试文件按 unit 划分为块，每次操作按 read_percent 决定读或写，
+ * 读/写分别按各自的分布选择块，按 sizes 的权重选择操作大小，操作之后等待 think time。
+ * SEQ 不按块: 每次从上一次操作的结尾开始，大小不同时也首尾相接。
+ * 例如:
+ * - 元数据热点: 读写都用 HOTSPOT, 20% 的块承担 80% 的访问
+ * - 追加写 + 随机回读: 写用 SEQ, 读用 UNIFORM
+ * - 70/30 读写混合: read_percent = 70
+ * 随机数使用固定算法，同样的 job 和 seed 生成同样的序列。
+ */
+#ifndef FS_PERF_WORKLOAD_H_
+#define FS_PERF_WORKLOAD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "fs_perf_perm.h"
+
+enum fs_perf_dist {
+    FS_PERF_DIST_SEQ,       /* 顺序, 接着上一次操作的结尾, 到文件尾后回到文件头 */
+    FS_PERF_DIST_UNIFORM,   /* 均匀随机 */
+    FS_PERF_DIST_ZIPF,      /* zipf(theta), 热门的块分散在整个文件中 */
+    FS_PERF_DIST_HOTSPOT,   /* 文件头 hot_percent 的块承担 hot_access_percent 的访问 */
+    FS_PERF_DIST_STRIDED,   /* 每次前进 stride_blocks 个块 */
+};
+
+/* 操作大小的分布: 按 weight 的比例选择 size */
+struct fs_perf_size_bin {
+    uint32_t size;
+    uint32_t weight;
+};
+
+struct fs_perf_job {
+    const char *name;
+    uint32_t file_size;         /* 工作集大小，运行前顺序写满 */
+    uint32_t unit;              /* 块大小，操作的偏移按它对齐 */
+    uint32_t ops;               /* 操作总数 */
+    uint32_t read_percent;      /* 0 ~ 100 */
+    enum fs_perf_dist read_dist;
+    enum fs_perf_dist write_dist;
+
+    uint32_t zipf_theta_x100;   /* ZIPF: theta * 100, 1 ~ 99, 越大越集中 */
+    uint32_t hot_percent;       /* HOTSPOT: 热点块占比 */
+    uint32_t hot_access_percent;/* HOTSPOT: 访问热点块的比例 */
+    uint32_t stride_blocks;     /* STRIDED */
+
+    const struct fs_perf_size_bin *sizes;   /* NULL 表示每次操作 unit 字节 */
+    uint32_t size_count;
+
+    uint32_t think_us_min;      /* 每次操作之后的等待时间, [min, max] 均匀分布 */
+    uint32_t think_us_max;
+    uint32_t sync_every;        /* 每写 N 次 fs_sync 一次, 0 表示只在最后 sync */
+};
+
+/* 一次操作 */
+struct fs_perf_io {
+    bool read;
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct fs_perf_job_gen {
+    const struct fs_perf_job *job;
+    uint32_t blocks;
+    uint32_t rng;
+    uint32_t cursor[2];         /* SEQ 的字节偏移 / STRIDED 的当前块, [0] 读, [1] 写 */
+    uint32_t size_weight_total;
+    struct fs_perf_perm perm;   /* ZIPF: 把排名打散到整个文件 */
+    double zipf_zetan;
+    double zipf_eta;
+    double zipf_alpha;
+    double zipf_half_pow;       /* 0.5^theta */
+};
+
+/**
+ * @brief 检查 job 并初始化生成器
+ *
+ * @param max_size 单次操作的最大字节数 (buffer 大小)
+ *
+ * @return 0 成功; -EINVAL job 参数错误
+ */
+int fs_perf_job_gen_init(struct fs_perf_job_gen *gen, const struct fs_perf_job *job,
+                         uint32_t max_size, uint32_t seed);
+
+/* 下一次操作, offset + size 不超过 file_size */
+void fs_perf_job_gen_next(struct fs_perf_job_gen *gen, struct fs_perf_io *io);
+
+/* 下一次操作之后的 think time (us) */
+uint32_t fs_perf_job_gen_think_us(struct fs_perf_job_gen *gen);
+
+#endif /* FS_PERF_WORKLOAD_H_ */
@@ -0,0 +1,474 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "lfs_usage.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+/* 链接器 --wrap 之后，__real_xxx 是原来的实现 */
+int __real_lfs_mount(lfs_t *lfs, const struct lfs_config *cfg);
+int __real_lfs_unmount(lfs_t *lfs);
+lfs_ssize_t __real_lfs_fs_size(lfs_t *lfs);
+int __real_lfs_file_opencfg(lfs_t *lfs, lfs_file_t *file, const char *path, int flags,
+                            const struct lfs_file_config *cfg);
+int __real_lfs_file_sync(lfs_t *lfs, lfs_file_t *file);
+int __real_lfs_file_close(lfs_t *lfs, lfs_file_t *file);
+int __real_lfs_remove(lfs_t *lfs, const char *path);
+int __real_lfs_rename(lfs_t *lfs, const char *oldpath, const char *newpath);
+int __real_lfs_mkdir(lfs_t *lfs, const char *path);
+
+int __wrap_lfs_mount(lfs_t *lfs, const struct lfs_config *cfg);
+int __wrap_lfs_unmount(lfs_t *lfs);
+lfs_ssize_t __wrap_lfs_fs_size(lfs_t *lfs);
+int __wrap_lfs_file_opencfg(lfs_t *lfs, lfs_file_t *file, const char *path, int flags,
+                            const struct lfs_file_config *cfg);
+int __wrap_lfs_file_sync(lfs_t *lfs, lfs_file_t *file);
+int __wrap_lfs_file_close(lfs_t *lfs, lfs_file_t *file);
+int __wrap_lfs_remove(lfs_t *lfs, const char *path);
+int __wrap_lfs_rename(lfs_t *lfs, const char *oldpath, const char *newpath);
+int __wrap_lfs_mkdir(lfs_t *lfs, const char *path);
+
+/* ctz_blocks() 按 v2 磁盘格式的 CTZ 跳表计算 */
+#if LFS_DISK_VERSION_MAJOR != 2
+#error "lfs_usage only supports LittleFS disk version 2.x"
+#endif
+
+/* 空目录占一个元数据对 */
+#define USAGE_DIR_BLOCKS    (2)
+
+struct usage_slot {
+    lfs_t *lfs;             /* NULL: 空闲 */
+    int32_t used;
+    uint32_t ops;           /* 上次遍历之后的增量更新次数 */
+    bool stale;
+    uint32_t recounts;
+    uint32_t hits;
+};
+
+/* 以写方式打开的文件, 记录上一次提交后数据占用的块数 */
+struct usage_file {
+    lfs_file_t *file;       /* NULL: 空闲 */
+    struct usage_slot *slot;
+    uint32_t blocks;
+    uint32_t size;
+};
+
+/*
+ * slot/file 表的分配和释放受 usage_lock 保护; 同一个实例的计数只在该实例的操作中修改，
+ * 由 Zephyr littlefs 的挂载点锁串行化。
+ */
+static struct usage_slot slots[LFS_USAGE_MOUNTS_MAX];
+static struct usage_file files[LFS_USAGE_FILES_MAX];
+static struct k_spinlock usage_lock;
+static bool usage_enabled = true;
+
+static struct usage_slot *slot_find(const lfs_t *lfs)
+{
+    struct usage_slot *slot = NULL;
+    k_spinlock_key_t key = k_spin_lock(&usage_lock);
+
+    for (uint32_t i = 0; i < LFS_USAGE_MOUNTS_MAX; i++) {
+        if (slots[i].lfs == lfs) {
+            slot = &slots[i];
+            break;
+        }
+    }
+    k_spin_unlock(&usage_lock, key);
+    return slot;
+}
+
+static struct usage_slot *slot_attach(lfs_t *lfs)
+{
+    struct usage_slot *slot = NULL;
+    k_spinlock_key_t key = k_spin_lock(&usage_lock);
+
+    for (uint32_t i = 0; i < LFS_USAGE_MOUNTS_MAX; i++) {
+        if (slots[i].lfs == NULL) {
+            slot = &slots[i];
+            memset(slot, 0, sizeof(*slot));
+            slot->lfs = lfs;
+            slot->stale = true;
+            break;
+        }
+    }
+    k_spin_unlock(&usage_lock, key);
+    return slot;
+}
+
+static void slot_detach(struct usage_slot *slot)
+{
+    k_spinlock_key_t key = k_spin_lock(&usage_lock);
+
+    for (uint32_t i = 0; i < LFS_USAGE_FILES_MAX; i++) {
+        if (files[i].slot == slot) {
+            files[i].file = NULL;
+            files[i].slot = NULL;
+        }
+    }
+    slot->lfs = NULL;
+    k_spin_unlock(&usage_lock, key);
+}
+
+static struct usage_file *file_find(const lfs_file_t *file)
+{
+    struct usage_file *uf = NULL;
+    k_spinlock_key_t key = k_spin_lock(&usage_lock);
+
+    for (uint32_t i = 0; i < LFS_USAGE_FILES_MAX; i++) {
+        if (files[i].file == file) {
+            uf = &files[i];
+            break;
+        }
+    }
+    k_spin_unlock(&usage_lock, key);
+    return uf;
+}
+
+static struct usage_file *file_track(struct usage_slot *slot, lfs_file_t *file, uint32_t blocks,
+                                     uint32_t size)
+{
+    struct usage_file *uf = NULL;
+    k_spinlock_key_t key = k_spin_lock(&usage_lock);
+
+    for (uint32_t i = 0; i < LFS_USAGE_FILES_MAX; i++) {
+        if (files[i].file == NULL) {
+            uf = &files[i];
+            uf->file = file;
+            uf->slot = slot;
+            uf->blocks = blocks;
+            uf->size = size;
+            break;
+        }
+    }
+    k_spin_unlock(&usage_lock, key);
+    return uf;
+}
+
+/*
+ * 有没有提交的写时, lfs_fs_size() 原来的实现还会计入打开的文件已经写入的新块,
+ * 这些块在 sync/close 之后才加到缓存的计数中
+ */
+static bool slot_dirty(const struct usage_slot *slot)
+{
+    bool dirty = false;
+    k_spinlock_key_t key = k_spin_lock(&usage_lock);
+
+    for (uint32_t i = 0; i < LFS_USAGE_FILES_MAX; i++) {
+        if (files[i].slot == slot && (files[i].file->flags & (LFS_F_DIRTY | LFS_F_WRITING))) {
+            dirty = true;
+            break;
+        }
+    }
+    k_spin_unlock(&usage_lock, key);
+    return dirty;
+}
+
+static void file_release(struct usage_file *uf)
+{
+    k_spinlock_key_t key = k_spin_lock(&usage_lock);
+
+    uf->file = NULL;
+    uf->slot = NULL;
+    k_spin_unlock(&usage_lock, key);
+}
+
+static int recount(struct usage_slot *slot)
+{
+    lfs_ssize_t used = __real_lfs_fs_size(slot->lfs);
+
+    if (used < 0) {
+        return used;
+    }
+    slot->used = used;
+    slot->ops = 0;
+    slot->stale = false;
+    slot->recounts++;
+    return 0;
+}
+
+static void slot_add(struct usage_slot *slot, int32_t delta)
+{
+    if (slot->stale) {
+        return;
+    }
+    slot->used += delta;
+    if (slot->used < 0 || slot->used > (int32_t)slot->lfs->cfg->block_count ||
+        ++slot->ops >= LFS_USAGE_RECOUNT_OPS) {
+        slot->stale = true;
+    }
+}
+
+/* 大小为 size 的 CTZ 跳表文件占用的块数, 与 lfs.c 的 lfs_ctz_index() 相同 */
+static uint32_t ctz_blocks(const lfs_t *lfs, uint32_t size)
+{
+    uint32_t b = lfs->cfg->block_size - 2*4;
+    uint32_t off = size - 1;
+    uint32_t i;
+
+    if (size == 0) {
+        return 0;
+    }
+    i = off / b;
+    if (i == 0) {
+        return 1;
+    }
+    i = (off - 4*(__builtin_popcount(i - 1) + 2)) / b;
+    return i + 1;
+}
+
+/*
+ * 按 lfs_stat() 的结果推断释放的块数, 只能少算: 内联文件不超过 cache_size (任何版本的
+ * inline_max 都不超过它)，这个大小以内都按内联计算; 目录只计一个元数据对
+ */
+static uint32_t info_blocks(const lfs_t *lfs, const struct lfs_info *info)
+{
+    if (info->type == LFS_TYPE_DIR) {
+        return USAGE_DIR_BLOCKS;
+    }
+    if (info->size <= lfs->cfg->cache_size) {
+        return 0;
+    }
+    return ctz_blocks(lfs, info->size);
+}
+
+static uint32_t file_size(lfs_t *lfs, lfs_file_t *file)
+{
+    lfs_soff_t size = lfs_file_size(lfs, file);
+
+    return (size < 0) ? 0 : size;
+}
+
+/* 打开的文件当前数据占用的块数; 没有提交的写在 sync/close 之后才真正占用 */
+static uint32_t file_blocks(lfs_t *lfs, lfs_file_t *file)
+{
+    if (file->flags & LFS_F_INLINE) {
+        return 0;
+    }
+    return ctz_blocks(lfs, file_size(lfs, file));
+}
+
+/*
+ * 一次提交之后按新旧块数更新计数; 提交失败时文件的状态不确定。
+ * 内联文件变大时数据写在目录的元数据中, 可能让元数据对分裂
+ */
+static void file_commit(struct usage_file *uf, bool inlined, uint32_t size, uint32_t blocks, int rc)
+{
+    if (rc < 0 || (inlined && size > uf->size)) {
+        uf->slot->stale = true;
+    } else if (blocks != uf->blocks) {
+        slot_add(uf->slot, (int32_t)blocks - (int32_t)uf->blocks);
+    }
+    uf->blocks = blocks;
+    uf->size = size;
+}
+
+int __wrap_lfs_mount(lfs_t *lfs, const struct lfs_config *cfg)
+{
+    struct usage_slot *slot;
+    int rc = __real_lfs_mount(lfs, cfg);
+
+    if (rc < 0) {
+        return rc;
+    }
+    /* 实例太多时不缓存, lfs_fs_size() 照常遍历 */
+    slot = slot_attach(lfs);
+    if (slot != NULL && usage_enabled) {
+        (void)recount(slot);
+    }
+    return rc;
+}
+
+int __wrap_lfs_unmount(lfs_t *lfs)
+{
+    struct usage_slot *slot = slot_find(lfs);
+
+    if (slot != NULL) {
+        slot_detach(slot);
+    }
+    return __real_lfs_unmount(lfs);
+}
+
+lfs_ssize_t __wrap_lfs_fs_size(lfs_t *lfs)
+{
+    struct usage_slot *slot = slot_find(lfs);
+
+    if (slot == NULL || !usage_enabled) {
+        return __real_lfs_fs_size(lfs);
+    }
+    /* 遍历的结果包含没有提交的块, 不更新缓存 */
+    if (slot_dirty(slot)) {
+        slot->recounts++;
+        return __real_lfs_fs_size(lfs);
+    }
+    if (slot->stale) {
+        int rc = recount(slot);
+        if (rc < 0) {
+            return rc;
+        }
+    } else {
+        slot->hits++;
+    }
+    return slot->used;
+}
+
+int __wrap_lfs_file_opencfg(lfs_t *lfs, lfs_file_t *file, const char *path, int flags,
+                            const struct lfs_file_config *cfg)
+{
+    struct usage_slot *slot = slot_find(lfs);
+    struct lfs_info info;
+    uint32_t blocks = 0;
+    bool exists;
+    int rc;
+
+    /* 只读打开不改变占用 */
+    if (slot == NULL || (flags & LFS_O_WRONLY) == 0) {
+        return __real_lfs_file_opencfg(lfs, file, path, flags, cfg);
+    }
+
+    exists = lfs_stat(lfs, path, &info) == 0;
+    /* O_TRUNC 打开后 file 中已经没有原来的数据结构, 先按大小推断 */
+    if (exists && (flags & LFS_O_TRUNC)) {
+        blocks = info_blocks(lfs, &info);
+    }
+    rc = __real_lfs_file_opencfg(lfs, file, path, flags, cfg);
+    if (rc < 0) {
+        return rc;
+    }
+    /* 新建文件在目录中增加一项, 可能让元数据对分裂 */
+    if (!exists) {
+        slot->stale = true;
+    }
+    if ((flags & LFS_O_TRUNC) == 0) {
+        blocks = file_blocks(lfs, file);
+    }
+    if (file_track(slot, file, blocks, file_size(lfs, file)) == NULL) {
+        slot->stale = true;
+    }
+    return rc;
+}
+
+int __wrap_lfs_file_sync(lfs_t *lfs, lfs_file_t *file)
+{
+    struct usage_file *uf = file_find(file);
+    int rc;
+
+    if (uf == NULL) {
+        return __real_lfs_file_sync(lfs, file);
+    }
+    rc = __real_lfs_file_sync(lfs, file);
+    file_commit(uf, (file->flags & LFS_F_INLINE) != 0, file_size(lfs, file), file_blocks(lfs, file), rc);
+    return rc;
+}
+
+int __wrap_lfs_file_close(lfs_t *lfs, lfs_file_t *file)
+{
+    struct usage_file *uf = file_find(file);
+    uint32_t blocks, size;
+    bool inlined;
+    int rc;
+
+    if (uf == NULL) {
+        return __real_lfs_file_close(lfs, file);
+    }
+    /* close 之后 file 不能再访问, 先取提交后的大小 (close 不改变大小和是否内联) */
+    inlined = (file->flags & LFS_F_INLINE) != 0;
+    size = file_size(lfs, file);
+    blocks = file_blocks(lfs, file);
+    rc = __real_lfs_file_close(lfs, file);
+    file_commit(uf, inlined, size, blocks, rc);
+    file_release(uf);
+    return rc;
+}
+
+int __wrap_lfs_remove(lfs_t *lfs, const char *path)
+{
+    struct usage_slot *slot = slot_find(lfs);
+    struct lfs_info info;
+    int rc;
+
+    if (slot == NULL) {
+        return __real_lfs_remove(lfs, path);
+    }
+    if (lfs_stat(lfs, path, &info) < 0) {
+        return __real_lfs_remove(lfs, path);
+    }
+    rc = __real_lfs_remove(lfs, path);
+    if (rc == 0) {
+        slot_add(slot, -(int32_t)info_blocks(lfs, &info));
+    }
+    return rc;
+}
+
+int __wrap_lfs_rename(lfs_t *lfs, const char *oldpath, const char *newpath)
+{
+    struct usage_slot *slot = slot_find(lfs);
+    int rc = __real_lfs_rename(lfs, oldpath, newpath);
+
+    /* 新名字可能在另一个目录中增加一项 (元数据对分裂), 覆盖的 newpath 的块被释放 */
+    if (slot != NULL && rc == 0) {
+        slot->stale = true;
+    }
+    return rc;
+}
+
+int __wrap_lfs_mkdir(lfs_t *lfs, const char *path)
+{
+    struct usage_slot *slot = slot_find(lfs);
+    int rc = __real_lfs_mkdir(lfs, path);
+
+    /* 新目录的元数据对, 以及父目录中新增的一项 (可能分裂) */
+    if (slot != NULL && rc == 0) {
+        slot->stale = true;
+    }
+    return rc;
+}
+
+void lfs_usage_enable(bool enable)
+{
+    usage_enabled = enable;
+}
+
+int lfs_usage_get(const lfs_t *lfs, struct lfs_usage_stats *stats)
+{
+    struct usage_slot *slot = slot_find(lfs);
+
+    memset(stats, 0, sizeof(*stats));
+    if (slot == NULL) {
+        return -ENOENT;
+    }
+    stats->used_blocks = slot->used;
+    stats->recounts = slot->recounts;
+    stats->hits = slot->hits;
+    stats->stale = slot->stale;
+    return 0;
+}
+
+int lfs_usage_check(lfs_t *lfs, int32_t *drift)
+{
+    struct usage_slot *slot = slot_find(lfs);
+    int32_t cached;
+    bool stale;
+    int rc;
+
+    *drift = 0;
+    if (slot == NULL) {
+        return -ENOENT;
+    }
+    if (slot_dirty(slot)) {
+        return -EBUSY;
+    }
+    cached = slot->used;
+    stale = slot->stale;
+    rc = recount(slot);
+    if (rc < 0) {
+        return rc;
+    }
+    if (!stale) {
+        *drift = cached - slot->used;
+    }
+    return 0;
+}
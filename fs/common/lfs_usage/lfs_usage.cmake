@@ -0,0 +1,24 @@
+# Copyright (c) 2024 Realtek Semiconductor Corp.
+# SPDX-License-Identifier: Apache-2.0
+#
+# LittleFS 已用块计数缓存, 在 app 的 CMakeLists.txt 中 find_package(Zephyr) 之后 include
+# 通过链接器的 --wrap 替换 Zephyr littlefs_fs.c 对 lfs_* 的调用, 不需要修改 LittleFS 的代码
+
+set(LFS_USAGE_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+target_include_directories(app PRIVATE ${LFS_USAGE_DIR})
+target_sources(app PRIVATE
+    ${LFS_USAGE_DIR}/lfs_usage.c
+)
+
+zephyr_ld_options(
+    -Wl,--wrap=lfs_mount
+    -Wl,--wrap=lfs_unmount
+    -Wl,--wrap=lfs_fs_size
+    -Wl,--wrap=lfs_file_opencfg
+    -Wl,--wrap=lfs_file_sync
+    -Wl,--wrap=lfs_file_close
+    -Wl,--wrap=lfs_remove
+    -Wl,--wrap=lfs_rename
+    -Wl,--wrap=lfs_mkdir
+)
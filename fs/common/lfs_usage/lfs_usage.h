@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * LittleFS 已用块计数缓存
+ *
+ * LittleFS 没有空闲块计数, Zephyr 的 fs_statvfs 每次都调用 lfs_fs_size() 遍历所有目录和
+ * 文件的块，耗时随文件数线性增长。这里用链接器的 --wrap (见 lfs_usage.cmake) 在挂载时
+ * 遍历一次，之后在已有文件 sync/close 和 remove 时按 CTZ 跳表的块数增量更新，
+ * lfs_fs_size() 直接返回缓存的计数。以写方式打开的文件有没有提交的写时, 这些新块还不在
+ * 计数中, lfs_fs_size() 照常遍历 (结果与原来的实现相同)，直到 sync/close。
+ *
+ * 可能让目录元数据对分裂的操作 (mkdir、新建文件、rename、内联文件变大) 看不到新增的块，
+ * 这些操作之后计数标记为失效，下一次 lfs_fs_size() 重新遍历; 文件记录满或提交失败时也一样。
+ * 另外每 LFS_USAGE_RECOUNT_OPS 次增量更新强制遍历一次。
+ *
+ * 剩下的推断误差都只会多算已用块 (少报空闲块): 删除或 O_TRUNC 打开的文件按 lfs_stat 的大小
+ * 推断，不超过 cache_size (内联文件大小的上限) 时按内联文件 0 块计算; 删除目录只减去
+ * 一个元数据对; 元数据对合并释放的块看不到。坏块搬移不改变块数。
+ * lfs_usage_check() 可以遍历一次，查看偏差并校正。
+ */
+#ifndef LFS_USAGE_H_
+#define LFS_USAGE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <lfs.h>
+
+/* 最多同时挂载的 LittleFS 实例数 */
+#ifndef LFS_USAGE_MOUNTS_MAX
+#define LFS_USAGE_MOUNTS_MAX    (4)
+#endif
+
+/* 最多同时以写方式打开的文件数 (所有实例共用) */
+#ifndef LFS_USAGE_FILES_MAX
+#define LFS_USAGE_FILES_MAX     (16)
+#endif
+
+/* 两次遍历之间最多的增量更新次数, 限制多算的累积 */
+#ifndef LFS_USAGE_RECOUNT_OPS
+#define LFS_USAGE_RECOUNT_OPS   (256)
+#endif
+
+struct lfs_usage_stats {
+    uint32_t used_blocks;   /* 缓存的已用块数, stale 时无意义 */
+    uint32_t recounts;      /* 遍历 (lfs_fs_size 原来的实现) 次数, 包括挂载时的一次和有没有提交的写时 */
+    uint32_t hits;          /* 直接返回缓存计数的 lfs_fs_size() 次数 */
+    bool stale;
+};
+
+/**
+ * @brief 打开/关闭缓存, 默认打开
+ *
+ * 关闭时 lfs_fs_size() 总是遍历，挂载时也不遍历 (用于对比); 计数仍然增量更新，
+ * 但关闭期间挂载的实例在重新打开后第一次 lfs_fs_size() 时才遍历。
+ */
+void lfs_usage_enable(bool enable);
+
+/**
+ * @brief 获取一个已挂载实例的统计
+ *
+ * @return 0 成功; -ENOENT 该实例没有挂载或超过 LFS_USAGE_MOUNTS_MAX
+ */
+int lfs_usage_get(const lfs_t *lfs, struct lfs_usage_stats *stats);
+
+/**
+ * @brief 遍历一次，返回缓存计数与实际已用块数的差值 (缓存 - 实际) 并校正缓存
+ *
+ * 调用方需要保证这期间没有对该实例的其他操作 (例如持有 Zephyr littlefs 的挂载点锁，
+ * 或者没有其他线程访问该挂载点)。
+ *
+ * @return 0 成功; -ENOENT 该实例没有跟踪; -EBUSY 有文件没有提交的写;
+ *         其他为 lfs_fs_size() 的错误
+ */
+int lfs_usage_check(lfs_t *lfs, int32_t *drift);
+
+#endif /* LFS_USAGE_H_ */
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "stream_writer.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+static uint8_t *slot_buf(struct stream_writer *sw, uint32_t idx)
+{
+    return sw->cfg.buffers + (size_t)idx * sw->cfg.buf_size;
+}
+
+/* pending 变化后检查是否跨过水位, 生产者和写线程都会调用 */
+static void backpressure_update(struct stream_writer *sw, uint32_t pending)
+{
+    k_spinlock_key_t key;
+    bool changed = false;
+    bool on;
+
+    key = k_spin_lock(&sw->lock);
+    if (!sw->in_backpressure && pending >= sw->cfg.high_watermark) {
+        sw->in_backpressure = true;
+        sw->stats.backpressure_events++;
+        changed = true;
+    } else if (sw->in_backpressure && pending <= sw->cfg.low_watermark) {
+        sw->in_backpressure = false;
+        changed = true;
+    }
+    on = sw->in_backpressure;
+    k_spin_unlock(&sw->lock, key);
+
+    if (changed && sw->cfg.backpressure != NULL) {
+        sw->cfg.backpressure(sw, on, sw->cfg.user_data);
+    }
+}
+
+static void writer_thread(void *p1, void *p2, void *p3)
+{
+    struct stream_writer *sw = p1;
+    struct stream_writer_slot *slot;
+    uint64_t start_cycles;
+    uint32_t pending;
+    int rc;
+
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    while (true) {
+        start_cycles = k_cycle_get_64();
+        k_sem_take(&sw->full_sem, K_FOREVER);
+        sw->stats.writer_idle_cycles += k_cycle_get_64() - start_cycles;
+
+        slot = &sw->slots[sw->cons_idx];
+        start_cycles = k_cycle_get_64();
+        rc = 0;
+        if (slot->cmd == STREAM_WRITER_CMD_WRITE) {
+            /* 出错后丢弃后面的数据 */
+            if (slot->len > 0 && atomic_get(&sw->error) == 0) {
+                rc = fs_write(sw->cfg.file, slot_buf(sw, sw->cons_idx), slot->len);
+                if (rc >= 0 && rc != slot->len) {
+                    rc = -ENOSPC;
+                }
+                if (rc >= 0) {
+                    sw->stats.bytes += slot->len;
+                    sw->stats.writes++;
+                    rc = 0;
+                }
+            }
+        } else if (atomic_get(&sw->error) == 0) {
+            rc = fs_sync(sw->cfg.file);
+        }
+        sw->stats.write_cycles += k_cycle_get_64() - start_cycles;
+        if (rc < 0) {
+            printk("stream_writer: %s failed: %d\n",
+                (slot->cmd == STREAM_WRITER_CMD_WRITE) ? "fs_write" : "fs_sync", rc);
+            (void)atomic_cas(&sw->error, 0, rc);
+        }
+
+        uint8_t cmd = slot->cmd;
+
+        sw->cons_idx = (sw->cons_idx + 1) % sw->cfg.depth;
+        pending = (uint32_t)atomic_dec(&sw->pending) - 1;
+        k_sem_give(&sw->free_sem);
+        backpressure_update(sw, pending);
+
+        if (cmd != STREAM_WRITER_CMD_WRITE) {
+            k_sem_give(&sw->done_sem);
+        }
+        if (cmd == STREAM_WRITER_CMD_STOP) {
+            return;
+        }
+    }
+}
+
+int stream_writer_start(struct stream_writer *sw, const struct stream_writer_config *cfg)
+{
+    if (cfg->file == NULL || cfg->buffers == NULL || cfg->buf_size == 0 ||
+        cfg->depth < 2 || cfg->depth > STREAM_WRITER_DEPTH_MAX || cfg->stack == NULL) {
+        return -EINVAL;
+    }
+
+    memset(sw, 0, sizeof(*sw));
+    sw->cfg = *cfg;
+    if (sw->cfg.high_watermark == 0 || sw->cfg.high_watermark > cfg->depth) {
+        sw->cfg.high_watermark = cfg->depth;
+    }
+    if (sw->cfg.low_watermark == 0 || sw->cfg.low_watermark >= sw->cfg.high_watermark) {
+        sw->cfg.low_watermark = sw->cfg.high_watermark / 2;
+    }
+
+    k_sem_init(&sw->free_sem, cfg->depth, cfg->depth);
+    k_sem_init(&sw->full_sem, 0, cfg->depth);
+    k_sem_init(&sw->done_sem, 0, 1);
+    atomic_set(&sw->pending, 0);
+    atomic_set(&sw->error, 0);
+
+    k_thread_create(&sw->thread, cfg->stack, cfg->stack_size, writer_thread,
+        sw, NULL, NULL, cfg->priority, 0, K_NO_WAIT);
+    k_thread_name_set(&sw->thread, "stream_writer");
+    return 0;
+}
+
+int stream_writer_get_buf(struct stream_writer *sw, uint8_t **buf, k_timeout_t timeout)
+{
+    uint64_t start_cycles;
+    int rc = (int)atomic_get(&sw->error);
+
+    if (rc < 0) {
+        return rc;
+    }
+
+    if (!sw->have_buf) {
+        /* 没有空闲 buffer 时才计入等待时间 */
+        if (k_sem_take(&sw->free_sem, K_NO_WAIT) != 0) {
+            start_cycles = k_cycle_get_64();
+            rc = k_sem_take(&sw->free_sem, timeout);
+            sw->stats.producer_wait_cycles += k_cycle_get_64() - start_cycles;
+            if (rc != 0) {
+                return -EAGAIN;
+            }
+        }
+        sw->have_buf = true;
+        sw->fill = 0;
+    }
+
+    *buf = slot_buf(sw, sw->prod_idx);
+    return 0;
+}
+
+static void submit(struct stream_writer *sw, uint32_t len, enum stream_writer_cmd cmd)
+{
+    uint32_t pending;
+
+    sw->slots[sw->prod_idx].len = len;
+    sw->slots[sw->prod_idx].cmd = cmd;
+    sw->prod_idx = (sw->prod_idx + 1) % sw->cfg.depth;
+    sw->have_buf = false;
+    sw->fill = 0;
+
+    pending = (uint32_t)atomic_inc(&sw->pending) + 1;
+    if (pending > sw->stats.max_pending) {
+        sw->stats.max_pending = pending;
+    }
+    k_sem_give(&sw->full_sem);
+    backpressure_update(sw, pending);
+}
+
+int stream_writer_commit(struct stream_writer *sw, uint32_t len)
+{
+    if (!sw->have_buf || len > sw->cfg.buf_size) {
+        return -EINVAL;
+    }
+
+    submit(sw, len, STREAM_WRITER_CMD_WRITE);
+    return (int)atomic_get(&sw->error);
+}
+
+int stream_writer_write(struct stream_writer *sw, const void *data, size_t len, k_timeout_t timeout)
+{
+    const uint8_t *src = data;
+    size_t copied = 0;
+    uint32_t chunk;
+    uint8_t *buf;
+    int rc;
+
+    while (copied < len) {
+        rc = stream_writer_get_buf(sw, &buf, timeout);
+        if (rc == -EAGAIN && copied > 0) {
+            break;
+        }
+        if (rc < 0) {
+            return rc;
+        }
+
+        chunk = MIN(len - copied, sw->cfg.buf_size - sw->fill);
+        memcpy(buf + sw->fill, src + copied, chunk);
+        sw->fill += chunk;
+        copied += chunk;
+
+        if (sw->fill == sw->cfg.buf_size) {
+            submit(sw, sw->fill, STREAM_WRITER_CMD_WRITE);
+        }
+    }
+
+    return (int)copied;
+}
+
+/* 提交未填满的 buffer 和一个 SYNC/STOP 命令, 等写线程处理完 */
+static int submit_and_wait(struct stream_writer *sw, enum stream_writer_cmd cmd)
+{
+    uint64_t start_cycles;
+
+    if (sw->have_buf && sw->fill > 0) {
+        submit(sw, sw->fill, STREAM_WRITER_CMD_WRITE);
+    }
+    if (!sw->have_buf) {
+        start_cycles = k_cycle_get_64();
+        k_sem_take(&sw->free_sem, K_FOREVER);
+        sw->stats.producer_wait_cycles += k_cycle_get_64() - start_cycles;
+    }
+    submit(sw, 0, cmd);
+
+    k_sem_take(&sw->done_sem, K_FOREVER);
+    return (int)atomic_get(&sw->error);
+}
+
+int stream_writer_flush(struct stream_writer *sw)
+{
+    return submit_and_wait(sw, STREAM_WRITER_CMD_SYNC);
+}
+
+int stream_writer_stop(struct stream_writer *sw)
+{
+    int rc = submit_and_wait(sw, STREAM_WRITER_CMD_STOP);
+
+    (void)k_thread_join(&sw->thread, K_FOREVER);
+    return rc;
+}
+
+uint32_t stream_writer_pending(struct stream_writer *sw)
+{
+    return (uint32_t)atomic_get(&sw->pending);
+}
+
+void stream_writer_stats_get(struct stream_writer *sw, struct stream_writer_stats *stats)
+{
+    *stats = sw->stats;
+}
@@ -0,0 +1,11 @@
+# Copyright (c) 2024 Realtek Semiconductor Corp.
+# SPDX-License-Identifier: Apache-2.0
+#
+# 异步流式写文件, 在 app 的 CMakeLists.txt 中 find_package(Zephyr) 之后 include
+
+set(STREAM_WRITER_DIR ${CMAKE_CURRENT_LIST_DIR})
+
+target_include_directories(app PRIVATE ${STREAM_WRITER_DIR})
+target_sources(app PRIVATE
+    ${STREAM_WRITER_DIR}/stream_writer.c
+)
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * 异步流式写文件: 生产者填 buffer 的同时，写线程把已经填好的 buffer 写入文件
+ *
+ *   producer: stream_writer_get_buf -> 填数据 -> stream_writer_commit -> ...
+ *   writer  :                   fs_write(buffer 0)  fs_write(buffer 1) ...
+ *
+ * depth 个 buffer 组成环, depth = 2 就是双 buffer。所有 buffer 都在排队时
+ * stream_writer_get_buf() 阻塞 (或超时返回 -EAGAIN)，生产者因此被限速。
+ * 排队的 buffer 数达到 high_watermark 时通过 backpressure 回调通知生产者
+ * (例如降低采样率或丢帧)，降到 low_watermark 以下时再通知一次。
+ *
+ * 写线程的优先级必须比生产者高，否则生产者不阻塞时写线程得不到运行，
+ * 两者就不能重叠。重叠的前提是 fs_write 期间写线程会让出 CPU (例如等 SD 卡 DMA 完成)。
+ *
+ * 只支持一个生产者线程。fs_write 出错后写线程丢弃后面的数据，错误由之后的
+ * get_buf / commit / flush / stop 返回。
+ */
+#ifndef STREAM_WRITER_H_
+#define STREAM_WRITER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+
+#ifndef STREAM_WRITER_DEPTH_MAX
+#define STREAM_WRITER_DEPTH_MAX     (8)
+#endif
+
+struct stream_writer;
+
+/* on: true 进入背压状态, false 解除; 在生产者或写线程中调用, 不能阻塞 */
+typedef void (*stream_writer_backpressure_cb_t)(struct stream_writer *sw, bool on, void *user_data);
+
+struct stream_writer_config {
+    struct fs_file_t *file;     /* 已打开的文件, 写入位置从当前位置开始 */
+    uint8_t *buffers;           /* depth * buf_size 字节, 按介质要求对齐 */
+    uint32_t buf_size;          /* 每次 fs_write 的大小, 对齐时同样要求 buf_size 是对齐的倍数 */
+    uint32_t depth;             /* 2 ~ STREAM_WRITER_DEPTH_MAX */
+
+    k_thread_stack_t *stack;    /* 写线程的栈 */
+    size_t stack_size;
+    int priority;               /* 写线程的优先级, 必须比生产者高 */
+
+    /* 0 表示 depth 和 depth / 2 */
+    uint32_t high_watermark;
+    uint32_t low_watermark;
+    stream_writer_backpressure_cb_t backpressure;
+    void *user_data;
+};
+
+struct stream_writer_stats {
+    uint64_t bytes;             /* 写入文件的字节数 */
+    uint32_t writes;            /* fs_write 次数 */
+    uint32_t max_pending;       /* 同时排队的最大 buffer 数 */
+    uint32_t backpressure_events;
+    uint64_t write_cycles;      /* 写线程在 fs_write/fs_sync 中的时间 */
+    uint64_t writer_idle_cycles;    /* 写线程等数据的时间 */
+    uint64_t producer_wait_cycles;  /* 生产者等空闲 buffer 的时间 */
+};
+
+enum stream_writer_cmd {
+    STREAM_WRITER_CMD_WRITE,
+    STREAM_WRITER_CMD_SYNC,
+    STREAM_WRITER_CMD_STOP,
+};
+
+struct stream_writer_slot {
+    uint32_t len;
+    uint8_t cmd;                /* enum stream_writer_cmd */
+};
+
+/* 内部状态, 由 stream_writer_start 初始化 */
+struct stream_writer {
+    struct stream_writer_config cfg;
+    struct k_thread thread;
+    struct k_sem free_sem;      /* 空闲 buffer 数 */
+    struct k_sem full_sem;      /* 排队的 buffer 数 */
+    struct k_sem done_sem;      /* SYNC/STOP 完成 */
+    struct stream_writer_slot slots[STREAM_WRITER_DEPTH_MAX];
+    uint32_t prod_idx;          /* 只由生产者修改 */
+    uint32_t cons_idx;          /* 只由写线程修改 */
+    atomic_t pending;
+    atomic_t error;             /* 第一个错误 */
+    bool in_backpressure;
+    bool have_buf;              /* 生产者持有 slots[prod_idx] */
+    uint32_t fill;              /* stream_writer_write 已经填入当前 buffer 的字节数 */
+    struct k_spinlock lock;     /* 保护 in_backpressure */
+    struct stream_writer_stats stats;
+};
+
+/**
+ * @brief 启动写线程
+ *
+ * @return 0 成功, -EINVAL 参数错误
+ */
+int stream_writer_start(struct stream_writer *sw, const struct stream_writer_config *cfg);
+
+/**
+ * @brief 取一个空闲 buffer, 大小为 buf_size
+ *
+ * 必须先 commit 之前取得的 buffer 才能再取。
+ *
+ * @return 0 成功; -EAGAIN 超时 (所有 buffer 都在排队); 其它负数为之前 fs_write 的错误
+ */
+int stream_writer_get_buf(struct stream_writer *sw, uint8_t **buf, k_timeout_t timeout);
+
+/* 把 get_buf 取得的 buffer 的前 len 字节交给写线程, len <= buf_size */
+int stream_writer_commit(struct stream_writer *sw, uint32_t len);
+
+/**
+ * @brief 复制数据到当前 buffer, 填满后自动 commit
+ *
+ * @return 复制的字节数 (超时时可能小于 len); 负数为错误
+ */
+int stream_writer_write(struct stream_writer *sw, const void *data, size_t len, k_timeout_t timeout);
+
+/* commit 未填满的 buffer, 等所有排队的数据写完后 fs_sync, 返回第一个错误 */
+int stream_writer_flush(struct stream_writer *sw);
+
+/* flush 后结束写线程; 文件由调用方关闭 */
+int stream_writer_stop(struct stream_writer *sw);
+
+/* 当前排队等待写入的 buffer 数 */
+uint32_t stream_writer_pending(struct stream_writer *sw);
+
+void stream_writer_stats_get(struct stream_writer *sw, struct stream_writer_stats *stats);
+
+#endif /* STREAM_WRITER_H_ */
@@ -3,111 +3,141 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
-#include "ameba_soc.h"
+#include "fs_perf_port.h"
 
 #include <stdio.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/fs/fs.h>
-#include <zephyr/kernel.h>  // for k_msleep()
-#include <zephyr/random/random.h>
+#include <zephyr/kernel.h>
 #include <zephyr/fs/fs_sys.h>
 #include <zephyr/sys/printk.h>
+#ifdef CONFIG_THREAD_ANALYZER
+#include <zephyr/debug/thread_analyzer.h>
+#endif
 #include <string.h>
 #include <stdlib.h>
+#include <errno.h>
 
 #include <ff.h>
-#include "diag.h"
+#include <diskio.h>
+
+#include "fs_perf.h"
+#include "fs_async.h"
+#include "disk_cache.h"
+#include "fatfs_ext.h"
+#include "stream_writer.h"
 
-#include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(fatfs_sd);
 
+/* DISK_NAME 是 FatFs 使用的名字，由 disk_cache 注册;
+   LOWER_DISK_NAME 是 app.overlay 中真正的 disk 驱动的 disk-name */
 #if defined(CONFIG_DISK_DRIVER_SDMMC)
 #define DISK_NAME "SD"
+#define LOWER_DISK_NAME "SDMMC"
+#elif defined(CONFIG_DISK_DRIVER_RAM)
+/* native_sim: 用 RAM disk 代替 SD 卡 */
+#define DISK_NAME "RAM"
+#define LOWER_DISK_NAME "RAMDISK"
 #else
 #error "Failed to select DISK access type"
 #endif
 
 #define FATFS_MNTP	"/"DISK_NAME":"
-#define TEST_FILE	FATFS_MNTP"/testfile.txt"
+#define TEST_FILE_NAME      FATFS_MNTP"/test.dat"
+#define TEST_ITERATIONS     (10)    /* 自适应结束时的上限 */
+/* 每个 case 先运行不统计的 warm-up; 至少统计 TEST_MIN_ITERATIONS 次后，读写速度的
+   95% 置信区间半宽都不超过平均值的 TEST_CI_TARGET_PERMILLE / 1000 时提前结束 (0: 固定次数) */
+#define TEST_WARMUP         (1)
+#define TEST_MIN_ITERATIONS (3)
+#define TEST_CI_TARGET_PERMILLE (20)
 
-/* 测试配置 */
-#define SYNC_AFTER_WRITE (1)    // 写后 sync，确保数据已经写入设备
-#define USE_SYSRAND (0)
-
-// #define PRINT_SINGLE_WRITE_TIME (1)          // 打印每次 fs_write 的耗时
-#define TEST_BLOCK_SIZE_MAX     (32*1024)       /* fs_read|write 单次读|写的 最大大小 */
-#define TEST_FILE_NAME      "/SD:/test.dat"
-#define TEST_ITERATIONS     (5)
+#define RW_DATA_PATTREN_BASE (0xA5)
 
-#if USE_DELAY_FOR_LA
-#define DELAY_LA(ms) k_msleep(ms)
-#else
-#define DELAY_LA(ms)    /* empty */
+/* 扇区缓存: 0 表示只转发不缓存 */
+#define DISK_CACHE_SECTORS  (DISK_CACHE_SECTORS_MAX)
+/* 1: 每个 config 先在关闭缓存时跑一遍，再打开缓存跑一遍，方便对比 */
+#define DISK_CACHE_COMPARE  (1)
+/* 1: 再用不对齐的 buffer 跑一遍，对比 disk_cache 处理不对齐 buffer 的效果 */
+#define BUF_MISALIGN_COMPARE (1)
+#define BUF_MISALIGN_BYTES  (3)
+/* 1: 再关闭连续扇区写合并跑一遍，对比合并的效果 (看 disk_cache commands 中的 merge ratio) */
+#define COALESCE_COMPARE    (1)
+/* 1: 再关闭 disk_cache 的顺序预读跑一遍，对比小块顺序读的速度 */
+#define READAHEAD_COMPARE   (1)
+/* 1: 再打开 fast seek 跑一遍，对比随机访问的速度; 需要 FatFs 配置 FF_USE_FASTSEEK = 1 */
+#define FASTSEEK_COMPARE    (1)
+/* 1: 所有 config 跑完后，分别在 fast seek 关闭/打开时测量 seek 耗时与偏移的关系 */
+#define SEEK_SWEEP          (1)
+#define SEEK_SWEEP_FILE_SIZE (8*1024*1024)
+#define SEEK_SWEEP_POINTS   (16)
+#define SEEK_SWEEP_REPEATS  (10)
+/* 1: 每次 iteration 新建文件，对比 写入时分配 cluster 与 预分配连续空间 (需要 FF_USE_EXPAND = 1) */
+#define PREALLOC_COMPARE    (1)
+#define PREALLOC_FILE_SIZE  (8*1024*1024)
+/* 1: 最后运行 jobs[] 中的混合负载 */
+#define WORKLOAD_JOBS       (1)
+/* 1: 最后运行 mt_configs[], 看多个线程同时访问同一个挂载点时吞吐量随线程数的变化;
+      需要 CONFIG_FS_FATFS_REENTRANT */
+#define MT_BENCH            (1)
+/* 1: 对比 test_write() 与 fs_async 队列深度 async_depths[] 的异步写 */
+#define ASYNC_BENCH         (1)
+/* 1: 最后对比 生产数据后同步 fs_write 与 stream_writer 异步写入 的持续写入速度;
+      生产者每个 buffer 除了生成数据，再忙等 stream_produce_us[] 模拟编码等计算 */
+#define STREAM_BENCH        (1)
+#define STREAM_FILE_SIZE    (8*1024*1024)
+#define STREAM_BUF_SIZE     (32*1024)
+/* 静态占用 STREAM_DEPTH_MAX * STREAM_BUF_SIZE 字节 RAM */
+#define STREAM_DEPTH_MAX    (3)
+/* 1: 先在 RAM disk 上运行 configs[] 得到软件上限 (FatFs + 测试代码本身的速度)，
+      之后每一轮结果后面打印 SD 卡速度占上限的百分比。RAM disk 占 1 MB RAM, 只在编译时加上
+      -DEXTRA_DTC_OVERLAY_FILE=sw_ceiling.overlay -DEXTRA_CONF_FILE=sw_ceiling.conf 时运行。
+      native_sim 上被测设备本身就是 RAM disk，不运行 */
+#define SW_CEILING          (1)
+
+/* 1: 在卷上逐步增加文件和目录，反复 unmount + mount，测量挂载时间和挂载后第一次 fs_statvfs
+      (FSINFO 无效或不信任时 FatFs 需要扫描 FAT 统计空闲 cluster) 的耗时，与启动时间预算比较 */
+#define MOUNT_BENCH         (1)
+/* 1: 再填充到 mount_points[] 中的比例; 大容量卡耗时很长 */
+#define MOUNT_BENCH_FILL    (0)
+#define MOUNT_BENCH_REPEATS (10)
+
+/* 挂载后空闲 cluster 数的策略 (见 fatfs_ext.h): FATFS_EXT_FSINFO_TRUST 信任 FSINFO;
+   FATFS_EXT_FSINFO_VERIFY 同时在低优先级线程中扫描 FAT 校验 */
+#define FSINFO_POLICY       (FATFS_EXT_FSINFO_TRUST)
+/* 1: 分别按 不信任 / 信任 / 信任 + 后台校验 冷挂载，测量挂载后第一次 fs_statvfs 的耗时
+      和后台扫描的耗时; 不信任时的扫描时间与卡的容量成正比 */
+#define FSINFO_BENCH        (1)
+#define FSINFO_BENCH_REPEATS (3)
+
+/* 1: 最后把卷依次老化到 aging_levels[] 的填充比例 (混合大小文件的 create/delete/rewrite)，
+      每个比例运行一遍 configs[]，看速度随填充和碎片的变化。
+      需要写满整张卡的 95%，大容量卡耗时很长，默认关闭; AGING_MAX_BYTES 非 0 时限制写入量 */
+#define AGING_BENCH         (0)
+#define AGING_MAX_BYTES     (0ULL)
+
+#if SW_CEILING && !(defined(CONFIG_DISK_DRIVER_SDMMC) && defined(CONFIG_DISK_DRIVER_RAM))
+#undef SW_CEILING
+#define SW_CEILING          (0)
 #endif
 
-#define CHECK_READ_DATA (0) //  是否检查读出数据的有效性
-#define RW_DATA_PATTREN_BASE (0xA5)
-static unsigned char grw_data_pattern = 0x50;
-
 /************************ START LA **********************/
-// 使用逻辑分析仪时，为了方便看波形，引入下面两个宏
+// 使用逻辑分析仪时，为了方便看波形，引入下面的宏
 #define LA_ANALYSIS (0) // 1：给逻辑分析仪采集波形用
 
 #if LA_ANALYSIS
-#define DELAY_BETWEEN_CASES (1)     // 在 READ 和 WRITE 之间插入延迟，方便区分 32KB-write块 和 32KB-read块的波形。
-#undef CHECK_READ_DATA
-#define CHECK_READ_DATA (0) // LA 中，使用默认的 0xA5, 方便看数据
+#define DELAY_BETWEEN_CASES_MS (1000)     // 在 READ 和 WRITE 之间插入延迟，方便区分 32KB-write块 和 32KB-read块的波形。
 #else
-#define DELAY_BETWEEN_CASES (0)
+#define DELAY_BETWEEN_CASES_MS (0)
 #endif
-
-#define USE_DELAY_FOR_LA (0)    // 进一步区分 fs_open、fs_read|write、fs_close 之间的波形
 /************************ END LA **********************/
 
-struct fs_test_config {
-    uint32_t file_size_bytes;   // total file size
-    uint32_t block_size_bytes;  // read/write size each time
-    bool random_access;
-    uint32_t rows;  // random matrix row
-    uint32_t cols;  // random matrix columns
-
-    uint32_t avg_write_speed;
-    uint32_t avg_read_speed;
-};
-
-/* 性能统计结构体 */
-struct perf_stats {
-    struct fs_test_config *config;
-    uint64_t write_time_ms;
-    uint32_t write_time_us;
-    uint64_t read_time_ms;
-    uint32_t write_speed_kbps;
-    uint32_t read_speed_kbps;
-    uint32_t write_operations_completed;
-    uint32_t read_operations_completed;
-};
-
-/* fs_read|write API的 buffer 必须32字节对齐，否则读速度会大幅降低。
- nuwa\zephyr\subsys\sd\sd_ops.c中的 card_read_blocks() 会检查buffer是否对齐，
- 不对齐时，使用内部buffer，SD卡数据-->card internal buffer --> API buffer
- 相当于 将整个读到的数据 memcpy 了一遍。
- */
-__attribute__((aligned(32))) 
-static uint8_t buffer[TEST_BLOCK_SIZE_MAX];
-
-#if CHECK_READ_DATA
-__attribute__((aligned(32))) 
-static uint8_t expected_buffer[TEST_BLOCK_SIZE_MAX];
-#endif
-
-/* 全局统计 */
-static struct perf_stats stats[TEST_ITERATIONS];
-
-static struct fs_test_config configs[] = {
+static struct fs_perf_config configs[] = {
 #if 1
 // 临时测试
     {8*1024*1024, 32*1024, 0},
     {8*1024*1024, 32*1024, 1},
+    {8*1024*1024, 1*1024,  0},
+    {8*1024*1024, 1*1024,  1},
 #endif
 
 #if 0
@@ -134,112 +164,195 @@ static struct fs_test_config configs[] = {
 #endif
 };
 
-/* FatFs work area */
-static FATFS fat_fs;
+#if SW_CEILING
+/* configs[] 在 RAM disk 上的结果 */
+static struct fs_perf_config ceiling_configs[ARRAY_SIZE(configs)];
+#endif
 
-/* mounting info */
-static struct fs_mount_t fatfs_mnt = {
-	.type = FS_FATFS,
-	.mnt_point = FATFS_MNTP,
-	.fs_data = &fat_fs,
+#if MOUNT_BENCH
+static const struct fs_perf_mount_point mount_points[] = {
+    {0,     0},
+    {256,   0},
+    {2048,  0},
+#if MOUNT_BENCH_FILL
+    {2048,  10},
+    {2048,  50},
+#endif
 };
+static struct fs_perf_mount_result mount_results[ARRAY_SIZE(mount_points)];
+#endif
 
-/******************************************************************/
-#define RANDOM_COL_RANGE (1024)
-#define RANDOM_ROW_RANGE (64)
-
-// 全局变量：随机排列
-uint8_t randrows[RANDOM_ROW_RANGE];  // 行的随机排列
-uint16_t randcols[RANDOM_COL_RANGE];  // 列的随机排列
-
-// 初始化随机排列
-void RandomPermutationsInitialize(int M, int N) {
-    if (M > RANDOM_ROW_RANGE || N > RANDOM_COL_RANGE) {
-        printf("error: random row %d > %d, col %d > %d\n",
-            M, RANDOM_ROW_RANGE, N, RANDOM_COL_RANGE);
-        return;
-    }
+#if AGING_BENCH
+static const uint32_t aging_levels[] = {10, 50, 80, 95};
 
-    // 初始化randrows数组为0到M-1
-    for (int i = 0; i < M; i++) {
-        randrows[i] = i;
-    }
-    
-    // 初始化randcols数组为0到N-1
-    for (int j = 0; j < N; j++) {
-        randcols[j] = j;
-    }
-    
-    // 打乱randrows数组 (Fisher-Yates洗牌算法)
-    for (int i = M - 1; i > 0; i--) {
-        int j = sys_rand32_get() % (i + 1);
-        // 交换randrows[i]和randrows[j]
-        int temp = randrows[i];
-        randrows[i] = randrows[j];
-        randrows[j] = temp;
-    }
-    
-    // 打乱randcols数组 (Fisher-Yates洗牌算法)
-    for (int i = N - 1; i > 0; i--) {
-        int j = sys_rand32_get() % (i + 1);
-        // 交换randcols[i]和randcols[j]
-        int temp = randcols[i];
-        randcols[i] = randcols[j];
-        randcols[j] = temp;
-    }
+static const struct fs_perf_size_bin aging_sizes[] = {
+    {16*1024,       30},
+    {256*1024,      40},
+    {1024*1024,     20},
+    {4*1024*1024,   10},
+};
 
-#if 0
-    // 打印随机排列的值
-    printf("rand rows [%d]: ", M);
-    for (int i = 0; i < M; i++) {
-        printf("%d ", randrows[i]);
-    }
-    printf("\n");
-    
-    printf("rand columns [%d]: ", N);
-    for (int j = 0; j < N; j++) {
-        printf("%d ", randcols[j]);
-    }
-    printf("\n\n");
+static const struct fs_perf_aging aging = {
+    .dir = FATFS_MNTP"/aging",
+    .sizes = aging_sizes,
+    .size_count = ARRAY_SIZE(aging_sizes),
+    .churn_ops = 200,
+    .max_bytes = AGING_MAX_BYTES,
+};
+
+static struct fs_perf_aging_level aging_level_results[ARRAY_SIZE(aging_levels)];
+static struct fs_perf_config aging_results[ARRAY_SIZE(aging_levels) * ARRAY_SIZE(configs)];
 #endif
 
-    DCache_Clean((uint32_t)randrows, sizeof(randrows[0])*M);
-    DCache_Clean((uint32_t)randcols, sizeof(randcols[0])*N);
-}
+#if PREALLOC_COMPARE
+static struct fs_perf_config prealloc_configs[] = {
+    {PREALLOC_FILE_SIZE, 32*1024, 0},
+};
+#endif
 
-static uint32_t RandomPermutationsGet(uint32_t row, uint32_t col, uint32_t columns) {
-    uint32_t value = randrows[row] * columns + randcols[col];
-    return value;
-}
+#if WORKLOAD_JOBS
+static const struct fs_perf_size_bin mixed_sizes[] = {
+    {512,       50},
+    {4*1024,    40},
+    {32*1024,   10},
+};
 
-static uint32_t last_offset = 0;
-uint32_t get_random(uint32_t file_size, uint32_t block_size) {
-    uint32_t offset;
-    do {
-#if 1
-    // 重复率高
-        offset = sys_rand32_get() % (file_size/block_size) * block_size;
+static const struct fs_perf_size_bin append_sizes[] = {
+    {4*1024,    50},
+    {32*1024,   50},
+};
+
+static const struct fs_perf_job jobs[] = {
+    {
+        /* 目录项/索引等少量热点块被频繁读改写 */
+        .name = "metadata hotspot",
+        .file_size = 8*1024*1024, .unit = 4*1024, .ops = 2000,
+        .read_percent = 70,
+        .read_dist = FS_PERF_DIST_HOTSPOT, .write_dist = FS_PERF_DIST_HOTSPOT,
+        .hot_percent = 5, .hot_access_percent = 90,
+        .sync_every = 16,
+    },
+    {
+        /* 录像: 顺序写入，同时随机回放 */
+        .name = "append + random read-back",
+        .file_size = 8*1024*1024, .unit = 4*1024, .ops = 1000,
+        .read_percent = 50,
+        .read_dist = FS_PERF_DIST_UNIFORM, .write_dist = FS_PERF_DIST_SEQ,
+        .sizes = append_sizes, .size_count = ARRAY_SIZE(append_sizes),
+    },
+    {
+        .name = "zipf 70/30 mixed sizes",
+        .file_size = 8*1024*1024, .unit = 512, .ops = 2000,
+        .read_percent = 70,
+        .read_dist = FS_PERF_DIST_ZIPF, .write_dist = FS_PERF_DIST_ZIPF,
+        .zipf_theta_x100 = 90,
+        .sizes = mixed_sizes, .size_count = ARRAY_SIZE(mixed_sizes),
+        .think_us_min = 0, .think_us_max = 2000,
+    },
+    {
+        .name = "strided read",
+        .file_size = 8*1024*1024, .unit = 4*1024, .ops = 1000,
+        .read_percent = 100,
+        .read_dist = FS_PERF_DIST_STRIDED, .stride_blocks = 64,
+    },
+};
 #endif
 
-#if 0
-    // 重复率高
-        offset = sys_rand32_get() % file_size;
-        offset = offset / block_size *block_size;
+#if MT_BENCH
+/* 同优先级的线程只在阻塞 (等锁、等 SD 卡) 时切换, 需要轮转时配置 CONFIG_TIMESLICE_SIZE */
+static const struct fs_perf_mt_thread mt_threads[] = {
+    {K_PRIO_PREEMPT(5), 0},
+    {K_PRIO_PREEMPT(5), 0},
+    {K_PRIO_PREEMPT(6), 0},
+    {K_PRIO_PREEMPT(7), 0},
+};
+
+#define MT_CONFIG(n, same) \
+    {.threads = (n), .same_file = (same), .file_size = 1024*1024, .block_size = 4*1024, .thread_cfg = mt_threads}
+
+static struct fs_perf_mt_config mt_configs[] = {
+    MT_CONFIG(1, false),
+    MT_CONFIG(2, false),
+    MT_CONFIG(3, false),
+    MT_CONFIG(4, false),
+    MT_CONFIG(1, true),
+    MT_CONFIG(2, true),
+    MT_CONFIG(3, true),
+    MT_CONFIG(4, true),
+};
 #endif
 
-#if 0
-        // 重复率高
-        offset = _rand() % file_size;
-        offset = offset / block_size *block_size;
+#if ASYNC_BENCH
+static struct fs_perf_config async_configs[] = {
+    {8*1024*1024, 4*1024, 0},
+    {8*1024*1024, 4*1024, 1},
+};
+static const uint32_t async_depths[] = {1, 4, 16};
+
+/* work queue 优先级比 main 低: main 提交到队列满才让出 CPU，请求可以成批合并、排序 */
+#define ASYNC_QUEUE_PRIORITY    K_PRIO_PREEMPT(1)
+static K_THREAD_STACK_DEFINE(async_stack, 2048);
+static uint8_t async_merge_buf[32*1024] __aligned(32);
+static struct fs_async_queue async_queue;
 #endif
-    } while(offset == last_offset);
 
-    last_offset = offset;
-    return offset;
-}
+#if STREAM_BENCH
+/* 0 表示不用 stream_writer, 生产者自己 fs_write */
+static const uint32_t stream_depths[] = {0, 2, STREAM_DEPTH_MAX};
+static const uint32_t stream_produce_us[] = {0, 2000, 8000};
+
+/* 写线程使用最低的协作优先级，比 main 高 */
+#define STREAM_WRITER_PRIORITY  K_PRIO_COOP(CONFIG_NUM_COOP_PRIORITIES - 1)
+static K_THREAD_STACK_DEFINE(stream_stack, 2048);
+static uint8_t stream_buffers[STREAM_DEPTH_MAX * STREAM_BUF_SIZE] __aligned(32);
+static struct stream_writer stream;
+#endif
+
+/* 每一轮用不同的 缓存大小 / buffer 偏移 运行 configs[] */
+struct test_pass {
+    const char *title;
+    uint32_t cache_sectors;
+    uint32_t buf_misalign;
+    uint32_t coalesce_sectors;
+    bool fastseek;              /* 读测试时打开 fast seek */
+    uint32_t readahead_sectors;
+};
+
+static const struct test_pass passes[] = {
+#if DISK_CACHE_COMPARE
+    {"disk cache off", 0, 0, 0, false, 0},
+#endif
+#if COALESCE_COMPARE
+    {"disk cache on, coalesce off", DISK_CACHE_SECTORS, 0, 0, false, DISK_CACHE_RA_SECTORS_MAX},
+#endif
+#if READAHEAD_COMPARE
+    {"disk cache on, read-ahead off", DISK_CACHE_SECTORS, 0, DISK_CACHE_COALESCE_SECTORS_MAX, false, 0},
+#endif
+    {"disk cache on", DISK_CACHE_SECTORS, 0, DISK_CACHE_COALESCE_SECTORS_MAX, false, DISK_CACHE_RA_SECTORS_MAX},
+#if BUF_MISALIGN_COMPARE
+    {"disk cache on, buffer misaligned", DISK_CACHE_SECTORS, BUF_MISALIGN_BYTES, DISK_CACHE_COALESCE_SECTORS_MAX, false,
+        DISK_CACHE_RA_SECTORS_MAX},
+#endif
+#if FASTSEEK_COMPARE
+    {"disk cache on, fast seek", DISK_CACHE_SECTORS, 0, DISK_CACHE_COALESCE_SECTORS_MAX, true, DISK_CACHE_RA_SECTORS_MAX},
+#endif
+};
+
+/* FatFs work area */
+static FATFS fat_fs;
+
+/* mounting info */
+static struct fs_mount_t fatfs_mnt = {
+	.type = FS_FATFS,
+	.mnt_point = FATFS_MNTP,
+	.fs_data = &fat_fs,
+};
+
 /******************************************************************/
 static unsigned char win[512];
-void print_fatfs_info(FATFS* fs) {
+static void print_fatfs_info(void)
+{
+    FATFS *fs = &fat_fs;
     int sect=0;
     memset(win, 0, sizeof(win[0])*512);
     if (disk_read(fs->pdrv, win, sect, 1) == 0) {
@@ -257,380 +370,596 @@ void print_fatfs_info(FATFS* fs) {
 
         int BPB_BytsPerSec = win[11] + (win[12] << 8);
         int BPB_SecPerClus = win[13];
-        printf("BPB_BytsPerSec %d, BPB_SecPerClus %d, cluster %d bytes\n", 
+        printf("BPB_BytsPerSec %d, BPB_SecPerClus %d, cluster %d bytes\n",
             BPB_BytsPerSec, BPB_SecPerClus, BPB_BytsPerSec*BPB_SecPerClus);
     } else {
         printk("read boot sector failed\n");
     }
+    LOG_INF("fatfs.win %p\n", fat_fs.win);
 }
 
-/* 生成测试数据 */
-static void generate_test_data(uint8_t *buffer, size_t size, uint8_t pattern)
+static enum fatfs_ext_fsinfo_policy fsinfo_policy = FSINFO_POLICY;
+
+static int fatfs_mount(void)
 {
-#if CHECK_READ_DATA
-    for (size_t i = 0; i < size; i++) {
-        buffer[i] = (pattern + i) & 0xFF;
+    int rc = disk_cache_register(DISK_NAME, LOWER_DISK_NAME, DISK_CACHE_SECTORS);
+    if (rc < 0) {
+        return rc;
     }
-#else
-    memset(buffer, pattern&0xFF, size);
-#endif
 
-    DCache_Clean((uint32_t)buffer, size);
+    rc = fs_mount(&fatfs_mnt);
+    if (rc < 0) {
+        LOG_INF("FAT file system mounting failed, [%d]\n", rc);
+        return rc;
+    }
+    LOG_INF("FAT file system mounting successfully\n");
+    return fatfs_ext_fsinfo_apply(&fatfs_mnt, fsinfo_policy);
 }
 
-/* 测试顺序写入 */
-static int test_write(struct perf_stats *stat)
+static int fatfs_unmount(void)
 {
-    struct fs_file_t file;
-    int rc;
-    int64_t start_time, end_time;
-    uint32_t start_time_us, end_time_us;
-    uint32_t block_size = stat->config->block_size_bytes;
-    uint32_t file_size = stat->config->file_size_bytes;
-    uint32_t chunk_size;    // chunk size read or write each time
-
-    /* 打开文件用于写入 */
-    DELAY_LA(100);
-    fs_file_t_init(&file);
-    rc = fs_open(&file, TEST_FILE_NAME, FS_O_CREATE | FS_O_WRITE);
+    /* 后台校验在读这个卷的 FAT */
+    fatfs_ext_fsinfo_cancel();
+
+    int rc = fs_unmount(&fatfs_mnt);
+    if (rc < 0) {
+        LOG_INF("Error unmount FAT file system [%d]\n", rc);
+    } else {
+        LOG_INF("unmount FAT file system successfully\n");
+    }
+
+    /* 旧版本的 fatfs_unmount 不发 DISK_IOCTL_CTRL_DEINIT, 这里再写回一次 */
+    int flush_rc = disk_cache_flush();
+    return (rc < 0) ? rc : flush_rc;
+}
+
+/* fast seek 期间文件不能变大，所以只在只读打开时使用 */
+static bool fastseek_on;
+
+/* 非 0: 写测试打开文件时预分配的字节数 */
+static uint32_t prealloc_size;
+/* 预分配的文件只有一个片段: 1 (大小) + 2 (片段) + 1 (结束) */
+static uint32_t prealloc_clmt[4];
+
+/* 预分配不计入写测试的时间，单独打印 */
+static void fatfs_preallocate(struct fs_file_t *file)
+{
+    uint64_t start_cycles = k_cycle_get_64();
+    int rc = fatfs_ext_preallocate(file, prealloc_size);
+    if (rc < 0) {
+        printk("preallocate %u bytes failed: %d\n", prealloc_size, rc);
+        return;
+    }
+
+    /* 文件大小已经固定，打开 fast seek 后写入时不再读 FAT 表 */
+    rc = fatfs_ext_fastseek_enable(file, prealloc_clmt, ARRAY_SIZE(prealloc_clmt));
+    printk("preallocate %u bytes: %llu us, fast seek %d\n",
+        prealloc_size, fs_perf_cycles_to_us(k_cycle_get_64() - start_cycles), rc);
+}
+
+static int fatfs_file_open(struct fs_file_t *file, const char *path, fs_mode_t flags)
+{
+    int rc = fs_open(file, path, flags);
     if (rc < 0) {
-        printk("Failed to open file for writing: %d\n", rc);
         return rc;
     }
-    
-    /* 生成测试数据 */
-    generate_test_data(buffer, block_size, grw_data_pattern);
-    
-    /* 开始计时 */
-    start_time = k_uptime_get();    // ms
-    start_time_us = DTimestamp_Get();
-
-    /* 写入 */
-    size_t total_written = 0;
-    uint32_t offset;
-    int row_start = 0;
-    int row = 0;
-    int col  = 0;
-    DiagPrintf("\n");
-    DELAY_LA(100);
-    while (total_written < file_size) {
-        if (stat->config->random_access) {
-#if USE_SYSRAND
-            offset = get_random(file_size, block_size);
-#else
-            offset = RandomPermutationsGet(row, col, stat->config->cols);
-            offset = offset * block_size;
+
+    if ((flags & FS_O_WRITE) != 0) {
+        if (prealloc_size != 0) {
+            fatfs_preallocate(file);
+        }
+        return 0;
+    }
+    if (!fastseek_on) {
+        return 0;
+    }
+
+    rc = fatfs_ext_fastseek_enable(file, NULL, 0);
+    if (rc < 0) {
+        /* 不支持时按普通模式继续测试 */
+        printk("fast seek enable failed: %d\n", rc);
+    } else {
+        printk("fast seek on, %d fragments\n", fatfs_ext_fastseek_fragments(file));
+    }
+    return 0;
+}
+
+static void fatfs_case_start(void)
+{
+    disk_cache_stats_reset();
+}
+
+/* SD 卡没有擦除统计，设备写入量按 disk_cache 下发给 lower 的扇区计算 */
+static void fatfs_case_dev_io(struct fs_perf_dev_io *io)
+{
+    struct disk_cache_stats stats;
+
+    disk_cache_stats_get(&stats);
+    io->read_bytes = (uint64_t)stats.read_cmd_sectors * DISK_CACHE_SECTOR_SIZE;
+    io->write_bytes = (uint64_t)stats.write_cmd_sectors * DISK_CACHE_SECTOR_SIZE;
+}
+
+static const struct fs_perf_backend fatfs_backend = {
+    .name = "FATFS-" DISK_NAME,
+    .mnt_point = FATFS_MNTP,
+    .test_file = TEST_FILE_NAME,
+    /* sd_ops.c 中的 card_read_blocks() 要求 buffer 32 字节对齐，否则经内部 buffer 中转 */
+    .buf_align = 32,
+    .mount = fatfs_mount,
+    .unmount = fatfs_unmount,
+    .print_info = print_fatfs_info,
+    .case_start = fatfs_case_start,
+    .case_report = disk_cache_stats_print,
+    .case_dev_io = fatfs_case_dev_io,
+    .file_open = fatfs_file_open,
+    .file_close = fatfs_ext_close,
+};
+
+#if MOUNT_BENCH || FSINFO_BENCH
+/* 卸载后清空 disk_cache, 之后的挂载和第一次 statvfs 都从 SD 卡读，与上电后相同 */
+static int fatfs_cold_unmount(void)
+{
+    int rc = fatfs_unmount();
+
+    if (rc == 0) {
+        rc = disk_cache_resize(DISK_CACHE_SECTORS);
+    }
+    return rc;
+}
+
+/* disk_cache 已经注册, 只挂载文件系统 */
+static int fatfs_cold_mount(void)
+{
+    int rc = fs_mount(&fatfs_mnt);
+
+    if (rc == 0) {
+        rc = fatfs_ext_fsinfo_apply(&fatfs_mnt, fsinfo_policy);
+    }
+    return rc;
+}
+#endif
+
+#if MOUNT_BENCH
+
+static const struct fs_perf_mount_bench mount_bench = {
+    .dir = FATFS_MNTP"/mnt",
+    .files_per_dir = 128,
+    .file_size = 4*1024,
+    .fill_file_size = 64*1024*1024,
+    .repeats = MOUNT_BENCH_REPEATS,
+    .mount = fatfs_cold_mount,
+    .unmount = fatfs_cold_unmount,
+};
 #endif
-            // DiagPrintf("w [%d][%d] %u\n", row, col, offset);
-            rc = fs_seek(&file, offset, FS_SEEK_SET);
+
+#if FSINFO_BENCH
+static const enum fatfs_ext_fsinfo_policy fsinfo_policies[] = {
+    FATFS_EXT_FSINFO_SCAN,
+    FATFS_EXT_FSINFO_TRUST,
+    FATFS_EXT_FSINFO_VERIFY,
+};
+
+static const char *const fsinfo_policy_names[] = {
+    [FATFS_EXT_FSINFO_SCAN] = "scan",
+    [FATFS_EXT_FSINFO_TRUST] = "trust",
+    [FATFS_EXT_FSINFO_VERIFY] = "verify",
+};
+
+static const char *const verify_result_names[] = {
+    [FATFS_EXT_VERIFY_NONE] = "-",
+    [FATFS_EXT_VERIFY_RUNNING] = "running",
+    [FATFS_EXT_VERIFY_MATCH] = "match",
+    [FATFS_EXT_VERIFY_CORRECTED] = "corrected",
+    [FATFS_EXT_VERIFY_BUSY] = "busy",
+    [FATFS_EXT_VERIFY_CANCELED] = "canceled",
+    [FATFS_EXT_VERIFY_ERROR] = "error",
+};
+
+/* 每种策略冷挂载 FSINFO_BENCH_REPEATS 次: 挂载、第一次 fs_statvfs 的耗时, 以及后台扫描的耗时和结果 */
+static int run_fsinfo_bench(void)
+{
+    struct fatfs_ext_fsinfo_status st;
+    struct fs_statvfs sv;
+    int rc = 0;
+
+    printk("\n>>>>>> time to first statvfs by FSINFO policy\n");
+    printk("%-8s %10s %12s %12s %8s %12s %10s %10s %-10s %s\n", "policy", "mount us", "statvfs us",
+        "free clust", "fsinfo", "fsinfo free", "scan ms", "scan free", "verify", "stack unused");
+
+    for (size_t p = 0; p < ARRAY_SIZE(fsinfo_policies) && rc == 0; p++) {
+        for (int r = 0; r < FSINFO_BENCH_REPEATS && rc == 0; r++) {
+            uint64_t t0, t1, t2;
+
+            rc = fatfs_cold_unmount();
             if (rc < 0) {
-                printk("Seek failed: %d, offset %d\n", rc, offset);
                 break;
             }
-        }
+            fsinfo_policy = fsinfo_policies[p];
+            t0 = k_cycle_get_64();
+            rc = fatfs_cold_mount();
+            t1 = k_cycle_get_64();
+            if (rc == 0) {
+                rc = fs_statvfs(FATFS_MNTP, &sv);
+            }
+            t2 = k_cycle_get_64();
+            if (rc < 0) {
+                printk("%-8s failed: %d\n", fsinfo_policy_names[fsinfo_policy], rc);
+                break;
+            }
 
-#if PRINT_SINGLE_WRITE_TIME
-        uint32_t t1 = DTimestamp_Get();
-#endif
-    
-        // printk("fs_write\n");
-        DELAY_LA(200);
-        chunk_size = (file_size - total_written < block_size) ? file_size - total_written : block_size;
-        rc = fs_write(&file, buffer, chunk_size);
-        if (rc < 0 ||  rc != chunk_size) {
-            printk("Write failed: %d\n", rc);
-            fs_close(&file);
-            return rc;
+            /* 后台扫描与前台的 statvfs 同时进行, 这里只等待它结束再打印 */
+            (void)fatfs_ext_fsinfo_wait(K_FOREVER, &st);
+            printk("%-8s %10llu %12llu %12lu %8s %12u %10u %10u %-10s %u\n", fsinfo_policy_names[fsinfo_policy],
+                fs_perf_cycles_to_us(t1 - t0), fs_perf_cycles_to_us(t2 - t1), (unsigned long)sv.f_bfree,
+                st.fsinfo_valid ? "valid" : "invalid", st.fsinfo_free, st.scan_ms, st.scan_free,
+                verify_result_names[st.result], st.stack_unused);
         }
+    }
 
-#if PRINT_SINGLE_WRITE_TIME
-        uint32_t t2 = DTimestamp_Get();
-        DiagPrintf("write %d us\n", t2-t1);
+    /* 恢复默认策略 */
+    fsinfo_policy = FSINFO_POLICY;
+    if (rc == 0) {
+        rc = fatfs_cold_unmount();
+    }
+    if (rc == 0) {
+        rc = fatfs_cold_mount();
+    }
+    return rc;
+}
 #endif
 
-        total_written += rc;
-        stat->write_operations_completed++;
+#if SW_CEILING
+/* sw_ceiling.overlay 中 disk-name 为 "RAM" 的 ram-disk, 不经过 disk_cache */
+#define CEILING_MNTP        "/RAM:"
 
-        if (stat->config->random_access) {
-            row = (row + 1)% stat->config->rows;
-            col++;
-            if (col == stat->config->cols) {
-                row_start++;
-                row = row_start;
-                col = 0;
-            }
-        }
-        // DiagPrintf("%d, %d. %d\n", chunk_size, total_written, stat->write_operations_completed);
+static FATFS ram_fat_fs;
 
-#if CHECK_READ_DATA
-        if (stat->write_operations_completed == 1) {
-            printk("%u, %u, %u, %u\n", buffer[0], buffer[4], buffer[8], buffer[12]);
-        }
+static struct fs_mount_t ram_mnt = {
+	.type = FS_FATFS,
+	.mnt_point = CEILING_MNTP,
+	.fs_data = &ram_fat_fs,
+};
+
+static int ram_mount(void)
+{
+    return fs_mount(&ram_mnt);
+}
+
+static int ram_unmount(void)
+{
+    return fs_unmount(&ram_mnt);
+}
+
+/* buffer 对齐与 SD 卡相同，两边只差介质 */
+static const struct fs_perf_backend ram_backend = {
+    .name = "FATFS-RAM",
+    .mnt_point = CEILING_MNTP,
+    .test_file = CEILING_MNTP"/test.dat",
+    .buf_align = 32,
+    .mount = ram_mount,
+    .unmount = ram_unmount,
+};
 #endif
-    }
 
-    #if SYNC_AFTER_WRITE
-        // printk("fs_sync\n");
-        DELAY_LA(300);
-        fs_sync(&file);
-    #endif
-
-    /* 结束计时 */
-    end_time = k_uptime_get();
-    end_time_us = DTimestamp_Get();
-    
-    /* 计算性能 */
-    stat->write_time_us = end_time_us - start_time_us;
-    stat->write_time_ms = (end_time - start_time);
-    stat->write_speed_kbps = (int)(((float)file_size / 1024 * 1000) / stat->write_time_ms);
-    
-    // printk("fs_close\n");
-    DELAY_LA(400);
-    rc = fs_close(&file);
-    if (rc != 0) {
-        DiagPrintf("Error closing file: %d\n", rc);
-    } else {
-        // DiagPrintf("close %s successfully\n", TEST_FILE_NAME);
+#if STREAM_BENCH
+/* 模拟传感器/编码器: 生成伪随机数据，再占用 busy_us 的 CPU */
+static void stream_produce(uint8_t *buf, uint32_t len, uint32_t *state, uint32_t busy_us)
+{
+    uint32_t x = *state;
+
+    for (uint32_t i = 0; i + 4 <= len; i += 4) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        memcpy(&buf[i], &x, 4);
+    }
+    *state = x;
+    if (busy_us > 0) {
+        k_busy_wait(busy_us);
     }
-    return 0;
 }
 
-/* 测试顺序读取 */
-static int test_read(struct perf_stats *stat)
+struct stream_result {
+    uint64_t total_cycles;
+    uint64_t produce_cycles;
+    struct stream_writer_stats stats;
+};
+
+static int stream_run(uint32_t depth, uint32_t busy_us, struct stream_result *res)
 {
     struct fs_file_t file;
+    struct stream_writer_config cfg = {
+        .file = &file,
+        .buffers = stream_buffers,
+        .buf_size = STREAM_BUF_SIZE,
+        .depth = depth,
+        .stack = stream_stack,
+        .stack_size = K_THREAD_STACK_SIZEOF(stream_stack),
+        .priority = STREAM_WRITER_PRIORITY,
+    };
+    uint32_t state = 0x12345678;
+    uint64_t start_cycles, produce_start;
+    uint8_t *buf;
     int rc;
-    uint32_t offset;
-    int64_t start_time, end_time;
-    uint32_t block_size = stat->config->block_size_bytes;
-    uint32_t file_size = stat->config->file_size_bytes;
-    uint32_t chunk_size;    // chunk size read or write each time
-    
-    /* 打开文件用于读取 */
-    DELAY_LA(100);
-    // printk("fs_file_t_init\n");
+
+    memset(res, 0, sizeof(*res));
+    (void)fs_unlink(TEST_FILE_NAME);
     fs_file_t_init(&file);
-    // printk("fs_open\n");
-    rc = fs_open(&file, TEST_FILE_NAME, FS_O_READ);
+    rc = fs_open(&file, TEST_FILE_NAME, FS_O_CREATE | FS_O_WRITE);
     if (rc < 0) {
-        printk("Failed to open file for reading: %d\n", rc);
+        printk("Failed to open file for writing: %d\n", rc);
         return rc;
     }
+    if (depth > 0) {
+        rc = stream_writer_start(&stream, &cfg);
+    }
 
-#if CHECK_READ_DATA
-    /* 生成预期数据 */
-    generate_test_data(expected_buffer, block_size, grw_data_pattern);
-#endif
-
-    /* 开始计时 */
-    start_time = k_uptime_get();
-
-    DELAY_LA(100);
-    /* 读取并验证 */
-    int row_start = 0;
-    int row = 0;
-    int col  = 0;
-    size_t total_read = 0;
-    while (total_read < file_size) {
-        if (stat->config->random_access) {
-#if USE_SYSRAND
-            offset = get_random(file_size, block_size);
-#else
-            offset = RandomPermutationsGet(row, col, stat->config->cols);
-            offset = offset * block_size;
-#endif
-            // DiagPrintf("r [%d] [%d] %u\n", row, col, offset);
-            rc = fs_seek(&file, offset, FS_SEEK_SET);
+    start_cycles = k_cycle_get_64();
+    for (uint32_t written = 0; written < STREAM_FILE_SIZE && rc == 0; written += STREAM_BUF_SIZE) {
+        if (depth > 0) {
+            rc = stream_writer_get_buf(&stream, &buf, K_FOREVER);
             if (rc < 0) {
-                printk("Seek failed: %d, offset %d\n", rc, offset);
                 break;
             }
+        } else {
+            buf = stream_buffers;
         }
 
-        // printk("fs_read\n");
-        DELAY_LA(200);
-        chunk_size = (file_size - total_read < block_size) ? file_size - total_read : block_size;
-        rc = fs_read(&file, buffer, chunk_size);
-        if (rc < 0 || rc != chunk_size) {
-            printk("Read failed: %d. expected chunk_size=%d, total_read=%d\n", rc, chunk_size, total_read);
-            fs_close(&file);
-            return rc;
+        produce_start = k_cycle_get_64();
+        stream_produce(buf, STREAM_BUF_SIZE, &state, busy_us);
+        res->produce_cycles += k_cycle_get_64() - produce_start;
+
+        if (depth > 0) {
+            rc = stream_writer_commit(&stream, STREAM_BUF_SIZE);
+        } else {
+            rc = fs_write(&file, buf, STREAM_BUF_SIZE);
+            rc = (rc == STREAM_BUF_SIZE) ? 0 : ((rc < 0) ? rc : -EIO);
         }
+    }
 
-        total_read += rc;
-        stat->read_operations_completed++;
+    if (depth > 0) {
+        int stop_rc = stream_writer_stop(&stream);
 
-        if (stat->config->random_access) {
-            row = (row + 1)% stat->config->rows;
-            col++;
-            if (col == stat->config->cols) {
-                row_start++;
-                row = row_start;
-                col = 0;
-            }
-        }
+        rc = (rc < 0) ? rc : stop_rc;
+        stream_writer_stats_get(&stream, &res->stats);
+    } else if (rc == 0) {
+        rc = fs_sync(&file);
+    }
+    res->total_cycles = k_cycle_get_64() - start_cycles;
 
-#if CHECK_READ_DATA
-        if (stat->read_operations_completed == 1) {
-            printk("%u, %u, %u, %u\n", buffer[0], buffer[4], buffer[8], buffer[12]);
-        }
+    int close_rc = fs_close(&file);
+    return (rc < 0) ? rc : close_rc;
+}
 
-        /* 验证数据完整性 */
-        if (memcmp(buffer, expected_buffer, rc) != 0) {
-            printk("ERROR: Data verification failed at offset %zu\n", total_read);
-            fs_close(&file);
-            return -1;
+/* 持续写入速度 = 文件大小 / 从开始生产到 sync 完成的时间;
+   produce 是生产者自己花的时间，重叠得好时 total 接近 max(produce, write) 而不是两者之和 */
+static int run_stream_bench(void)
+{
+    struct stream_result res;
+    uint64_t total_us;
+    int rc;
+
+    printk("\n====== stream write %u bytes, buffer %u bytes ======\n", STREAM_FILE_SIZE, STREAM_BUF_SIZE);
+    printk("depth  produce/buf (us)    KB/s  total (us)  produce (us)  write (us)  "
+            "producer wait (us)  writer idle (us)  max pending  backpressure\n");
+    for (size_t p = 0; p < ARRAY_SIZE(stream_produce_us); p++) {
+        for (size_t d = 0; d < ARRAY_SIZE(stream_depths); d++) {
+            rc = stream_run(stream_depths[d], stream_produce_us[p], &res);
+            if (rc < 0) {
+                printk("depth %u, produce %u us failed: %d\n", stream_depths[d], stream_produce_us[p], rc);
+                return rc;
+            }
+
+            total_us = fs_perf_cycles_to_us(res.total_cycles);
+            printk("%5u %17u %7llu %11llu %13llu %11llu %19llu %17llu %12u %13u\n",
+                stream_depths[d], stream_produce_us[p],
+                (total_us > 0) ? (uint64_t)STREAM_FILE_SIZE * 1000000 / 1024 / total_us : 0,
+                total_us, fs_perf_cycles_to_us(res.produce_cycles),
+                (stream_depths[d] > 0) ? fs_perf_cycles_to_us(res.stats.write_cycles)
+                                       : total_us - fs_perf_cycles_to_us(res.produce_cycles),
+                fs_perf_cycles_to_us(res.stats.producer_wait_cycles),
+                fs_perf_cycles_to_us(res.stats.writer_idle_cycles),
+                res.stats.max_pending, res.stats.backpressure_events);
         }
-#endif
     }
-    
-    /* 结束计时 */
-    end_time = k_uptime_get();
-    
-    /* 计算性能 */
-    stat->read_time_ms = (end_time - start_time);
-    stat->read_speed_kbps = (int)(((float)file_size / 1024 * 1000) / stat->read_time_ms);
+    printk("======================================\n\n");
 
-    // printk("fs_close\n");
-    DELAY_LA(300);
-    fs_close(&file);
+    (void)fs_unlink(TEST_FILE_NAME);
     return 0;
 }
+#endif
 
-/* 显示性能结果 */
-static void display_performance_results(struct fs_test_config *config, struct perf_stats *stats)
+/* 每个测试都显式设置 disk_cache 的全部参数, 不继承上一个测试的状态 */
+static int apply_disk_cache(uint32_t cache_sectors, uint32_t coalesce_sectors, uint32_t readahead_sectors)
 {
-    DiagPrintf("\n====== FATFS Performance Results ======\n");
-    DiagPrintf("file_size %d bytes, block_size %d bytes, random access %d. Average read speed %d KB/s. Average write speed %d KB/s\n", 
-        config->file_size_bytes, config->block_size_bytes, config->random_access, 
-        config->avg_read_speed, config->avg_write_speed);
-
-    for (int i = 0; i < TEST_ITERATIONS; i++) {
-        struct perf_stats *stat = &stats[i];
-        DiagPrintf("[%d] Write: Operations %u, %llu ms, %u us, %u KB/s. \n",
-            i, stat->write_operations_completed, stat->write_time_ms, stat->write_time_us, stat->write_speed_kbps);
-        DiagPrintf("[%d] Read:  Operations %u, %llu ms, %u KB/s\n",
-            i, stat->read_operations_completed, stat->read_time_ms, stat->read_speed_kbps);
-    }
-    DiagPrintf("======================================\n");
+    int rc = disk_cache_resize(cache_sectors);
+
+    if (rc == 0) {
+        rc = disk_cache_set_coalesce(coalesce_sectors);
+    }
+    if (rc == 0) {
+        rc = disk_cache_set_readahead(readahead_sectors);
+    }
+    return rc;
 }
 
 /* 主测试函数 */
 int main(void)
 {
     int rc;
-    
-    printk("Starting FATFS performance test...\n");
-
-	rc = fs_mount(&fatfs_mnt);
-	if (rc < 0) {
-		LOG_INF("FAT file system mounting failed, [%d]\n", rc);
-		return rc;
-	} else {
-		LOG_INF("FAT file system mounting successfully\n");
-	}
-
-    print_fatfs_info(&fat_fs);
-
-    /* 清理旧测试文件 */
-    fs_unlink(TEST_FILE_NAME);
-    LOG_INF("wr buffer  %p. fatfs.win %p\n", buffer, fat_fs.win);
-
-    int config_nums = (sizeof(configs) / sizeof(configs[0]));
-    for (int c = 0; c < config_nums; c++) {
-        DELAY_LA(2000);
-        struct fs_test_config *config = &configs[c];
-        if (config->block_size_bytes > TEST_BLOCK_SIZE_MAX) {
-            printk("ERROR: block_size %d exceeds %d\n", config->block_size_bytes, TEST_BLOCK_SIZE_MAX);
-            continue;
+    struct fs_perf_options opts = FS_PERF_OPTIONS_DEFAULT;
+
+    opts.iterations = TEST_ITERATIONS;
+    opts.warmup = TEST_WARMUP;
+    opts.min_iterations = TEST_MIN_ITERATIONS;
+    opts.ci_target_permille = TEST_CI_TARGET_PERMILLE;
+    opts.pattern_base = RW_DATA_PATTREN_BASE;
+    opts.case_delay_ms = DELAY_BETWEEN_CASES_MS;
+
+    rc = fs_perf_init(&fatfs_backend, &opts);
+    if (rc < 0) {
+        return rc;
+    }
+
+#if SW_CEILING
+    /* 失败时上限显示为 "-", 不影响设备的测试 */
+    (void)fs_perf_run_ceiling(&ram_backend, configs, ceiling_configs, ARRAY_SIZE(configs));
+#endif
+
+    for (size_t p = 0; p < ARRAY_SIZE(passes) && rc == 0; p++) {
+        printk("\n>>>>>> %s: cache %u sectors, buffer misalign %u, coalesce %u sectors, fast seek %d, "
+                "read-ahead %u sectors\n",
+            passes[p].title, passes[p].cache_sectors, passes[p].buf_misalign,
+            passes[p].coalesce_sectors, passes[p].fastseek, passes[p].readahead_sectors);
+
+        fastseek_on = passes[p].fastseek;
+        opts.buf_misalign = passes[p].buf_misalign;
+        rc = fs_perf_set_options(&opts);
+        if (rc == 0) {
+            rc = apply_disk_cache(passes[p].cache_sectors, passes[p].coalesce_sectors,
+                passes[p].readahead_sectors);
         }
-        printk("\n\n[%d:%d] file_size %d bytes, block_size %d bytes, random access %d\n", 
-            c, config_nums,
-            config->file_size_bytes, config->block_size_bytes, config->random_access);
-
-        /* 预生成 随机序列 */
-        int blocks = config->file_size_bytes/config->block_size_bytes;
-        if (blocks > RANDOM_COL_RANGE) {
-            config->cols = RANDOM_COL_RANGE;
-            config->rows = blocks/RANDOM_COL_RANGE;
-        } else {
-            config->rows = 1;
-            config->cols = blocks;
+        if (rc == 0) {
+            rc = fs_perf_run_configs(configs, ARRAY_SIZE(configs));
         }
-        if (config->rows * config->cols != blocks || config->rows > RANDOM_ROW_RANGE) {
-            printk("ERROR: rows %d, cols %d, blocks %d\n", config->rows, config->cols, blocks);
-            continue;
+#if SW_CEILING
+        if (rc == 0) {
+            fs_perf_print_ceiling(configs, ceiling_configs, ARRAY_SIZE(configs));
         }
+#endif
+    }
 
-        RandomPermutationsInitialize(config->rows, config->cols);
-
-        memset(stats, 0, sizeof(stats[0]) * TEST_ITERATIONS);
-
-        for (int i = 0; i < TEST_ITERATIONS; i++) {
-#if CHECK_READ_DATA
-            grw_data_pattern = RW_DATA_PATTREN_BASE + i*config_nums + c;
-#else
-            grw_data_pattern = RW_DATA_PATTREN_BASE;
+#if SEEK_SWEEP
+    if (rc == 0) {
+        rc = apply_disk_cache(DISK_CACHE_SECTORS, DISK_CACHE_COALESCE_SECTORS_MAX, DISK_CACHE_RA_SECTORS_MAX);
+    }
+    /* fast seek 关闭时耗时随偏移线性增长，打开后基本不变 */
+    for (int on = 0; on < 2 && rc == 0; on++) {
+        printk("\n>>>>>> seek sweep, fast seek %d\n", on);
+        fastseek_on = on;
+        rc = fs_perf_run_seek_sweep(SEEK_SWEEP_FILE_SIZE, SEEK_SWEEP_POINTS, SEEK_SWEEP_REPEATS);
+    }
+    fastseek_on = false;
 #endif
-            struct perf_stats *stat = &stats[i];
-            stat->config = config;
 
-            /* 测试1: 顺序写入 */
-#if DELAY_BETWEEN_CASES
-            k_msleep(1000);
+#if PREALLOC_COMPARE
+    opts.buf_misalign = 0;
+    opts.unlink_each_iteration = true;
+    if (rc == 0) {
+        rc = fs_perf_set_options(&opts);
+    }
+    if (rc == 0) {
+        rc = apply_disk_cache(DISK_CACHE_SECTORS, DISK_CACHE_COALESCE_SECTORS_MAX, DISK_CACHE_RA_SECTORS_MAX);
+    }
+    for (int pre = 0; pre < 2 && rc == 0; pre++) {
+        printk("\n>>>>>> new file each iteration, preallocated %d\n", pre);
+        prealloc_size = pre ? PREALLOC_FILE_SIZE : 0;
+        rc = fs_perf_run_configs(prealloc_configs, ARRAY_SIZE(prealloc_configs));
+    }
+    prealloc_size = 0;
 #endif
-            printk("Test 1: write test... [%d]\n", grw_data_pattern);
-            DCache_CleanInvalidate(0xFFFFFFFF, 0xFFFFFFFF);
-            rc = test_write(stat);
-            if (rc != 0) {
-                printk("write test failed: %d\n", rc);
-                return rc;
-            }
 
-#if 1
-            /* 测试2: 顺序读取 */
-#if DELAY_BETWEEN_CASES
-            k_msleep(1000);
-#endif
-            printk("Test 2: read test...\n");
-            DCache_CleanInvalidate(0xFFFFFFFF, 0xFFFFFFFF);
-            rc = test_read(stat);
-            if (rc != 0) {
-                printk("read test failed: %d\n", rc);
-                return rc;
-            }
+#if WORKLOAD_JOBS
+    opts.buf_misalign = 0;
+    opts.unlink_each_iteration = false;
+    if (rc == 0) {
+        rc = fs_perf_set_options(&opts);
+    }
+    if (rc == 0) {
+        rc = apply_disk_cache(DISK_CACHE_SECTORS, DISK_CACHE_COALESCE_SECTORS_MAX, DISK_CACHE_RA_SECTORS_MAX);
+    }
+    if (rc == 0) {
+        printk("\n>>>>>> workload jobs\n");
+        rc = fs_perf_run_jobs(jobs, ARRAY_SIZE(jobs));
+    }
 #endif
 
-        }
+#if MT_BENCH
+    opts.buf_misalign = 0;
+    opts.unlink_each_iteration = false;
+    if (rc == 0) {
+        rc = fs_perf_set_options(&opts);
+    }
+    if (rc == 0) {
+        rc = apply_disk_cache(DISK_CACHE_SECTORS, DISK_CACHE_COALESCE_SECTORS_MAX, DISK_CACHE_RA_SECTORS_MAX);
+    }
+    if (rc == 0) {
+        printk("\n>>>>>> multi-thread\n");
+        rc = fs_perf_run_mt_configs(mt_configs, ARRAY_SIZE(mt_configs));
+    }
+#endif
 
-        /* 计算均值 */
-        uint32_t total_read_speed = 0;
-        uint32_t total_write_speed = 0;
-        for (int i = 0; i < TEST_ITERATIONS; i++) {
-            struct perf_stats *stat = &stats[i];
-            total_read_speed += stat->read_speed_kbps;
-            total_write_speed += stat->write_speed_kbps;
-        }
-        config->avg_read_speed = total_read_speed / TEST_ITERATIONS;
-        config->avg_write_speed = total_write_speed / TEST_ITERATIONS;
+#if ASYNC_BENCH
+    if (rc == 0) {
+        rc = apply_disk_cache(DISK_CACHE_SECTORS, DISK_CACHE_COALESCE_SECTORS_MAX, DISK_CACHE_RA_SECTORS_MAX);
+    }
+    if (rc == 0) {
+        const struct fs_async_config async_cfg = {
+            .name = "fs_async_sd",
+            .stack = async_stack,
+            .stack_size = K_THREAD_STACK_SIZEOF(async_stack),
+            .priority = ASYNC_QUEUE_PRIORITY,
+            .merge_buf = async_merge_buf,
+            .merge_buf_size = sizeof(async_merge_buf),
+        };
+
+        rc = fs_async_queue_init(&async_queue, &async_cfg);
+    }
+    for (size_t c = 0; c < ARRAY_SIZE(async_configs) && rc == 0; c++) {
+        rc = fs_perf_run_async_write(&async_configs[c], &async_queue, async_depths, ARRAY_SIZE(async_depths));
+    }
+#endif
 
-        /* 显示结果 */
-        display_performance_results(config, stats);
+#if STREAM_BENCH
+    if (rc == 0) {
+        rc = apply_disk_cache(DISK_CACHE_SECTORS, DISK_CACHE_COALESCE_SECTORS_MAX, DISK_CACHE_RA_SECTORS_MAX);
+    }
+    if (rc == 0) {
+        rc = run_stream_bench();
+    }
+#endif
 
+#if MOUNT_BENCH
+    if (rc == 0) {
+        rc = apply_disk_cache(DISK_CACHE_SECTORS, DISK_CACHE_COALESCE_SECTORS_MAX, DISK_CACHE_RA_SECTORS_MAX);
+    }
+    if (rc == 0) {
+        rc = fs_perf_run_mount(&mount_bench, mount_points, mount_results, ARRAY_SIZE(mount_points));
+        fs_perf_print_mount(mount_results, ARRAY_SIZE(mount_points));
     }
+#endif
 
-    DELAY_LA(200);
-    /* 清理测试文件 */
-    fs_unlink(TEST_FILE_NAME);
-    
-    printk("FATFS performance test completed!\n");
+#if FSINFO_BENCH
+    if (rc == 0) {
+        rc = apply_disk_cache(DISK_CACHE_SECTORS, DISK_CACHE_COALESCE_SECTORS_MAX, DISK_CACHE_RA_SECTORS_MAX);
+    }
+    if (rc == 0) {
+        rc = run_fsinfo_bench();
+    }
+#endif
 
-    rc = fs_unmount(&fatfs_mnt);
-    if (rc < 0) {
-        LOG_INF("Error unmount FAT file system [%d]\n", rc);
-    } else {
-        LOG_INF("unmount FAT file system successfully\n");
+#if AGING_BENCH
+    /* 每次 iteration 新建文件, 测试文件分配在老化后零散的空闲 cluster 中 */
+    opts.buf_misalign = 0;
+    opts.unlink_each_iteration = true;
+    if (rc == 0) {
+        rc = fs_perf_set_options(&opts);
+    }
+    if (rc == 0) {
+        rc = apply_disk_cache(DISK_CACHE_SECTORS, DISK_CACHE_COALESCE_SECTORS_MAX, DISK_CACHE_RA_SECTORS_MAX);
+    }
+    if (rc == 0) {
+        rc = fs_perf_run_aging(&aging, aging_levels, ARRAY_SIZE(aging_levels), aging_level_results,
+            configs, aging_results, ARRAY_SIZE(configs));
+        fs_perf_print_aging(aging_level_results, ARRAY_SIZE(aging_levels), aging_results, ARRAY_SIZE(configs));
     }
+#endif
 
-    return 0;
+#ifdef CONFIG_THREAD_ANALYZER
+    /* 栈余量: 测试结束时还在运行的线程 (FSINFO 校验线程的余量在上面的表中) */
+    thread_analyzer_print(0);
+#endif
+
+    fs_perf_deinit();
+    return rc;
 }
@@ -1,80 +1,71 @@
 /*
  * LittleFS on NOR Flash 性能测试代码
  */
-#include "ameba_soc.h"
+#include "fs_perf_port.h"
 
 #include <zephyr/kernel.h>
 #include <zephyr/fs/fs.h>
 #include <zephyr/fs/littlefs.h>
 #include <zephyr/storage/flash_map.h>
 #include <zephyr/sys/printk.h>
-#include <zephyr/random/random.h>
-#include <zephyr/sys/time_units.h>
 #include <string.h>
 #include <stdlib.h>
 
+#include "fs_perf.h"
+#include "fs_async.h"
+#include "flash_io_stats.h"
+#include "lfs_usage.h"
+
 /* 测试配置 */
 #define TEST_PARTITION        demo_storage_partition  /* Flash 分区标签 */
 #define TEST_MOUNT_POINT      "/lfs1"
 
-#define SYNC_AFTER_WRITE (1)
-
-#define TEST_BLOCK_SIZE_MAX     (32*1024)           /* fs_read|write API 单次读|写的 最大大小 */
-#define TEST_FILE_NAME      "/lfs1/test.bin"
-#define TEST_ITERATIONS     (10)
+#define TEST_FILE_NAME      TEST_MOUNT_POINT"/test.bin"
+#define TEST_ITERATIONS     (10)    /* 自适应结束时的上限 */
+/* 每个 case 先运行不统计的 warm-up; 至少统计 TEST_MIN_ITERATIONS 次后，读写速度的
+   95% 置信区间半宽都不超过平均值的 TEST_CI_TARGET_PERMILLE / 1000 时提前结束 (0: 固定次数) */
+#define TEST_WARMUP         (1)
+#define TEST_MIN_ITERATIONS (3)
+#define TEST_CI_TARGET_PERMILLE (30)
 
-#define CHECK_READ_DATA (0) //  是否检查读出数据的有效性
 #define RW_DATA_PATTREN_BASE (0xA0)
-static unsigned char grw_data_pattern = 0xA0;
-
-// 随机写的时候，速度可能小于1，而 printk 不支持打印浮点，所以放大显示
-#define WRITE_SPEED_MULTIPLIER (100)
-
-struct fs_test_config {
-    uint32_t file_size_bytes;   // total file size
-    uint32_t block_size_bytes;  // read/write size each time
-    bool random_access;
-    uint32_t rows;  // random matrix row
-    uint32_t cols;  // random matrix columns
-
-    uint32_t avg_write_speed;
-    uint32_t avg_read_speed;
-    uint32_t read_success_rate_x100;
-    uint32_t write_success_rate_x100;
-};
-
-/* 性能统计结构体 */
-struct perf_stats {
-    struct fs_test_config *config;
-
-    // 开始时，用 ms 计时，但读速度过快，ms级别精度不够，所有换成了us
-    // 可以移除 ms 级别的计时
-    uint64_t write_time_ms;
-    uint64_t read_time_ms;
-
-    // 最终使用的是 us 级别的计时
-    uint64_t read_time_cycles;
-    uint64_t write_time_cycles;
-    uint64_t read_time_us;      // cycles -> us 换算得
-    uint64_t write_time_us;     // cycles -> us 换算得
-
-    uint32_t write_speed_kbps;
-    uint32_t read_speed_kbps;
-    uint32_t written_bytes;
-    uint32_t read_bytes;
-
-    uint32_t write_operations_completed;
-    uint32_t read_operations_completed;
-
-    bool read_success;  // true: 每次都读成功
-    bool write_success; // true: 每次都写成功了
-};
-
-static uint8_t buffer[TEST_BLOCK_SIZE_MAX] __attribute__((aligned(4096)));
-#if CHECK_READ_DATA
-static uint8_t expected_buffer[TEST_BLOCK_SIZE_MAX];
-#endif
 
+/* 1: 参数调优模式，不使用 app.overlay fstab 中的 read/prog/cache/lookahead 参数，
+      而是对 tune_* 中的每一种组合，用运行时构造的 fs_littlefs 配置重新格式化并挂载分区，
+      运行同样的测试矩阵，最后按 吞吐量 / 尾延迟 / RAM 排名。
+      native_sim 上使用 flash simulator，不需要板子。 */
+#define LFS_TUNE_MODE       (0)
+
+/* 非 0: 用这个 block-cycles 重新挂载 fstab 中的分区 (LittleFS 在一个块被擦写这么多次后
+   把数据搬走做磨损均衡, -1 表示关闭); 0: 使用 app.overlay 中的 block-cycles */
+#define LFS_BLOCK_CYCLES    (0)
+/* 1: 测试矩阵之后运行 jobs[] 中的混合负载 */
+#define WORKLOAD_JOBS       (1)
+/* 1: 对比 test_write() 与 fs_async 队列深度 async_depths[] 的异步写 */
+#define ASYNC_BENCH         (1)
+/* 1: 最后运行 mt_configs[], 看多个线程同时访问同一个挂载点时吞吐量随线程数的变化 */
+#define MT_BENCH            (1)
+
+/* 1: 测试矩阵之后在 RAM 模拟的 flash (app.overlay 中的 lfs_ram) 上运行同样的矩阵，
+      得到软件上限 (LittleFS + 测试代码本身的速度)，并打印 NOR flash 速度占上限的百分比。
+      native_sim 上被测分区本身就在 flash simulator 上，没有 lfs_ram，不运行 */
+#define SW_CEILING          (1)
+
+/* 1: 在分区上逐步增加文件、目录和填充比例，反复 unmount + mount，测量挂载时间和挂载后
+      第一次 fs_statvfs (LittleFS 需要遍历所有元数据统计已用块) 的耗时，与启动时间预算比较 */
+#define MOUNT_BENCH         (1)
+#define MOUNT_BENCH_REPEATS (10)
+
+/* 1: 挂载时遍历一次统计已用块，之后增量维护 (见 lfs_usage.h)，fs_statvfs 不再遍历;
+      MOUNT_BENCH 先关闭缓存运行一遍作对比 */
+#define LFS_USAGE_CACHE     (1)
+
+/* 1: 最后把分区依次老化到 aging_levels[] 的填充比例 (混合大小文件的 create/delete/rewrite)，
+      每个比例运行一遍 aging_configs[]，看速度随填充和碎片的变化 */
+#define AGING_BENCH         (1)
+
+/* 磨损报告中列出的磨损最多的块数 */
+#define WEAR_TOP_N          (8)
 
 static const uint32_t file_lengths[] = {
     4*1024,
@@ -98,391 +89,336 @@ static const uint32_t block_lengths[] = {
     16*1024
 };
 
-/* 全局统计 */
-static struct perf_stats stats[TEST_ITERATIONS];
+#if WORKLOAD_JOBS && !LFS_TUNE_MODE
+static const struct fs_perf_size_bin mixed_sizes[] = {
+    {128,   40},
+    {512,   40},
+    {4096,  20},
+};
 
-FS_LITTLEFS_DECLARE_DEFAULT_CONFIG(storage);
-static struct fs_mount_t lfs_storage_mnt = {
-    .type = FS_LITTLEFS,
-    .fs_data = &storage,
-    .storage_dev = (void *)FIXED_PARTITION_ID(TEST_PARTITION),
-    .mnt_point = TEST_MOUNT_POINT,
+static const struct fs_perf_job jobs[] = {
+    {
+        /* 配置/索引等少量热点块被频繁改写 */
+        .name = "metadata hotspot",
+        .file_size = 64*1024, .unit = 256, .ops = 500,
+        .read_percent = 70,
+        .read_dist = FS_PERF_DIST_HOTSPOT, .write_dist = FS_PERF_DIST_HOTSPOT,
+        .hot_percent = 10, .hot_access_percent = 90,
+        .sync_every = 8,
+    },
+    {
+        /* 日志: 顺序追加，随机回读 */
+        .name = "append + random read-back",
+        .file_size = 64*1024, .unit = 512, .ops = 500,
+        .read_percent = 50,
+        .read_dist = FS_PERF_DIST_UNIFORM, .write_dist = FS_PERF_DIST_SEQ,
+    },
+    {
+        .name = "zipf 70/30 mixed sizes",
+        .file_size = 64*1024, .unit = 128, .ops = 500,
+        .read_percent = 70,
+        .read_dist = FS_PERF_DIST_ZIPF, .write_dist = FS_PERF_DIST_ZIPF,
+        .zipf_theta_x100 = 90,
+        .sizes = mixed_sizes, .size_count = ARRAY_SIZE(mixed_sizes),
+        .think_us_min = 0, .think_us_max = 1000,
+    },
 };
+#endif
 
-/******************************************************************/
-/******************************************************************/
-#define RANDOM_COL_RANGE (1024)
-#define RANDOM_ROW_RANGE (64)
-
-// 全局变量：随机排列
-uint8_t randrows[RANDOM_ROW_RANGE];  // 行的随机排列
-uint16_t randcols[RANDOM_COL_RANGE];  // 列的随机排列
-
-// 初始化随机排列
-void RandomPermutationsInitialize(int M, int N) {
-    if (M > RANDOM_ROW_RANGE || N > RANDOM_COL_RANGE) {
-        printf("error: random row %d > %d, col %d > %d\n",
-            M, RANDOM_ROW_RANGE, N, RANDOM_COL_RANGE);
-        return;
-    }
+#if SW_CEILING && !LFS_TUNE_MODE && DT_NODE_EXISTS(DT_NODELABEL(lfs_ram))
+#define CEILING_MOUNT_POINT   "/lfsram"
+#define MATRIX_CASES_MAX      (2*ARRAY_SIZE(block_lengths)*ARRAY_SIZE(file_lengths))
 
-    // 初始化randrows数组为0到M-1
-    for (int i = 0; i < M; i++) {
-        randrows[i] = i;
-    }
-    
-    // 初始化randcols数组为0到N-1
-    for (int j = 0; j < N; j++) {
-        randcols[j] = j;
-    }
-    
-    // 打乱randrows数组 (Fisher-Yates洗牌算法)
-    for (int i = M - 1; i > 0; i--) {
-        int j = sys_rand32_get() % (i + 1);
-        // 交换randrows[i]和randrows[j]
-        int temp = randrows[i];
-        randrows[i] = randrows[j];
-        randrows[j] = temp;
-    }
-    
-    // 打乱randcols数组 (Fisher-Yates洗牌算法)
-    for (int i = N - 1; i > 0; i--) {
-        int j = sys_rand32_get() % (i + 1);
-        // 交换randcols[i]和randcols[j]
-        int temp = randcols[i];
-        randcols[i] = randcols[j];
-        randcols[j] = temp;
-    }
+/* fstab 中 automount, 与 lfs1 的 LittleFS 参数相同，只是介质在 RAM 中 */
+static const struct fs_perf_backend lfs_ram_backend = {
+    .name = "LittleFS-RAM",
+    .mnt_point = CEILING_MOUNT_POINT,
+    .test_file = CEILING_MOUNT_POINT"/test.bin",
+    .buf_align = 4,
+};
 
-#if 0
-    // 打印随机排列
-    printf("rand rows [%d]: ", M);
-    for (int i = 0; i < M; i++) {
-        printf("%d ", randrows[i]);
-    }
-    printf("\n");
-    
-    printf("rand columns [%d]: ", N);
-    for (int j = 0; j < N; j++) {
-        printf("%d ", randcols[j]);
-    }
-    printf("\n\n");
+/* 测试矩阵中实际运行的 case 在 NOR flash 和 RAM 上的结果 */
+static struct fs_perf_config matrix_configs[MATRIX_CASES_MAX];
+static struct fs_perf_config ceiling_configs[MATRIX_CASES_MAX];
+static size_t matrix_count;
+#define MATRIX_CEILING      (1)
+#else
+#define MATRIX_CEILING      (0)
 #endif
 
-    DCache_Clean((uint32_t)randrows, sizeof(randrows[0])*M);
-    DCache_Clean((uint32_t)randcols, sizeof(randcols[0])*N);
-}
+#if MOUNT_BENCH && !LFS_TUNE_MODE
+/* 64 字节的文件内联在目录的元数据块中，文件数直接增加挂载时要读的元数据 */
+static const struct fs_perf_mount_point mount_points[] = {
+    {0,     0},
+    {16,    0},
+    {64,    0},
+    {256,   0},
+    {256,   50},
+    {256,   80},
+};
+static struct fs_perf_mount_result mount_results[ARRAY_SIZE(mount_points)];
+#endif
 
-static uint32_t RandomPermutationsGet(uint32_t row, uint32_t col, uint32_t columns) {
-    uint32_t value = randrows[row] * columns + randcols[col];
-    return value;
-}
+#if AGING_BENCH && !LFS_TUNE_MODE
+static const uint32_t aging_levels[] = {10, 50, 80, 95};
 
+static const struct fs_perf_size_bin aging_sizes[] = {
+    {256,       30},
+    {1024,      30},
+    {4*1024,    25},
+    {16*1024,   15},
+};
 
-/* 打印文件系统的使用情况 */
-static void print_file_system_status() {
-    struct fs_statvfs stats;
-    int rc = fs_statvfs(lfs_storage_mnt.mnt_point, &stats);
-    if (rc < 0) {
-        LOG_PRINTK("FAIL: statvfs: %d\n", rc);
-        return;
-    }
+static const struct fs_perf_aging aging = {
+    .dir = TEST_MOUNT_POINT"/aging",
+    .sizes = aging_sizes,
+    .size_count = ARRAY_SIZE(aging_sizes),
+    .churn_ops = 100,
+};
 
-    LOG_PRINTK("%s: bsize = %lu ; frsize = %lu ; blocks = %lu ; bfree = %lu;"
-                "total size %lu KB, available size %lu KB, used %lu KB\n",
-            lfs_storage_mnt.mnt_point,
-            stats.f_bsize, stats.f_frsize, stats.f_blocks, stats.f_bfree,
-           stats.f_frsize * stats.f_blocks / 1024,
-           stats.f_frsize * stats.f_bfree / 1024,
-           (stats.f_blocks - stats.f_bfree) *stats.f_frsize / 1024
-           );
-}
+/* 测试矩阵中有代表性的 case; 整个矩阵乘以比例数的结果占用太多 RAM。
+   高填充比例下放不下的大文件会被跳过 */
+static const struct fs_perf_config aging_configs[] = {
+    {4*1024,  512,    0},
+    {4*1024,  512,    1},
+    {16*1024, 4*1024, 0},
+    {16*1024, 4*1024, 1},
+    {64*1024, 4*1024, 0},
+    {64*1024, 4*1024, 1},
+};
 
-/* 生成测试数据 */
-static void generate_test_data(uint8_t *buffer, size_t size, uint8_t pattern)
-{
-#if CHECK_READ_DATA
-    for (size_t i = 0; i < size; i++) {
-        buffer[i] = (pattern + i) & 0xFF;
-    }
-#else
-    memset(buffer, pattern&0xFF, size);
+static struct fs_perf_aging_level aging_level_results[ARRAY_SIZE(aging_levels)];
+static struct fs_perf_config aging_results[ARRAY_SIZE(aging_levels) * ARRAY_SIZE(aging_configs)];
 #endif
 
-    DCache_Clean((uint32_t)buffer, size);
-}
-
-/* 测试顺序写入 */
-static int test_write(struct perf_stats *stat)
-{
-    int rc;
-    struct fs_file_t file;
-    int64_t start_time, end_time;
-    uint64_t start_cycles, end_cycles;
-
-    uint32_t block_size = stat->config->block_size_bytes;  // buffer_size
-    uint32_t file_size = stat->config->file_size_bytes;
-    uint32_t chunk_size = -1;    // chunk size read or write each time
+#if MT_BENCH && !LFS_TUNE_MODE
+/* 同优先级的线程只在阻塞 (等锁) 时切换, 需要轮转时配置 CONFIG_TIMESLICE_SIZE */
+static const struct fs_perf_mt_thread mt_threads[] = {
+    {K_PRIO_PREEMPT(5), 0},
+    {K_PRIO_PREEMPT(5), 0},
+    {K_PRIO_PREEMPT(6), 0},
+    {K_PRIO_PREEMPT(7), 0},
+};
 
-    /* 打开文件用于写入 */
-    fs_file_t_init(&file);
-    rc = fs_open(&file, TEST_FILE_NAME, FS_O_CREATE | FS_O_WRITE);
-    if (rc < 0) {
-        printk("Failed to open file for writing: %d\n", rc);
-        return rc;
-    }
-    
-    /* 生成测试数据 */
-    generate_test_data(buffer, block_size, grw_data_pattern);
-    
-    /* 开始计时 */
-    start_time   = k_uptime_get();
-    start_cycles = k_cycle_get_64();
-    
-    /* 写入 */
-    size_t total_written = 0;
-    uint32_t offset = -1;
-    int row_start = 0;
-    int row = 0;
-    int col  = 0;
-    // DiagPrintf("\n");
-    while (total_written < file_size) {
-        if (stat->config->random_access) {
-            offset = RandomPermutationsGet(row, col, stat->config->cols);
-            offset = offset * block_size;
-            // DiagPrintf("w [%d][%d] %u\n", row, col, offset);
-
-            rc = fs_seek(&file, offset, FS_SEEK_SET);
-            if (rc < 0) {
-                printk("Seek failed: %d, offset %d\n", rc, offset);
-                break;
-            }
-            // printk("rand write at offset %u\n", offset);
-        }
+#define MT_CONFIG(n, same) \
+    {.threads = (n), .same_file = (same), .file_size = 16*1024, .block_size = 512, .thread_cfg = mt_threads}
+
+static struct fs_perf_mt_config mt_configs[] = {
+    MT_CONFIG(1, false),
+    MT_CONFIG(2, false),
+    MT_CONFIG(3, false),
+    MT_CONFIG(4, false),
+    MT_CONFIG(1, true),
+    MT_CONFIG(2, true),
+    MT_CONFIG(3, true),
+    MT_CONFIG(4, true),
+};
+#endif
 
-        chunk_size = (file_size - total_written < block_size) ? file_size - total_written : block_size;
-        rc = fs_write(&file, buffer, chunk_size);
-        if (rc < 0 ||  rc != chunk_size) {
-            printk("Write failed: expected %d, written %d; at %d\n", chunk_size, rc, total_written);
-            rc = -1;
-            goto out;
-        }
+#if ASYNC_BENCH && !LFS_TUNE_MODE
+static struct fs_perf_config async_configs[] = {
+    {64*1024, 512, 0},
+    {64*1024, 512, 1},
+};
+static const uint32_t async_depths[] = {1, 4, 16};
 
-        total_written += rc;
-        stat->write_operations_completed++;
-        rc = 0;
-
-        if (stat->config->random_access) {
-            row = (row + 1)% stat->config->rows;
-            col++;
-            if (col == stat->config->cols) {
-                row_start++;
-                row = row_start;
-                col = 0;
-            }
-        }
+/* work queue 优先级比 main 低: main 提交到队列满才让出 CPU，请求可以成批合并、排序 */
+#define ASYNC_QUEUE_PRIORITY    K_PRIO_PREEMPT(1)
+static K_THREAD_STACK_DEFINE(async_stack, 2048);
+static uint8_t async_merge_buf[4*1024] __aligned(4);
+static struct fs_async_queue async_queue;
 
-#if CHECK_READ_DATA
-        if (stat->write_operations_completed == 1) {
-            printk("%u, %u, %u, %u\n", buffer[0], buffer[4], buffer[8], buffer[12]);
-        }
-#endif
+static void run_async_bench(void)
+{
+    const struct fs_async_config async_cfg = {
+        .name = "fs_async_lfs",
+        .stack = async_stack,
+        .stack_size = K_THREAD_STACK_SIZEOF(async_stack),
+        .priority = ASYNC_QUEUE_PRIORITY,
+        .merge_buf = async_merge_buf,
+        .merge_buf_size = sizeof(async_merge_buf),
+    };
 
+    if (fs_async_queue_init(&async_queue, &async_cfg) < 0) {
+        return;
     }
+    for (size_t c = 0; c < ARRAY_SIZE(async_configs); c++) {
+        (void)fs_perf_run_async_write(&async_configs[c], &async_queue, async_depths, ARRAY_SIZE(async_depths));
+    }
+}
+#endif
 
-    if (stat->config->random_access) {
-        printk("last write offset %d, cur_pos %d\n", offset, offset + chunk_size);
-    } 
+/* 测试矩阵的汇总结果 */
+struct matrix_result {
+    uint32_t cases;             /* 读写都有成功的 case 数 */
+    uint32_t failed_cases;
+    uint32_t partial_cases;     /* 有 iteration 失败的 case, 速度只来自成功的 iteration */
+    uint64_t write_kbps_sum;    /* KB/s * FS_PERF_SPEED_MULTIPLIER */
+    uint64_t read_kbps_sum;
+    uint64_t write_p99_us_max;  /* 所有 case 中最差的单次 fs_write p99 */
+    uint64_t read_p99_us_max;
+};
 
-#if SYNC_AFTER_WRITE
-    fs_sync(&file);
-#endif
+FS_FSTAB_DECLARE_ENTRY(DT_NODELABEL(lfs1));
 
-out:
-    if (total_written == file_size) {
-        stat->write_success = true;
-    } else {
-        stat->write_success = false;
-    }
-    stat->written_bytes = total_written;
-
-    /* 结束计时 */
-    end_time   = k_uptime_get();
-    end_cycles = k_cycle_get_64();
-    
-    /* 记录耗时 */
-    stat->write_time_cycles = end_cycles - start_cycles;
-    stat->write_time_ms = end_time - start_time;
-
-    rc = fs_close(&file);
-    if (rc != 0) {
-        printk("Error closing file: %d\n", rc);
-    }
+/* 每个 case 开始时清零 flash 访问统计，记录当前的擦除次数 */
+static void lfs_case_start(void)
+{
+    flash_io_stats_reset();
+    flash_io_wear_mark();
+}
 
-    return rc;
+/* 打印本 case 的 flash 访问量和磨损增量 */
+static void lfs_case_report(void)
+{
+    flash_io_stats_print();
+    flash_io_wear_print(true, 3);
 }
 
-/* 测试顺序读取 */
-static int test_read(struct perf_stats *stat)
+/* 按 LittleFS 的块统计擦除次数, 必须在挂载之后调用 (block_size/block_count 挂载时才确定) */
+static void lfs_wear_track(const struct fs_littlefs *lfs)
 {
-    int rc;
-    struct fs_file_t file;
-    int64_t start_time, end_time;
-    uint64_t start_cycles, end_cycles;
-    uint32_t block_size = stat->config->block_size_bytes;  // buffer_size
-    uint32_t file_size = stat->config->file_size_bytes;
-    uint32_t chunk_size;    // chunk size read or write each time
-    
-    /* 打开文件用于读取 */
-    fs_file_t_init(&file);
-    rc = fs_open(&file, TEST_FILE_NAME, FS_O_READ);
+    int rc = flash_io_wear_track(FIXED_PARTITION_ID(TEST_PARTITION),
+        lfs->cfg.block_size, lfs->cfg.block_count);
     if (rc < 0) {
-        printk("Failed to open file for reading: %d\n", rc);
-        return rc;
+        printk("wear tracking disabled: %d (%u blocks, max %d)\n",
+            rc, lfs->cfg.block_count, FLASH_IO_WEAR_BLOCKS_MAX);
     }
+}
 
-#if CHECK_READ_DATA
-    /* 生成预期数据 */
-    generate_test_data(expected_buffer, block_size, grw_data_pattern);
-#endif
-
-    /* 开始计时 */
-    start_time   = k_uptime_get();
-    start_cycles = k_cycle_get_64();
-    
-    /* 读取并验证 */
-    uint32_t offset;
-    int row_start = 0;
-    int row = 0;
-    int col  = 0;
-    size_t total_read = 0;
-    while (total_read < file_size) {
-        if (stat->config->random_access) {
-            offset = RandomPermutationsGet(row, col, stat->config->cols);
-            offset = offset * block_size;
-
-            // DiagPrintf("r [%d] [%d] %u\n", row, col, offset);
-
-            rc = fs_seek(&file, offset, FS_SEEK_SET);
-            if (rc < 0) {
-                printk("Seek failed: %d, offset %d\n", rc, offset);
-                break;
-            }
-            // printk("rand read at offset %u\n", offset);
-        }
+static void lfs_case_dev_io(struct fs_perf_dev_io *io)
+{
+    struct flash_io_stats stats;
 
-        chunk_size = (file_size - total_read < block_size) ? file_size - total_read : block_size;
-        rc = fs_read(&file, buffer, chunk_size);
-        if (rc < 0 || rc != chunk_size) {
-            printk("Read failed: expected %d, read %d; at %d\n", chunk_size, rc, total_read);
-            rc = -1;
-            goto out;
-        }
+    (void)flash_io_stats_get(FIXED_PARTITION_ID(TEST_PARTITION), &stats);
+    io->read_bytes = stats.op[FLASH_IO_READ].bytes;
+    io->write_bytes = stats.op[FLASH_IO_WRITE].bytes;
+    io->erase_bytes = stats.op[FLASH_IO_ERASE].bytes;
+    io->erase_count = stats.op[FLASH_IO_ERASE].ops;
+}
 
-        total_read += rc;
-        stat->read_operations_completed++;
+#if !LFS_TUNE_MODE
+/* 分区在 app.overlay 的 fstab 中 automount，不需要 mount/unmount 回调 */
+static const struct fs_perf_backend lfs_backend = {
+    .name = "LittleFS-NOR",
+    .mnt_point = TEST_MOUNT_POINT,
+    .test_file = TEST_FILE_NAME,
+    .buf_align = 4,
+    .case_start = lfs_case_start,
+    .case_report = lfs_case_report,
+    .case_dev_io = lfs_case_dev_io,
+};
 
-        if (stat->config->random_access) {
-            row = (row + 1)% stat->config->rows;
-            col++;
-            if (col == stat->config->cols) {
-                row_start++;
-                row = row_start;
-                col = 0;
-            }
-        }
+#if MOUNT_BENCH
+/* NOR flash 没有缓存, 每次挂载都是冷的 */
+static int lfs_remount_unmount(void)
+{
+    return fs_unmount(&FS_FSTAB_ENTRY(DT_NODELABEL(lfs1)));
+}
 
-#if CHECK_READ_DATA
-if (stat->read_operations_completed == 1) {
-            printk("%u, %u, %u, %u\n", buffer[0], buffer[4], buffer[8], buffer[12]);
-        }
+static int lfs_remount_mount(void)
+{
+    return fs_mount(&FS_FSTAB_ENTRY(DT_NODELABEL(lfs1)));
+}
 
-        /* 验证数据完整性 */
-        if (memcmp(buffer, expected_buffer, rc) != 0) {
-            printk("ERROR: Data verification failed at offset %zu\n", total_read);
-            fs_close(&file);
-            return -1;
-        }
+static const struct fs_perf_mount_bench mount_bench = {
+    .dir = TEST_MOUNT_POINT"/mnt",
+    .files_per_dir = 32,
+    .file_size = 64,
+    .fill_file_size = 32*1024,
+    .repeats = MOUNT_BENCH_REPEATS,
+    .mount = lfs_remount_mount,
+    .unmount = lfs_remount_unmount,
+};
 #endif
 
+#if LFS_USAGE_CACHE
+/* 已用块缓存的命中次数，以及与遍历结果的偏差 (目录元数据分裂、搬移等没有跟踪到的变化) */
+static void lfs_usage_report(void)
+{
+    struct fs_littlefs *lfs = FS_FSTAB_ENTRY(DT_NODELABEL(lfs1)).fs_data;
+    struct lfs_usage_stats st;
+    int32_t drift;
+    int rc;
 
-        rc = 0;
+    if (lfs_usage_get(&lfs->lfs, &st) < 0) {
+        printk("used-block cache: not tracked\n");
+        return;
     }
+    rc = lfs_usage_check(&lfs->lfs, &drift);
+    printk("used-block cache: %u blocks%s, %u hits, %u recounts, drift %d blocks (rc %d)\n",
+        st.used_blocks, st.stale ? " (stale)" : "", st.hits, st.recounts, drift, rc);
+}
+#endif
 
-out:
-    if (total_read == file_size) {
-        stat->read_success = true;
-    } else {
-        stat->read_success = false;
+/* 按 LFS_BLOCK_CYCLES 重新挂载 fstab 中的分区，并开始统计磨损 */
+static int lfs_fstab_prepare(void)
+{
+    int rc;
+    struct fs_mount_t *mp = &FS_FSTAB_ENTRY(DT_NODELABEL(lfs1));
+    struct fs_littlefs *lfs = mp->fs_data;
+
+    if (LFS_BLOCK_CYCLES != 0) {
+        rc = fs_unmount(mp);
+        if (rc < 0) {
+            printk("unmount %s failed: %d\n", mp->mnt_point, rc);
+            return rc;
+        }
+        lfs->cfg.block_cycles = LFS_BLOCK_CYCLES;
+        rc = fs_mount(mp);
+        if (rc < 0) {
+            printk("mount %s failed: %d\n", mp->mnt_point, rc);
+            return rc;
+        }
     }
-    stat->read_bytes = total_read;
+    printk("%s: block_size %u, block_count %u, block_cycles %d\n", mp->mnt_point,
+        lfs->cfg.block_size, lfs->cfg.block_count, lfs->cfg.block_cycles);
 
-    /* 结束计时 */
-    end_time   = k_uptime_get();
-    end_cycles = k_cycle_get_64();
-    
-    /* 计算耗时*/
-    stat->read_time_cycles = end_cycles - start_cycles;
-    stat->read_time_ms = (end_time - start_time);
-
-    fs_close(&file);
-    return rc;
+    lfs_wear_track(lfs);
+    return 0;
 }
+#endif
 
-/* 显示性能结果 */
-static void display_performance_results(struct fs_test_config *config, struct perf_stats *stats)
+static void matrix_result_add(struct matrix_result *res, const struct fs_perf_config *config)
 {
-    printk("\n====== LittleFS Performance Results ======\n");
-    printk("file_size %d bytes, block_size %d bytes, random access %d. "
-            "Average read speed %d KB/s. Average write speed %u.%.2u KB/s. "
-            "ReadSuccessRate %u%%, WriteSuccessRate %u%%\n", 
-        config->file_size_bytes, config->block_size_bytes, config->random_access, 
-        config->avg_read_speed, config->avg_write_speed / WRITE_SPEED_MULTIPLIER, config->avg_write_speed % WRITE_SPEED_MULTIPLIER,
-        config->read_success_rate_x100, config->write_success_rate_x100);
-
-    for (int i = 0; i < TEST_ITERATIONS; i++) {
-        struct perf_stats *stat = &stats[i];
-        printk("[%d] WriteSuccess %d, Completed Operations %u; ReadSuccess %d, Completed Operations %u\n",
-            i, stat->write_success, stat->write_operations_completed, stat->read_success, stat->read_operations_completed);
-        printk("[%d] Sequential Write: %llu ms, %llu us, %u.%.2u KB/s\n", 
-            i, stat->write_time_ms, stat->write_time_us,
-            stat->write_speed_kbps / WRITE_SPEED_MULTIPLIER, stat->write_speed_kbps % WRITE_SPEED_MULTIPLIER);
-        printk("[%d] Sequential Read:  %llu ms, %llu us, %u KB/s.\n", 
-            i, stat->read_time_ms, stat->read_time_us, stat->read_speed_kbps);
+    uint64_t p99;
 
+    if (config->avg_write_speed == (uint32_t)-1 || config->avg_read_speed == (uint32_t)-1) {
+        res->failed_cases++;
+        return;
+    }
+    if (config->write_success_rate_x100 < 100 || config->read_success_rate_x100 < 100) {
+        res->partial_cases++;
     }
-    printk("======================================\n\n");
-}
-
-/* 主测试函数 */
-int main(void) {
-    int rc;
-    printk("\n***** LittleFS on NOR Flash Performance Test *****\n");
-    uint64_t cycles_per_sec = sys_clock_hw_cycles_per_sec();
-    printk("cycles_per_sec=%llu\n", cycles_per_sec);
-
-    print_file_system_status();
 
-    // 清理测试文件，确保测试环境重置
-    (void)fs_unlink(TEST_FILE_NAME);
+    res->cases++;
+    res->write_kbps_sum += config->avg_write_speed;
+    res->read_kbps_sum += config->avg_read_speed;
 
-    print_file_system_status();
+    p99 = fs_perf_cycles_to_us(fs_perf_hist_percentile(fs_perf_latency(FS_PERF_OP_WRITE), 9900));
+    res->write_p99_us_max = MAX(res->write_p99_us_max, p99);
+    p99 = fs_perf_cycles_to_us(fs_perf_hist_percentile(fs_perf_latency(FS_PERF_OP_READ), 9900));
+    res->read_p99_us_max = MAX(res->read_p99_us_max, p99);
+}
 
+/* 运行 文件长度 x 块长度 x 顺序/随机 的测试矩阵, res 可以为 NULL */
+static void run_test_matrix(struct matrix_result *res)
+{
     int total_cases = 2*ARRAY_SIZE(block_lengths)*ARRAY_SIZE(file_lengths);
     int case_number = 0;
-    struct fs_test_config test_config;
+    struct fs_perf_config test_config;
     for (int random = 0; random < 2; random++) {
         for (size_t block = 0; block < ARRAY_SIZE(block_lengths); block++) {
             for (size_t flen = 0; flen < ARRAY_SIZE(file_lengths); flen++) {
                 // 设置测试参数
-                memset(&test_config, 0, sizeof(struct fs_test_config));
+                memset(&test_config, 0, sizeof(struct fs_perf_config));
                 test_config.file_size_bytes =  file_lengths[flen];
                 test_config.block_size_bytes = block_lengths[block];
                 test_config.random_access = random;
                 case_number++;
 
-                struct fs_test_config *config = &test_config;
-                if ((config->block_size_bytes > config->file_size_bytes) 
+                struct fs_perf_config *config = &test_config;
+                if ((config->block_size_bytes > config->file_size_bytes)
                     // || (config->random_access && config->file_size_bytes > 16*1024)
 
                     /* fs_write len 很小时，随机写的速度很慢，跳过*/
@@ -495,106 +431,360 @@ int main(void) {
                     continue;
                 }
 
-                if (config->block_size_bytes > TEST_BLOCK_SIZE_MAX) {
-                    printk("ERROR: block_size %d exceeds %d\n", config->block_size_bytes, TEST_BLOCK_SIZE_MAX);
-                    continue;
-                }
-
-                printk("test: [%d:%d] file %d bytes, block %d bytes, random access %d\n", 
+                printk("test: [%d:%d] file %d bytes, block %d bytes, random access %d\n",
                     case_number, total_cases,
                     config->file_size_bytes, config->block_size_bytes, config->random_access);
 
-                /* 预生成 随机序列 */
-                int blocks = config->file_size_bytes/config->block_size_bytes;
-                if (blocks > RANDOM_COL_RANGE) {
-                    config->cols = RANDOM_COL_RANGE;
-                    config->rows = blocks/RANDOM_COL_RANGE;
-                } else {
-                    config->rows = 1;
-                    config->cols = blocks;
-                }
-                if (config->rows * config->cols != blocks || config->rows > RANDOM_ROW_RANGE) {
-                    printk("ERROR: rows %d, cols %d, blocks %d\n", config->rows, config->cols, blocks);
+                if (fs_perf_run_case(config) != 0) {
                     continue;
                 }
-
-                RandomPermutationsInitialize(config->rows, config->cols);
-
-                memset(stats, 0, sizeof(stats[0]) * TEST_ITERATIONS);
-                for (int i = 0; i < TEST_ITERATIONS; i++) {
-                    grw_data_pattern = RW_DATA_PATTREN_BASE + i;
-                    (void)fs_unlink(TEST_FILE_NAME);
-                    struct perf_stats *stat = &stats[i];
-                    stat->config = config;
-
-                    printk("iteration: %d:%d\n", i, TEST_ITERATIONS);
-                    /* 测试1: 顺序写入 */
-                    // print_file_system_status();
-                    printk("Test 1: write test...\n");
-                    DCache_CleanInvalidate(0xFFFFFFFF, 0xFFFFFFFF);
-                    rc = test_write(stat);
-                    if (rc != 0) {
-                        printk("[%d] Sequential write test failed: %d\n", i, rc);
-                        // return rc;
-                    }
-
-                    /* 测试2: 顺序读取 */
-                    // print_file_system_status();
-                    printk("Test 2: read test...\n");
-                    DCache_CleanInvalidate(0xFFFFFFFF, 0xFFFFFFFF);
-                    rc = test_read(stat);
-                    if (rc != 0) {
-                        printk("[%d] Sequential read test failed: %d\n", i, rc);
-                        // return rc;
-                    }
+                if (res != NULL) {
+                    matrix_result_add(res, config);
                 }
+#if MATRIX_CEILING
+                matrix_configs[matrix_count++] = *config;
+#endif
+            }
+        }
+    }
+}
 
-                /* 计算均值, 只有成功的 iteration 参与均值计算，
-                    以防在 pos=0 处失败时，read_bytes或written_bytes 为0，导致计算的速度为0*/
-                uint32_t total_read_speed = 0;
-                uint32_t total_write_speed = 0;
-                uint32_t read_success_times = 0;
-                uint32_t write_success_times = 0;
-                for (int i = 0; i < TEST_ITERATIONS; i++) {
-                    struct perf_stats *stat = &stats[i];
-
-                    stat->read_time_us = (stat->read_time_cycles * 1000000ULL) / cycles_per_sec;
-                    stat->write_time_us = (stat->write_time_cycles * 1000000ULL) / cycles_per_sec;
-                    stat->read_speed_kbps = (int)(((float)stat->read_bytes / 1024 * cycles_per_sec) / stat->read_time_cycles);
-                    stat->write_speed_kbps = (int)(((float)stat->written_bytes / 1024 * cycles_per_sec * WRITE_SPEED_MULTIPLIER) / stat->write_time_cycles);
-
-                    if (stat->read_success) {
-                        read_success_times++;
-                        total_read_speed += stat->read_speed_kbps;
-                    }
-                    if (stat->write_success) {
-                        write_success_times++;
-                        total_write_speed += stat->write_speed_kbps;
-                    }
-                }
+#if LFS_TUNE_MODE
+/******************************************************************/
+/* 参数调优
+ * LittleFS 的 block_size 固定为 flash 的擦除块大小，这里调整的是:
+ * - read_size / prog_size: 最小读/写单位，cache_size 必须是它们的整数倍
+ * - cache_size: read cache、prog cache 以及每个打开的文件各占一份
+ * - lookahead_size: 分配空闲块时的位图大小 (字节)，必须是 8 的整数倍
+ */
+#define TUNE_ITERATIONS     (3)
+#define TUNE_BLOCK_CYCLES   (512)
+
+static const uint32_t tune_read_sizes[] = {1, 16};
+static const uint32_t tune_prog_sizes[] = {1, 16};
+static const uint32_t tune_cache_sizes[] = {256, 512, 1024, 4096};
+static const uint32_t tune_lookahead_sizes[] = {8, 32};
+
+#define TUNE_CACHE_SIZE_MAX     (4096)
+#define TUNE_LOOKAHEAD_SIZE_MAX (32)
+#define TUNE_CONFIGS_MAX        (ARRAY_SIZE(tune_read_sizes) * ARRAY_SIZE(tune_prog_sizes) * \
+                                 ARRAY_SIZE(tune_cache_sizes) * ARRAY_SIZE(tune_lookahead_sizes))
+
+/* app.overlay fstab 中的参数，结果中用 '*' 标出 */
+#define FSTAB_READ_SIZE         (1)
+#define FSTAB_PROG_SIZE         (1)
+#define FSTAB_CACHE_SIZE        (256)
+#define FSTAB_LOOKAHEAD_SIZE    (8)
+
+struct tune_geometry {
+    uint32_t read_size;
+    uint32_t prog_size;
+    uint32_t cache_size;
+    uint32_t lookahead_size;
+};
 
-                if (read_success_times > 0) {
-                    config->avg_read_speed = total_read_speed / read_success_times;
-                } else {
-                    config->avg_read_speed = -1;
-                }
+struct tune_result {
+    struct tune_geometry geo;
+    struct matrix_result matrix;
+    uint32_t ram_bytes;
+    int rc;                     /* 挂载失败时为负数 */
+};
 
-                if (write_success_times > 0) {
-                    config->avg_write_speed = total_write_speed / write_success_times;
-                } else {
-                    config->avg_write_speed = -1;
-                }
+static struct tune_result tune_results[TUNE_CONFIGS_MAX];
+static const struct tune_geometry *tune_cur;
 
-                config->read_success_rate_x100  = read_success_times * 100 / TEST_ITERATIONS;
-                config->write_success_rate_x100 = write_success_times * 100 / TEST_ITERATIONS;
+static struct fs_littlefs tune_lfs;
+static uint8_t tune_read_buffer[TUNE_CACHE_SIZE_MAX] __aligned(4);
+static uint8_t tune_prog_buffer[TUNE_CACHE_SIZE_MAX] __aligned(4);
+static uint8_t tune_lookahead_buffer[TUNE_LOOKAHEAD_SIZE_MAX] __aligned(4);
 
-                /* 显示结果 */
-                display_performance_results(config, stats);
-            }
+static struct fs_mount_t tune_mnt = {
+    .type = FS_LITTLEFS,
+    .fs_data = &tune_lfs,
+    .storage_dev = (void *)FIXED_PARTITION_ID(TEST_PARTITION),
+    .mnt_point = TEST_MOUNT_POINT,
+};
+
+/* read/prog cache + 一个打开文件的 cache + lookahead */
+static uint32_t tune_ram_bytes(const struct tune_geometry *geo)
+{
+    return 3 * geo->cache_size + geo->lookahead_size;
+}
+
+/* 每种参数都从擦除后的空分区开始，挂载时自动格式化 */
+static int tune_mount(void)
+{
+    int rc;
+    const struct flash_area *fa;
+
+    rc = flash_area_open(FIXED_PARTITION_ID(TEST_PARTITION), &fa);
+    if (rc < 0) {
+        printk("flash_area_open failed: %d\n", rc);
+        return rc;
+    }
+    rc = flash_area_erase(fa, 0, fa->fa_size);
+    flash_area_close(fa);
+    if (rc < 0) {
+        printk("erase partition failed: %d\n", rc);
+        return rc;
+    }
+
+    memset(&tune_lfs, 0, sizeof(tune_lfs));
+    tune_lfs.cfg.read_size = tune_cur->read_size;
+    tune_lfs.cfg.prog_size = tune_cur->prog_size;
+    tune_lfs.cfg.cache_size = tune_cur->cache_size;
+    tune_lfs.cfg.lookahead_size = tune_cur->lookahead_size;
+    tune_lfs.cfg.block_cycles = TUNE_BLOCK_CYCLES;
+    tune_lfs.cfg.read_buffer = tune_read_buffer;
+    tune_lfs.cfg.prog_buffer = tune_prog_buffer;
+    tune_lfs.cfg.lookahead_buffer = tune_lookahead_buffer;
+
+    rc = fs_mount(&tune_mnt);
+    if (rc == 0) {
+        lfs_wear_track(&tune_lfs);
+    }
+    return rc;
+}
+
+static int tune_unmount(void)
+{
+    return fs_unmount(&tune_mnt);
+}
+
+static const struct fs_perf_backend tune_backend = {
+    .name = "LittleFS-NOR-tune",
+    .mnt_point = TEST_MOUNT_POINT,
+    .test_file = TEST_FILE_NAME,
+    .buf_align = 4,
+    .mount = tune_mount,
+    .unmount = tune_unmount,
+    .case_start = lfs_case_start,
+    .case_report = lfs_case_report,
+    .case_dev_io = lfs_case_dev_io,
+};
+
+static uint32_t tune_avg_kbps(const struct tune_result *r)
+{
+    if (r->rc < 0 || r->matrix.cases == 0) {
+        return 0;
+    }
+    return (r->matrix.write_kbps_sum + r->matrix.read_kbps_sum) / (2 * r->matrix.cases);
+}
+
+static uint64_t tune_p99_us(const struct tune_result *r)
+{
+    if (r->rc < 0 || r->matrix.cases == 0) {
+        return UINT64_MAX;
+    }
+    return MAX(r->matrix.write_p99_us_max, r->matrix.read_p99_us_max);
+}
+
+/* 排名从 1 开始，metric 越好排名越靠前 */
+static int tune_rank_kbps(const struct tune_result *results, int count, int idx)
+{
+    int rank = 1;
+    for (int i = 0; i < count; i++) {
+        rank += (tune_avg_kbps(&results[i]) > tune_avg_kbps(&results[idx]));
+    }
+    return rank;
+}
+
+static int tune_rank_p99(const struct tune_result *results, int count, int idx)
+{
+    int rank = 1;
+    for (int i = 0; i < count; i++) {
+        rank += (tune_p99_us(&results[i]) < tune_p99_us(&results[idx]));
+    }
+    return rank;
+}
+
+static int tune_rank_ram(const struct tune_result *results, int count, int idx)
+{
+    int rank = 1;
+    for (int i = 0; i < count; i++) {
+        rank += (results[i].ram_bytes < results[idx].ram_bytes);
+    }
+    return rank;
+}
+
+static void tune_print_results(int count)
+{
+    int order[TUNE_CONFIGS_MAX];
+
+    /* 按吞吐量从高到低排序 */
+    for (int i = 0; i < count; i++) {
+        int j = i;
+        while (j > 0 && tune_avg_kbps(&tune_results[order[j - 1]]) < tune_avg_kbps(&tune_results[i])) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    printk("\n====== LittleFS geometry ranking (block_cycles %d, %d iterations) ======\n",
+        TUNE_BLOCK_CYCLES, TUNE_ITERATIONS);
+    printk("  read  prog cache look | avg KB/s  write KB/s  read KB/s | p99 w us  p99 r us |  RAM B"
+            " | cases fail part | rank tp p99 ram\n");
+    for (int i = 0; i < count; i++) {
+        const struct tune_result *r = &tune_results[order[i]];
+        const struct tune_geometry *g = &r->geo;
+        bool fstab = g->read_size == FSTAB_READ_SIZE && g->prog_size == FSTAB_PROG_SIZE &&
+                     g->cache_size == FSTAB_CACHE_SIZE && g->lookahead_size == FSTAB_LOOKAHEAD_SIZE;
+        uint32_t cases = MAX(r->matrix.cases, 1);
+        uint32_t avg = tune_avg_kbps(r);
+        uint32_t wr = r->matrix.write_kbps_sum / cases;
+        uint32_t rd = r->matrix.read_kbps_sum / cases;
+
+        if (r->rc < 0) {
+            printk("%c%5u %5u %5u %4u | mount failed: %d\n", fstab ? '*' : ' ',
+                g->read_size, g->prog_size, g->cache_size, g->lookahead_size, r->rc);
+            continue;
+        }
+        printk("%c%5u %5u %5u %4u | %5u.%.2u %8u.%.2u %7u.%.2u | %8llu  %8llu | %6u | %5u %4u %4u |"
+                "      %2d  %2d  %2d\n", fstab ? '*' : ' ',
+            g->read_size, g->prog_size, g->cache_size, g->lookahead_size,
+            avg / FS_PERF_SPEED_MULTIPLIER, avg % FS_PERF_SPEED_MULTIPLIER,
+            wr / FS_PERF_SPEED_MULTIPLIER, wr % FS_PERF_SPEED_MULTIPLIER,
+            rd / FS_PERF_SPEED_MULTIPLIER, rd % FS_PERF_SPEED_MULTIPLIER,
+            r->matrix.write_p99_us_max, r->matrix.read_p99_us_max, r->ram_bytes,
+            r->matrix.cases, r->matrix.failed_cases, r->matrix.partial_cases,
+            tune_rank_kbps(tune_results, count, order[i]),
+            tune_rank_p99(tune_results, count, order[i]),
+            tune_rank_ram(tune_results, count, order[i]));
+    }
+    printk("'*': app.overlay fstab; avg KB/s = (write + read) / 2, averaged over the cases\n");
+    printk("======================================\n\n");
+}
+
+static int run_tune(struct fs_perf_options *opts)
+{
+    int rc;
+    int count = 0;
+    struct tune_geometry geo;
+
+    /* fstab 中 automount 的分区先卸载，之后用 tune_mnt 挂载到同一个挂载点 */
+    rc = fs_unmount(&FS_FSTAB_ENTRY(DT_NODELABEL(lfs1)));
+    if (rc < 0) {
+        printk("unmount fstab %s failed: %d\n", TEST_MOUNT_POINT, rc);
+    }
+
+    /* 每种组合固定次数，排名之间可比 */
+    opts->iterations = TUNE_ITERATIONS;
+    opts->ci_target_permille = 0;
+
+    for (size_t r = 0; r < ARRAY_SIZE(tune_read_sizes); r++) {
+    for (size_t p = 0; p < ARRAY_SIZE(tune_prog_sizes); p++) {
+    for (size_t c = 0; c < ARRAY_SIZE(tune_cache_sizes); c++) {
+    for (size_t l = 0; l < ARRAY_SIZE(tune_lookahead_sizes); l++) {
+        geo.read_size = tune_read_sizes[r];
+        geo.prog_size = tune_prog_sizes[p];
+        geo.cache_size = tune_cache_sizes[c];
+        geo.lookahead_size = tune_lookahead_sizes[l];
+        if (geo.cache_size % geo.read_size != 0 || geo.cache_size % geo.prog_size != 0) {
+            continue;
         }
+
+        struct tune_result *res = &tune_results[count++];
+        memset(res, 0, sizeof(*res));
+        res->geo = geo;
+        res->ram_bytes = tune_ram_bytes(&geo);
+        tune_cur = &res->geo;
+
+        printk("\n>>>>>> [%d:%d] read %u, prog %u, cache %u, lookahead %u\n",
+            count, (int)TUNE_CONFIGS_MAX,
+            geo.read_size, geo.prog_size, geo.cache_size, geo.lookahead_size);
+
+        res->rc = fs_perf_init(&tune_backend, opts);
+        if (res->rc < 0) {
+            continue;
+        }
+        run_test_matrix(&res->matrix);
+        fs_perf_deinit();
+    }
+    }
+    }
+    }
+
+    tune_print_results(count);
+    return 0;
+}
+#endif /* LFS_TUNE_MODE */
+
+/* 主测试函数 */
+int main(void) {
+    struct fs_perf_options opts = FS_PERF_OPTIONS_DEFAULT;
+
+    opts.iterations = TEST_ITERATIONS;
+    opts.warmup = TEST_WARMUP;
+    opts.min_iterations = TEST_MIN_ITERATIONS;
+    opts.ci_target_permille = TEST_CI_TARGET_PERMILLE;
+    opts.pattern_base = RW_DATA_PATTREN_BASE;
+    /* 每次 iteration 都重新创建文件; 失败只统计成功率，不中断测试 */
+    opts.unlink_each_iteration = true;
+    opts.stop_on_error = false;
+    lfs_usage_enable(LFS_USAGE_CACHE);
+
+#if LFS_TUNE_MODE
+    return run_tune(&opts);
+#else
+    int rc = lfs_fstab_prepare();
+    if (rc < 0) {
+        return rc;
     }
 
-    printk("\n***** Finish LittleFS on NOR Flash Performance Test *****\n");
+    rc = fs_perf_init(&lfs_backend, &opts);
+    if (rc < 0) {
+        return rc;
+    }
+
+    run_test_matrix(NULL);
+
+#if MATRIX_CEILING
+    (void)fs_perf_run_ceiling(&lfs_ram_backend, matrix_configs, ceiling_configs, matrix_count);
+    fs_perf_print_ceiling(matrix_configs, ceiling_configs, matrix_count);
+#endif
+
+#if WORKLOAD_JOBS
+    (void)fs_perf_run_jobs(jobs, ARRAY_SIZE(jobs));
+#endif
+
+#if ASYNC_BENCH
+    run_async_bench();
+#endif
+
+#if MT_BENCH
+    (void)fs_perf_run_mt_configs(mt_configs, ARRAY_SIZE(mt_configs));
+#endif
+
+#if MOUNT_BENCH
+#if LFS_USAGE_CACHE
+    /* 关闭缓存时 statvfs 随文件数增长; 打开后挂载时遍历一次, statvfs 不随文件数变化 */
+    lfs_usage_enable(false);
+    printk("\n>>>>>> used-block cache off\n");
+    (void)fs_perf_run_mount(&mount_bench, mount_points, mount_results, ARRAY_SIZE(mount_points));
+    fs_perf_print_mount(mount_results, ARRAY_SIZE(mount_points));
+    lfs_usage_enable(true);
+    printk("\n>>>>>> used-block cache on\n");
+#endif
+    (void)fs_perf_run_mount(&mount_bench, mount_points, mount_results, ARRAY_SIZE(mount_points));
+    fs_perf_print_mount(mount_results, ARRAY_SIZE(mount_points));
+#endif
+
+#if AGING_BENCH
+    (void)fs_perf_run_aging(&aging, aging_levels, ARRAY_SIZE(aging_levels), aging_level_results,
+        aging_configs, aging_results, ARRAY_SIZE(aging_configs));
+    fs_perf_print_aging(aging_level_results, ARRAY_SIZE(aging_levels), aging_results, ARRAY_SIZE(aging_configs));
+#endif
+
+#if LFS_USAGE_CACHE
+    lfs_usage_report();
+#endif
+
+    /* 整个测试矩阵 (和混合负载、老化) 的累计磨损 */
+    flash_io_wear_print(false, WEAR_TOP_N);
+
+    fs_perf_deinit();
 
     return 0;
-}
\ No newline at end of file
+#endif
+}
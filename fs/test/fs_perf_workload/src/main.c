@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * fs_perf_workload: SEQ 的偏移按每次实际的大小前进, 大小不同时前后两次操作也首尾相接
+ */
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "fs_perf_workload.h"
+
+#define TEST_OPS    (2000)
+#define TEST_SEED   (12345)
+
+/* 与 performance_fatfs_sd 的 "append + random read-back" 相同 */
+static const struct fs_perf_size_bin append_sizes[] = {
+    {4*1024,    50},
+    {32*1024,   50},
+};
+
+/* 不是 unit 的整数倍 */
+static const struct fs_perf_size_bin odd_sizes[] = {
+    {1000,  1},
+    {3000,  1},
+    {7777,  1},
+};
+
+/* 检查同一方向 (读或写) 的操作首尾相接, 到文件尾后回到文件头; 返回回到文件头的次数 */
+static uint32_t check_seq(const struct fs_perf_job *job, bool read, uint32_t max_size)
+{
+    struct fs_perf_job_gen gen;
+    struct fs_perf_io io;
+    uint32_t expect = 0;
+    uint32_t wraps = 0;
+    uint32_t seen = 0;
+
+    zassert_ok(fs_perf_job_gen_init(&gen, job, max_size, TEST_SEED));
+    for (uint32_t i = 0; i < TEST_OPS; i++) {
+        fs_perf_job_gen_next(&gen, &io);
+        zassert_true(io.size > 0);
+        zassert_true(io.offset + io.size <= job->file_size, "op %u: %u + %u", i, io.offset, io.size);
+        if (io.read != read) {
+            continue;
+        }
+        zassert_equal(io.offset, expect, "op %u: offset %u, expected %u", i, io.offset, expect);
+        expect = io.offset + io.size;
+        if (expect == job->file_size) {
+            expect = 0;
+            wraps++;
+        }
+        seen++;
+    }
+    zassert_true(seen > 0);
+    return wraps;
+}
+
+ZTEST(fs_perf_workload, test_seq_append_mixed_sizes)
+{
+    const struct fs_perf_job job = {
+        .name = "append",
+        .file_size = 8*1024*1024, .unit = 4*1024,
+        .read_percent = 0,
+        .read_dist = FS_PERF_DIST_UNIFORM, .write_dist = FS_PERF_DIST_SEQ,
+        .sizes = append_sizes, .size_count = ARRAY_SIZE(append_sizes),
+    };
+
+    (void)check_seq(&job, false, 32*1024);
+}
+
+ZTEST(fs_perf_workload, test_seq_unaligned_sizes_wrap)
+{
+    const struct fs_perf_job job = {
+        .name = "seq wrap",
+        .file_size = 64*1024, .unit = 512,
+        .read_percent = 0,
+        .read_dist = FS_PERF_DIST_UNIFORM, .write_dist = FS_PERF_DIST_SEQ,
+        .sizes = odd_sizes, .size_count = ARRAY_SIZE(odd_sizes),
+    };
+
+    /* 2000 次平均 ~3900 字节的操作走过 64 KB 的文件 100 多次 */
+    zassert_true(check_seq(&job, false, 8*1024) > 100);
+}
+
+ZTEST(fs_perf_workload, test_seq_read_write_cursors)
+{
+    const struct fs_perf_job job = {
+        .name = "seq mixed",
+        .file_size = 1024*1024, .unit = 4*1024,
+        .read_percent = 50,
+        .read_dist = FS_PERF_DIST_SEQ, .write_dist = FS_PERF_DIST_SEQ,
+        .sizes = append_sizes, .size_count = ARRAY_SIZE(append_sizes),
+    };
+
+    /* 读和写各自有 cursor, 互不影响 */
+    (void)check_seq(&job, true, 32*1024);
+    (void)check_seq(&job, false, 32*1024);
+}
+
+ZTEST(fs_perf_workload, test_random_offsets_aligned)
+{
+    const struct fs_perf_job job = {
+        .name = "uniform",
+        .file_size = 1024*1024, .unit = 4*1024,
+        .read_percent = 70,
+        .read_dist = FS_PERF_DIST_UNIFORM, .write_dist = FS_PERF_DIST_HOTSPOT,
+        .hot_percent = 10, .hot_access_percent = 90,
+        .sizes = append_sizes, .size_count = ARRAY_SIZE(append_sizes),
+    };
+    struct fs_perf_job_gen gen;
+    struct fs_perf_io io;
+
+    zassert_ok(fs_perf_job_gen_init(&gen, &job, 32*1024, TEST_SEED));
+    for (uint32_t i = 0; i < TEST_OPS; i++) {
+        fs_perf_job_gen_next(&gen, &io);
+        zassert_equal(io.offset % job.unit, 0);
+        zassert_true(io.offset + io.size <= job.file_size);
+    }
+}
+
+ZTEST_SUITE(fs_perf_workload, NULL, NULL, NULL, NULL, NULL);
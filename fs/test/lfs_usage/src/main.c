@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2024 Realtek Semiconductor Corp.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * lfs_usage: fs_statvfs 报告的空闲块不能多于原来的 lfs_fs_size() 遍历的结果,
+ * 包括文件打开着、还有没有 sync 的数据的时候
+ */
+#include <string.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/fs/littlefs.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/ztest.h>
+
+#include "lfs_usage.h"
+
+#define TEST_PARTITION_ID   FIXED_PARTITION_ID(lfs_usage_partition)
+#define TEST_MNTP           "/lfs"
+#define TEST_FILE           TEST_MNTP "/data.bin"
+#define TEST_DIR            TEST_MNTP "/dir"
+
+/* lfs_usage.cmake 用 --wrap 替换了 lfs_fs_size, __real_ 是 LittleFS 原来的实现 */
+lfs_ssize_t __real_lfs_fs_size(lfs_t *lfs);
+
+FS_LITTLEFS_DECLARE_DEFAULT_CONFIG(storage);
+static struct fs_mount_t lfs_mnt = {
+    .type = FS_LITTLEFS,
+    .fs_data = &storage,
+    .storage_dev = (void *)TEST_PARTITION_ID,
+    .mnt_point = TEST_MNTP,
+};
+
+static uint8_t buf[1024];
+
+/* 返回 statvfs 与遍历结果的空闲块数之差, 不能为正 */
+static int32_t free_excess(void)
+{
+    struct fs_statvfs st;
+    lfs_ssize_t used;
+
+    zassert_ok(fs_statvfs(TEST_MNTP, &st));
+    used = __real_lfs_fs_size(&storage.lfs);
+    zassert_true(used >= 0, "lfs_fs_size failed: %d", (int)used);
+    return (int32_t)st.f_bfree - (int32_t)(st.f_blocks - used);
+}
+
+static void write_blocks(struct fs_file_t *file, uint32_t blocks)
+{
+    uint32_t total = blocks * storage.cfg.block_size;
+
+    for (uint32_t done = 0; done < total; done += sizeof(buf)) {
+        memset(buf, (uint8_t)(done / sizeof(buf)), sizeof(buf));
+        zassert_equal(fs_write(file, buf, sizeof(buf)), sizeof(buf));
+    }
+}
+
+static void *lfs_usage_setup(void)
+{
+    const struct flash_area *fap;
+
+    zassert_ok(flash_area_open(TEST_PARTITION_ID, &fap));
+    zassert_ok(flash_area_flatten(fap, 0, fap->fa_size));
+    flash_area_close(fap);
+    return NULL;
+}
+
+static void lfs_usage_before(void *fixture)
+{
+    lfs_usage_enable(true);
+    zassert_ok(fs_mount(&lfs_mnt));
+}
+
+static void lfs_usage_after(void *fixture)
+{
+    (void)fs_unlink(TEST_FILE);
+    (void)fs_unlink(TEST_DIR);
+    zassert_ok(fs_unmount(&lfs_mnt));
+}
+
+ZTEST(lfs_usage, test_open_unsynced)
+{
+    struct fs_file_t file;
+    struct lfs_usage_stats st;
+
+    fs_file_t_init(&file);
+    zassert_ok(fs_open(&file, TEST_FILE, FS_O_CREATE | FS_O_RDWR));
+
+    /* 新的块只在打开的文件中, 还没有提交 */
+    write_blocks(&file, 8);
+    zassert_equal(free_excess(), 0);
+
+    zassert_ok(fs_sync(&file));
+    zassert_true(free_excess() <= 0);
+
+    /* 追加到已提交的文件后面 */
+    write_blocks(&file, 4);
+    zassert_equal(free_excess(), 0);
+
+    zassert_ok(fs_close(&file));
+    zassert_true(free_excess() <= 0);
+
+    /* 提交之后直接返回缓存的计数 */
+    zassert_ok(lfs_usage_get(&storage.lfs, &st));
+    zassert_false(st.stale);
+    zassert_true(free_excess() <= 0);
+    zassert_ok(lfs_usage_get(&storage.lfs, &st));
+    zassert_true(st.hits > 0);
+}
+
+ZTEST(lfs_usage, test_truncate_and_remove)
+{
+    struct fs_file_t file;
+
+    fs_file_t_init(&file);
+    zassert_ok(fs_open(&file, TEST_FILE, FS_O_CREATE | FS_O_RDWR));
+    write_blocks(&file, 8);
+    zassert_ok(fs_close(&file));
+    zassert_true(free_excess() <= 0);
+
+    /* 截断之后重新写入, close 之前旧块和新块都不能算作空闲 */
+    zassert_ok(fs_open(&file, TEST_FILE, FS_O_RDWR));
+    zassert_ok(fs_truncate(&file, 0));
+    write_blocks(&file, 2);
+    zassert_equal(free_excess(), 0);
+    zassert_ok(fs_close(&file));
+    zassert_true(free_excess() <= 0);
+
+    zassert_ok(fs_unlink(TEST_FILE));
+    zassert_true(free_excess() <= 0);
+}
+
+ZTEST(lfs_usage, test_mkdir_rename)
+{
+    struct fs_file_t file;
+
+    zassert_ok(fs_mkdir(TEST_DIR));
+    zassert_true(free_excess() <= 0);
+
+    fs_file_t_init(&file);
+    zassert_ok(fs_open(&file, TEST_DIR "/a.bin", FS_O_CREATE | FS_O_RDWR));
+    write_blocks(&file, 4);
+    zassert_ok(fs_close(&file));
+    zassert_ok(fs_rename(TEST_DIR "/a.bin", TEST_FILE));
+    zassert_true(free_excess() <= 0);
+}
+
+ZTEST_SUITE(lfs_usage, NULL, lfs_usage_setup, lfs_usage_before, lfs_usage_after, NULL);